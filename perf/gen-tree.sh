@@ -0,0 +1,159 @@
+#!/bin/sh
+################################################################################
+#
+#	Generate a synthetic workspace for timing mk itself
+#
+#	usage: gen-tree.sh [-p projects] [-f files] [-n fanout] [-d depth]
+#	                   [-k pkgheaders] <dir>
+#
+#	The workspace is laid out the way mk expects to find one: library
+#	projects in src/ (mod0, mod1, ...), each with its own headers in
+#	include/, an executable project (app) using them all, and package
+#	headers in inc/ that no project owns. Headers are named after their
+#	project (mod0/mod0_h0.h) since autolinks are matched by file name.
+#
+#	  -p  number of library projects                        (default: 20)
+#	  -f  source files (and headers) per project            (default: 20)
+#	  -n  header fan-out: headers each header includes      (default: 4)
+#	  -d  library dependency depth: the projects form chains
+#	      this long, each depending on the one before it    (default: 4)
+#	  -k  number of package headers in inc/                 (default: 10)
+#
+#	Anything already in <dir> is removed first. The parameters are written
+#	to <dir>/tree.json for the timing driver (time-mk.sh) to report.
+#
+################################################################################
+
+set -e
+
+projects=20
+files=20
+fanout=4
+depth=4
+pkgheaders=10
+
+usage() {
+	echo "usage: $0 [-p projects] [-f files] [-n fanout] [-d depth] [-k pkgheaders] <dir>" >&2
+	exit 2
+}
+
+while getopts p:f:n:d:k: opt; do
+	case $opt in
+	p) projects=$OPTARG ;;
+	f) files=$OPTARG ;;
+	n) fanout=$OPTARG ;;
+	d) depth=$OPTARG ;;
+	k) pkgheaders=$OPTARG ;;
+	*) usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+[ $# -eq 1 ] || usage
+for n in "$projects" "$files" "$fanout" "$depth" "$pkgheaders"; do
+	case $n in
+	''|*[!0-9]*) echo "$0: '$n' is not a number" >&2; exit 2 ;;
+	esac
+done
+[ "$projects" -ge 1 ] && [ "$files" -ge 1 ] && [ "$depth" -ge 1 ] || usage
+
+dir=${1%/}
+rm -rf "$dir"
+mkdir -p "$dir/src" "$dir/inc/synth"
+
+# package headers: each includes up to $fanout of the ones after it
+k=0
+while [ $k -lt "$pkgheaders" ]; do
+	{
+		echo "#ifndef SYNTH_PKG$k"
+		echo "#define SYNTH_PKG$k $k"
+		i=1
+		while [ $i -le "$fanout" ] && [ $((k + i)) -lt "$pkgheaders" ]; do
+			echo "#include <synth/pkg$((k + i)).h>"
+			i=$((i + 1))
+		done
+		echo "#endif"
+	} > "$dir/inc/synth/pkg$k.h"
+	k=$((k + 1))
+done
+
+# library projects; mod$p depends on mod$((p - 1)) unless it starts a chain
+p=0
+while [ $p -lt "$projects" ]; do
+	mod=mod$p
+	mkdir -p "$dir/src/$mod/include/$mod"
+	: > "$dir/src/$mod/.library"
+
+	dep=
+	if [ $((p % depth)) -ne 0 ]; then
+		dep=mod$((p - 1))
+	fi
+
+	f=0
+	while [ $f -lt "$files" ]; do
+		{
+			echo "#ifndef SYNTH_${mod}_H$f"
+			echo "#define SYNTH_${mod}_H$f"
+			i=1
+			while [ $i -le "$fanout" ] && [ $((f + i)) -lt "$files" ]; do
+				echo "#include <$mod/${mod}_h$((f + i)).h>"
+				i=$((i + 1))
+			done
+			echo "int ${mod}_f$f( int x );"
+			echo "#endif"
+		} > "$dir/src/$mod/include/$mod/${mod}_h$f.h"
+
+		{
+			echo "#include <$mod/${mod}_h$f.h>"
+			if [ "$pkgheaders" -gt 0 ]; then
+				echo "#include <synth/pkg$((f % pkgheaders)).h>"
+			fi
+			if [ -n "$dep" ]; then
+				echo "#include <$dep/${dep}_h0.h>"
+			fi
+			echo
+			echo "int ${mod}_f$f( int x ) {"
+			if [ -n "$dep" ] && [ $f -eq 0 ]; then
+				echo "	return ${dep}_f0( x ) + $f;"
+			else
+				echo "	return x + $f;"
+			fi
+			echo "}"
+		} > "$dir/src/$mod/f$f.c"
+
+		f=$((f + 1))
+	done
+
+	p=$((p + 1))
+done
+
+# the executable uses the last project of each chain
+mkdir -p "$dir/src/app"
+: > "$dir/src/app/.executable"
+{
+	p=0
+	while [ $p -lt "$projects" ]; do
+		if [ $(((p + 1) % depth)) -eq 0 ] || [ $((p + 1)) -eq "$projects" ]; then
+			echo "#include <mod$p/mod${p}_h0.h>"
+		fi
+		p=$((p + 1))
+	done
+	echo "#include <stdio.h>"
+	echo
+	echo "int main( void ) {"
+	echo "	int r = 0;"
+	p=0
+	while [ $p -lt "$projects" ]; do
+		if [ $(((p + 1) % depth)) -eq 0 ] || [ $((p + 1)) -eq "$projects" ]; then
+			echo "	r += mod${p}_f0( 1 );"
+		fi
+		p=$((p + 1))
+	done
+	printf '\tprintf( "%%d\\n", r );\n'
+	echo "	return 0;"
+	echo "}"
+} > "$dir/src/app/main.c"
+
+cat > "$dir/tree.json" <<JSON
+{ "projects": $projects, "files": $files, "fanout": $fanout, "depth": $depth, "pkgheaders": $pkgheaders }
+JSON
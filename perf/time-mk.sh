@@ -0,0 +1,126 @@
+#!/bin/sh
+################################################################################
+#
+#	Time mk on a workspace made by gen-tree.sh
+#
+#	usage: time-mk.sh [-r runs] [-j jobs] <mk> <dir>
+#
+#	Each of these scenarios is run `runs` times (default: 3):
+#
+#	  cold          build from scratch
+#	  noop          build again, with nothing changed
+#	  touch_header  build after touching the header in the middle of one
+#	                project's include chain
+#	  touch_source  build after touching one source file
+#
+#	mk reports each build with --stats (see mk(1)); the reports are written
+#	to stdout as one JSON document, along with the tree's parameters:
+#
+#	  { "mk": ..., "tree": {...}, "runs": n,
+#	    "scenarios": { "cold": [ {...}, ... ], "noop": [...], ... } }
+#
+################################################################################
+
+set -e
+
+runs=3
+jobs=
+
+usage() {
+	echo "usage: $0 [-r runs] [-j jobs] <mk> <dir>" >&2
+	exit 2
+}
+
+while getopts r:j: opt; do
+	case $opt in
+	r) runs=$OPTARG ;;
+	j) jobs="-j$OPTARG" ;;
+	*) usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+[ $# -eq 2 ] || usage
+
+mk=$1
+dir=${2%/}
+
+case $mk in
+/*) ;;
+*) mk=$(pwd)/$mk ;;
+esac
+
+if [ ! -f "$dir/tree.json" ]; then
+	echo "$0: '$dir' wasn't made by gen-tree.sh" >&2
+	exit 1
+fi
+
+cd "$dir"
+
+read -r projects files fanout depth pkgheaders <<PARAMS
+$(sed 's/[^0-9]/ /g' tree.json)
+PARAMS
+
+# the header and source in the middle of the middle project
+mod=mod$((projects / 2))
+header=src/$mod/include/$mod/${mod}_h$((files / 2)).h
+source=src/$mod/f$((files / 2)).c
+
+stats=$(mktemp "${TMPDIR:-/tmp}/mk-stats.XXXXXX")
+trap 'rm -f "$stats"' EXIT
+
+# build, then write out mk's statistics for it
+build() {
+	if ! "$mk" $jobs --stats="$stats" > /dev/null 2>&1; then
+		echo "$0: mk failed in '$dir'; run it there to see why" >&2
+		exit 1
+	fi
+	sed 's/^/\t\t\t/' "$stats"
+}
+
+# run a scenario `runs` times
+scenario() {
+	name=$1
+	shift
+
+	printf '\t\t"%s": [\n' "$name"
+	i=0
+	while [ $i -lt "$runs" ]; do
+		"$@"
+		build
+		i=$((i + 1))
+		if [ $i -lt "$runs" ]; then
+			printf '\t\t\t,\n'
+		fi
+	done
+	printf '\t\t]'
+}
+
+clean() {
+	rm -rf .mk-obj bin lib
+}
+nothing() {
+	:
+}
+touchHeader() {
+	touch "$header"
+}
+touchSource() {
+	touch "$source"
+}
+
+printf '{\n'
+printf '\t"mk": "%s",\n' "$mk"
+printf '\t"tree": %s,\n' "$(cat tree.json)"
+printf '\t"runs": %s,\n' "$runs"
+printf '\t"scenarios": {\n'
+clean
+scenario cold clean
+printf ',\n'
+scenario noop nothing
+printf ',\n'
+scenario touch_header touchHeader
+printf ',\n'
+scenario touch_source touchSource
+printf '\n\t}\n'
+printf '}\n'
@@ -2582,8 +2582,10 @@ static void axth__setCurrentThreadName( axthread_t *pThread, const char *pszName
 
 	x.p = pszName;
 	prctl( PR_SET_NAME, x.l, 0, 0, 0 );
-#  endif
+#  elif AXTHREAD_OS_MACOSX
+	/* only Mac OS X's version takes just the name; glibc's wants a thread */
 	pthread_setname_np( pszName );
+#  endif
 # else
 #  pragma warning "ax_thread: Could not determine how to set current thread's name"
 # endif
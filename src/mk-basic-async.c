@@ -23,6 +23,18 @@ mk_thread_t *mk_async_threadInit( mk_thread_t *thread, const char *name, mk_thre
 void mk_async_threadFini( mk_thread_t *thread ) {
 	(void)axthread_fini( (axthread_t*)thread );
 }
+/* wait for the thread to return on its own, then release it (instead of Fini) */
+void mk_async_threadJoin( mk_thread_t *thread ) {
+#if AXTHREAD_MODEL_WINDOWS
+	(void)WaitForSingleObject( thread->hThread, INFINITE );
+	CloseHandle( thread->hThread );
+	thread->hThread    = NULL;
+	thread->dwThreadId = 0;
+#else
+	(void)pthread_join( thread->thread, (void **)0 );
+	thread->thread = (pthread_t)0;
+#endif
+}
 void mk_async_threadRequestQuit( mk_thread_t *thread ) {
 	axthread_signal_quit( (axthread_t*)thread );
 }
@@ -56,11 +68,22 @@ mk_mutex_t *mk_async_mtxInit( mk_mutex_t *mtx ) {
 mk_mutex_t *mk_async_mtxFini( mk_mutex_t *mtx ) {
 	return (mk_mutex_t*)axth_qmutex_fini( (axth_qmutex_t*)mtx );
 }
+/*
+ *	NOTE: axth_qmutex_acquire() keeps the count raised while it backs off, so two
+ *	`     waiters can keep each other out forever once the holder releases. A
+ *	`     plain test-and-set lock on the same storage does not have that problem.
+ */
 void mk_async_mtxLock( mk_mutex_t *mtx ) {
-	axth_qmutex_acquire( (axth_qmutex_t*)mtx, AXTHREAD_DEFAULT_SPIN_COUNT );
+	axth_u32_t cSpins = 1;
+
+	while( AX_ATOMIC_EXCHANGE_FULL32( mtx, 1 ) != 0 ) {
+		do {
+			axth_backoff( &cSpins, AXTHREAD_DEFAULT_SPIN_COUNT );
+		} while( *mtx != 0 );
+	}
 }
 void mk_async_mtxUnlock( mk_mutex_t *mtx ) {
-	axth_qmutex_release( (axth_qmutex_t*)mtx );
+	(void)AX_ATOMIC_FETCH_AND_FULL32( mtx, 0 );
 }
 
 mk_semaphore_t *mk_async_semInit( mk_semaphore_t *sem, mk_uint32_t base ) {
@@ -39,6 +39,7 @@ typedef int( *mk_thread_func_t )( mk_thread_t *, void * );
 
 mk_thread_t *mk_async_threadInit( mk_thread_t *thread, const char *name, mk_thread_func_t fn, void *arg );
 void         mk_async_threadFini( mk_thread_t * );
+void         mk_async_threadJoin( mk_thread_t * );
 void         mk_async_threadRequestQuit( mk_thread_t * );
 int          mk_async_threadIsQuitRequested( const mk_thread_t * );
 int          mk_async_threadIsRunning( const mk_thread_t * );
@@ -19,7 +19,9 @@
 #include "mk-basic-fileSystem.h"
 #include "mk-basic-logging.h"
 #include "mk-basic-memory.h"
+#include "mk-basic-stats.h"
 #include "mk-basic-stringBuilder.h"
+#include "mk-basic-types.h"
 #include "mk-defs-config.h"
 #include "mk-defs-platform.h"
 #include "mk-frontend.h"
@@ -300,7 +302,26 @@ void mk_com_substExt( char *dst, size_t dstn, const char *src, const char *ext )
 	mk_com_strcpy( &dst[p - src], dstn - ( size_t )( p - src ), ext );
 }
 
-/* internal shell formatted command runner */
+/* convert the slashes of a command's program path for the host's shell */
+void mk_com_fixCommandSlashes( char *cmd ) {
+#if MK_WINDOWS_ENABLED
+	char *p, *e;
+
+	e = strchr( cmd, ' ' );
+	if( !e ) {
+		e = strchr( cmd, '\0' );
+	}
+
+	for( p = &cmd[0]; p && p < e; p = strchr( p, '/' ) ) {
+		if( *p == '/' ) {
+			*p = '\\';
+		}
+	}
+#else
+	(void)cmd;
+#endif
+}
+
 static char *int_prologue_shellfv( const char *format, va_list args ) {
 	static char cmd[ 16384 ];
 
@@ -311,22 +332,7 @@ static char *int_prologue_shellfv( const char *format, va_list args ) {
 	cmd[sizeof( cmd ) - 1] = 0;
 #endif
 
-#if MK_WINDOWS_ENABLED
-	{
-		char *p, *e;
-
-		e = strchr( cmd, ' ' );
-		if( !e ) {
-			e = strchr( cmd, '\0' );
-		}
-
-		for( p = &cmd[0]; p && p < e; p = strchr( p, '/' ) ) {
-			if( *p == '/' ) {
-				*p = '\\';
-			}
-		}
-	}
-#endif
+	mk_com_fixCommandSlashes( cmd );
 
 	if( mk__g_flags & kMkFlag_Verbose_Bit ) {
 		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_CYAN, "> " );
@@ -347,6 +353,7 @@ int mk_com_shellf( const char *format, ... ) {
 	cmd = int_prologue_shellfv( format, args );
 	va_end( args );
 
+	mk_stats_count( kMkStats_Processes, 1 );
 	return system( cmd );
 }
 
@@ -396,6 +403,170 @@ int mk_com_getIntDate( void ) {
 	return ( p->tm_year + 1900 ) * 10000 + ( p->tm_mon + 1 ) * 100 + p->tm_mday;
 }
 
+/* retrieve a monotonic time in nanoseconds, for measuring how long things take */
+mk_uint64_t mk_com_getTimeNs( void ) {
+#if MK_WINDOWS_ENABLED
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER t;
+
+	if( !freq.QuadPart ) {
+		QueryPerformanceFrequency( &freq );
+	}
+	QueryPerformanceCounter( &t );
+
+	return ( mk_uint64_t )( ( double )t.QuadPart*1000000000.0/( double )freq.QuadPart );
+#else
+	struct timespec ts;
+
+	if( clock_gettime( CLOCK_MONOTONIC, &ts ) != 0 ) {
+		return 0;
+	}
+
+	return ( mk_uint64_t )ts.tv_sec*1000000000ULL + ( mk_uint64_t )ts.tv_nsec;
+#endif
+}
+/* retrieve the processor time the calling thread has used, in nanoseconds */
+mk_uint64_t mk_com_getThreadCpuTimeNs( void ) {
+#if MK_WINDOWS_ENABLED
+	FILETIME created, exited, kernel, user;
+
+	if( !GetThreadTimes( GetCurrentThread(), &created, &exited, &kernel, &user ) ) {
+		return 0;
+	}
+
+	return ( ( ( mk_uint64_t )kernel.dwHighDateTime << 32 | kernel.dwLowDateTime ) +
+	         ( ( mk_uint64_t )user.dwHighDateTime << 32 | user.dwLowDateTime ) )*100;
+#else
+	struct timespec ts;
+
+	if( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) != 0 ) {
+		return 0;
+	}
+
+	return ( mk_uint64_t )ts.tv_sec*1000000000ULL + ( mk_uint64_t )ts.tv_nsec;
+#endif
+}
+
+/* continue a 64-bit FNV-1a hash over a block of memory (start with MK_HASH64_INIT) */
+mk_uint64_t mk_com_hash64( mk_uint64_t hash, const void *p, size_t n ) {
+	const unsigned char *s;
+	size_t i;
+
+	MK_ASSERT( p != (const void *)0 || !n );
+
+	s = (const unsigned char *)p;
+	for( i = 0; i < n; ++i ) {
+		hash ^= ( mk_uint64_t )s[i];
+		hash *= ( mk_uint64_t )0x100000001B3ULL;
+	}
+
+	return hash;
+}
+/* continue a 64-bit FNV-1a hash over a string, including its terminator */
+mk_uint64_t mk_com_hashStr64( mk_uint64_t hash, const char *s ) {
+	MK_ASSERT( s != (const char *)0 );
+
+	return mk_com_hash64( hash, (const void *)s, mk_com_strlen( s ) + 1 );
+}
+
+/* xxHash64 (seed 0); reads in native byte order, so the values are only
+   comparable between runs on the same kind of machine */
+#define MK_COM__XXH_P1 ( ( mk_uint64_t )0x9E3779B185EBCA87ULL )
+#define MK_COM__XXH_P2 ( ( mk_uint64_t )0xC2B2AE3D27D4EB4FULL )
+#define MK_COM__XXH_P3 ( ( mk_uint64_t )0x165667B19E3779F9ULL )
+#define MK_COM__XXH_P4 ( ( mk_uint64_t )0x85EBCA77C2B2AE63ULL )
+#define MK_COM__XXH_P5 ( ( mk_uint64_t )0x27D4EB2F165667C5ULL )
+
+static mk_uint64_t mk_com__rotl64( mk_uint64_t x, int r ) {
+	return ( x << r ) | ( x >> ( 64 - r ) );
+}
+static mk_uint64_t mk_com__read64( const unsigned char *p ) {
+	mk_uint64_t x;
+
+	memcpy( (void *)&x, (const void *)p, sizeof( x ) );
+	return x;
+}
+static mk_uint64_t mk_com__xxhRound( mk_uint64_t acc, mk_uint64_t input ) {
+	acc += input*MK_COM__XXH_P2;
+	acc  = mk_com__rotl64( acc, 31 );
+	return acc*MK_COM__XXH_P1;
+}
+static mk_uint64_t mk_com__xxhMerge( mk_uint64_t acc, mk_uint64_t v ) {
+	acc ^= mk_com__xxhRound( 0, v );
+	return acc*MK_COM__XXH_P1 + MK_COM__XXH_P4;
+}
+
+/*
+================
+mk_com_hashContent64
+
+hash a block of memory with xxHash64. This is far quicker than mk_com_hash64()
+on anything bigger than a path, so it's what file contents are hashed with.
+================
+*/
+mk_uint64_t mk_com_hashContent64( const void *p, size_t n ) {
+	const unsigned char *b, *e, *limit;
+	mk_uint64_t v1, v2, v3, v4;
+	mk_uint64_t h;
+	uint32_t k;
+
+	MK_ASSERT( p != (const void *)0 || !n );
+
+	b = (const unsigned char *)p;
+	e = b + n;
+
+	if( n >= 32 ) {
+		limit = e - 32;
+
+		v1 = MK_COM__XXH_P1 + MK_COM__XXH_P2;
+		v2 = MK_COM__XXH_P2;
+		v3 = 0;
+		v4 = 0 - MK_COM__XXH_P1;
+
+		do {
+			v1 = mk_com__xxhRound( v1, mk_com__read64( b +  0 ) );
+			v2 = mk_com__xxhRound( v2, mk_com__read64( b +  8 ) );
+			v3 = mk_com__xxhRound( v3, mk_com__read64( b + 16 ) );
+			v4 = mk_com__xxhRound( v4, mk_com__read64( b + 24 ) );
+			b += 32;
+		} while( b <= limit );
+
+		h = mk_com__rotl64( v1, 1 ) + mk_com__rotl64( v2, 7 ) + mk_com__rotl64( v3, 12 ) + mk_com__rotl64( v4, 18 );
+		h = mk_com__xxhMerge( h, v1 );
+		h = mk_com__xxhMerge( h, v2 );
+		h = mk_com__xxhMerge( h, v3 );
+		h = mk_com__xxhMerge( h, v4 );
+	} else {
+		h = MK_COM__XXH_P5;
+	}
+
+	h += ( mk_uint64_t )n;
+
+	while( e - b >= 8 ) {
+		h ^= mk_com__xxhRound( 0, mk_com__read64( b ) );
+		h  = mk_com__rotl64( h, 27 )*MK_COM__XXH_P1 + MK_COM__XXH_P4;
+		b += 8;
+	}
+	if( e - b >= 4 ) {
+		memcpy( (void *)&k, (const void *)b, sizeof( k ) );
+		h ^= ( mk_uint64_t )k*MK_COM__XXH_P1;
+		h  = mk_com__rotl64( h, 23 )*MK_COM__XXH_P2 + MK_COM__XXH_P3;
+		b += 4;
+	}
+	while( b < e ) {
+		h ^= ( mk_uint64_t )*b++*MK_COM__XXH_P5;
+		h  = mk_com__rotl64( h, 11 )*MK_COM__XXH_P1;
+	}
+
+	h ^= h >> 33;
+	h *= MK_COM__XXH_P2;
+	h ^= h >> 29;
+	h *= MK_COM__XXH_P3;
+	h ^= h >> 32;
+
+	return h;
+}
+
 /* find the end of an argument within a string */
 const char *mk_com_findArgEnd( const char *arg ) {
 	const char *p;
@@ -614,6 +785,7 @@ char *mk_com_readShellf( const char *format, ... ) {
 		mk_log_errorMsg( "Failed to execute program." );
 		return (char *)0;
 	}
+	mk_stats_count( kMkStats_Processes, 1 );
 
 	mk_sb_init( &sb, 8192 );
 	for(;;) {
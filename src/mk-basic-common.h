@@ -24,11 +24,17 @@
 #include "mk-defs-platform.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifndef MK_VA_MINSIZE
 #	define MK_VA_MINSIZE 1024
 #endif
 
+typedef uint64_t mk_uint64_t;
+
+/* starting value for mk_com_hash64() */
+#define MK_HASH64_INIT ( ( mk_uint64_t )0xCBF29CE484222325ULL )
+
 #define mk_com_memory( p_, n_ ) mk_com__memory( (void *)( p_ ), ( size_t )( n_ ), __FILE__, __LINE__, MK_CURFUNC )
 #define mk_com_strdup( cstr_ ) mk_com__strdup( ( cstr_ ), __FILE__, __LINE__, MK_CURFUNC )
 
@@ -50,8 +56,14 @@ const char *mk_com_extractDir( char *buf, size_t n, const char *filename );
 void        mk_com_substExt( char *dst, size_t dstn, const char *src, const char *ext );
 int         mk_com_shellf( const char *format, ... );
 char *      mk_com_readShellf( const char *format, ... );
+void        mk_com_fixCommandSlashes( char *cmd );
 int         mk_com_matchPath( const char *rpath, const char *apath );
 int         mk_com_getIntDate( void );
+mk_uint64_t mk_com_getTimeNs( void );
+mk_uint64_t mk_com_getThreadCpuTimeNs( void );
+mk_uint64_t mk_com_hash64( mk_uint64_t hash, const void *p, size_t n );
+mk_uint64_t mk_com_hashStr64( mk_uint64_t hash, const char *s );
+mk_uint64_t mk_com_hashContent64( const void *p, size_t n );
 
 const char *mk_com_findArgEnd( const char *arg );
 int         mk_com_matchArg( const char *a, const char *b );
@@ -15,6 +15,7 @@
 #include "mk-basic-debug.h"
 
 #include "mk-basic-assert.h"
+#include "mk-basic-async.h"
 #include "mk-basic-fileSystem.h"
 #include "mk-basic-options.h"
 #include "mk-defs-config.h"
@@ -32,6 +33,8 @@
 
 #if MK_DEBUG_ENABLED
 FILE *mk__g_pDebugLog = (FILE *)0;
+/* build steps write to the log from worker threads */
+static mk_mutex_t mk__g_debugLogLock = MK_MUTEX_INITIALIZER;
 #endif
 unsigned mk__g_cDebugIndents = 0;
 
@@ -48,9 +51,9 @@ static void mk_dbg__closeLog_f( void ) {
 }
 #endif
 
-/* write to the debug log, no formatting */
-void mk_dbg_out( const char *str ) {
 #if MK_DEBUG_ENABLED
+/* write to the debug log with the log lock held */
+static void mk_dbg__outLocked( const char *str ) {
 	static const char szTabs[]  = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
 	static const unsigned cTabs = sizeof( szTabs ) - 1;
 	static int didWriteNewline = 1;
@@ -116,6 +119,15 @@ void mk_dbg_out( const char *str ) {
 
 	/* ensure all debug data is written in case we crash right after this */
 	fflush( mk__g_pDebugLog );
+}
+#endif
+
+/* write to the debug log, no formatting */
+void mk_dbg_out( const char *str ) {
+#if MK_DEBUG_ENABLED
+	mk_async_mtxLock( &mk__g_debugLogLock );
+	mk_dbg__outLocked( str );
+	mk_async_mtxUnlock( &mk__g_debugLogLock );
 #else
 	(void)str;
 #endif
@@ -126,6 +138,7 @@ void mk_dbg_outfv( const char *format, va_list args ) {
 #if MK_DEBUG_ENABLED
 	static char buf[65536];
 
+	mk_async_mtxLock( &mk__g_debugLogLock );
 #	if MK_SECLIB
 	vsprintf_s( buf, sizeof( buf ), format, args );
 #	else
@@ -133,7 +146,8 @@ void mk_dbg_outfv( const char *format, va_list args ) {
 	buf[sizeof( buf ) - 1] = '\0';
 #	endif
 
-	mk_dbg_out( buf );
+	mk_dbg__outLocked( buf );
+	mk_async_mtxUnlock( &mk__g_debugLogLock );
 #else
 	(void)format;
 	(void)args;
@@ -15,13 +15,18 @@
 #include "mk-basic-fileSystem.h"
 
 #include "mk-basic-assert.h"
+#include "mk-basic-async.h"
 #include "mk-basic-common.h"
 #include "mk-basic-debug.h"
 #include "mk-basic-logging.h"
+#include "mk-basic-memory.h"
+#include "mk-basic-stats.h"
 #include "mk-basic-stringList.h"
 #include "mk-basic-types.h"
 #include "mk-defs-config.h"
 #include "mk-defs-platform.h"
+#include "mk-frontend.h"
+#include "mk-system-output.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -42,8 +47,64 @@
 #	include "dirent.h" /* user-provided replacement */
 #endif
 
+#if MK_HOST_OS_LINUX
+#	include <fcntl.h>
+#	include <linux/fs.h>
+#	include <sys/ioctl.h>
+#elif MK_HOST_OS_MACOSX
+#	include <sys/clonefile.h>
+#endif
+
 MkStrList mk__g_fs_dirstack = (MkStrList)0;
 
+/*
+ *	stat()/realpath() results, keyed by absolute path. Paths are interned for
+ *	the whole run (entries are never removed, only reset to "unknown"), so a
+ *	probe of the same path from anywhere in the program costs one system call
+ *	at most. Failures are remembered too; most probes are for indicator files
+ *	that don't exist.
+ */
+typedef struct MkFsCacheEntry_s {
+	char *       path;
+	mk_uint64_t  hash;
+
+	/* -1 if not yet known; otherwise the errno from stat() (0 on success) */
+	int          statErr;
+	MkStat_t     st;
+
+	/* -1 if not yet known; otherwise the errno from realpath() */
+	int          realErr;
+	char *       real;
+
+	/* -1 if not yet known; otherwise 0 if `contentHash` is valid */
+	int          hashErr;
+	mk_uint64_t  contentHash;
+
+	/* null until the directory has been listed; never changes afterward */
+	MkFsDirList *list;
+} MkFsCacheEntry;
+
+static struct {
+	mk_mutex_t      lock;
+
+	MkFsCacheEntry *entries;
+	size_t          capacity; /* power of two */
+	size_t          count;
+
+	/* bumped on every invalidation; a lookup that raced with one isn't
+	   stored */
+	size_t          generation;
+
+	/* absolute current directory (with a trailing '/'), or "" if unknown */
+	char            cwd[PATH_MAX];
+
+	size_t          statHits, statMisses;
+	size_t          realHits, realMisses;
+	size_t          listHits, listMisses;
+} mk__g_fs_cache = { MK_MUTEX_INITIALIZER };
+
+static void mk_fs__freeDirList( MkFsDirList *list );
+
 /* initialize file system */
 void mk_fs_init( void ) {
 	atexit( mk_fs_fini );
@@ -51,8 +112,32 @@ void mk_fs_init( void ) {
 
 /* deinitialize file system */
 void mk_fs_fini( void ) {
+	size_t i;
+
 	mk_sl_delete( mk__g_fs_dirstack );
 	mk__g_fs_dirstack = (MkStrList)0;
+
+	mk_dbg_outf( "stat cache: %u hits, %u misses; realpath cache: %u hits, %u misses; directories: %u listed, %u reused; %u paths\n",
+		(unsigned)mk__g_fs_cache.statHits, (unsigned)mk__g_fs_cache.statMisses,
+		(unsigned)mk__g_fs_cache.realHits, (unsigned)mk__g_fs_cache.realMisses,
+		(unsigned)mk__g_fs_cache.listMisses, (unsigned)mk__g_fs_cache.listHits,
+		(unsigned)mk__g_fs_cache.count );
+	if( ( mk__g_flags & kMkFlag_Verbose_Bit ) && mk__g_fs_cache.count > 0 ) {
+		mk_sys_printf( kMkSIO_Err, "stat cache: %u hits, %u misses; realpath cache: %u hits, %u misses; directories: %u listed, %u reused\n",
+			(unsigned)mk__g_fs_cache.statHits, (unsigned)mk__g_fs_cache.statMisses,
+			(unsigned)mk__g_fs_cache.realHits, (unsigned)mk__g_fs_cache.realMisses,
+			(unsigned)mk__g_fs_cache.listMisses, (unsigned)mk__g_fs_cache.listHits );
+	}
+
+	for( i = 0; i < mk__g_fs_cache.capacity; ++i ) {
+		mk__g_fs_cache.entries[ i ].path = (char *)mk_com_memory( (void *)mk__g_fs_cache.entries[ i ].path, 0 );
+		mk__g_fs_cache.entries[ i ].real = (char *)mk_com_memory( (void *)mk__g_fs_cache.entries[ i ].real, 0 );
+		mk_fs__freeDirList( mk__g_fs_cache.entries[ i ].list );
+		mk__g_fs_cache.entries[ i ].list = (MkFsDirList *)0;
+	}
+	mk__g_fs_cache.entries  = (MkFsCacheEntry *)mk_com_memory( (void *)mk__g_fs_cache.entries, 0 );
+	mk__g_fs_cache.capacity = 0;
+	mk__g_fs_cache.count    = 0;
 }
 
 /* retrieve the current directory */
@@ -102,6 +187,10 @@ int mk_fs_enter( const char *path ) {
 
 	mk_sl_pushBack( mk__g_fs_dirstack, cwd );
 
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	mk__g_fs_cache.cwd[ 0 ] = '\0';
+	mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
 	if( chdir( path ) == -1 ) {
 		mk_log_errorMsg( mk_com_va( "chdir(^F\"%s\"^&) failed", path ) );
 		if( chdir( cwd ) == -1 ) {
@@ -125,6 +214,10 @@ void mk_fs_leave( void ) {
 
 	i = mk_sl_getSize( mk__g_fs_dirstack ) - 1;
 
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	mk__g_fs_cache.cwd[ 0 ] = '\0';
+	mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
 	if( chdir( mk_sl_at( mk__g_fs_dirstack, i ) ) == -1 ) {
 		mk_log_fatalError( mk_com_va( "chdir(\"%s\") failed",
 		    mk_sl_at( mk__g_fs_dirstack, i ) ) );
@@ -134,11 +227,391 @@ void mk_fs_leave( void ) {
 	mk_sl_resize( mk__g_fs_dirstack, i );
 }
 
+/* find the cache entry for a path, adding it if needed; must be called with
+   the cache lock held */
+static MkFsCacheEntry *mk_fs__cacheEntry( const char *path ) {
+	MkFsCacheEntry *ent;
+	mk_uint64_t hash;
+	size_t mask, i;
+	char abspath[PATH_MAX];
+
+	/* relative paths depend on the current directory */
+	if( path[0] != '/' && !( path[0] != '\0' && path[1] == ':' ) ) {
+		if( mk__g_fs_cache.cwd[0] == '\0' ) {
+			mk_fs_getCWD( mk__g_fs_cache.cwd, sizeof( mk__g_fs_cache.cwd ) );
+		}
+
+		while( path[0] == '.' && path[1] == '/' ) {
+			path += 2;
+		}
+
+		mk_com_strcpy( abspath, sizeof( abspath ), mk__g_fs_cache.cwd );
+		mk_com_strcat( abspath, sizeof( abspath ), path );
+		path = abspath;
+	}
+
+	hash = mk_com_hashStr64( MK_HASH64_INIT, path );
+
+	/* keep the load factor at or below one half */
+	if( ( mk__g_fs_cache.count + 1 )*2 > mk__g_fs_cache.capacity ) {
+		MkFsCacheEntry *oldEntries;
+		size_t oldCapacity, j;
+
+		oldEntries  = mk__g_fs_cache.entries;
+		oldCapacity = mk__g_fs_cache.capacity;
+
+		mk__g_fs_cache.capacity = oldCapacity ? oldCapacity*2 : 1024;
+		mk__g_fs_cache.entries  = (MkFsCacheEntry *)mk_com_memory( (void *)0, sizeof( MkFsCacheEntry )*mk__g_fs_cache.capacity );
+		memset( (void *)mk__g_fs_cache.entries, 0, sizeof( MkFsCacheEntry )*mk__g_fs_cache.capacity );
+
+		mask = mk__g_fs_cache.capacity - 1;
+		for( j = 0; j < oldCapacity; ++j ) {
+			if( !oldEntries[ j ].path ) {
+				continue;
+			}
+
+			for( i = ( size_t )oldEntries[ j ].hash & mask; mk__g_fs_cache.entries[ i ].path != (char *)0; i = ( i + 1 ) & mask ) {
+			}
+			mk__g_fs_cache.entries[ i ] = oldEntries[ j ];
+		}
+
+		oldEntries = (MkFsCacheEntry *)mk_com_memory( (void *)oldEntries, 0 );
+	}
+
+	mask = mk__g_fs_cache.capacity - 1;
+	for( i = ( size_t )hash & mask; ( ent = &mk__g_fs_cache.entries[ i ] )->path != (char *)0; i = ( i + 1 ) & mask ) {
+		if( ent->hash == hash && !strcmp( ent->path, path ) ) {
+			return ent;
+		}
+	}
+
+	ent->path    = mk_com_dup( (char *)0, path );
+	ent->hash    = hash;
+	ent->statErr = -1;
+	ent->realErr = -1;
+	ent->real    = (char *)0;
+	ent->hashErr = -1;
+	ent->list    = (MkFsDirList *)0;
+
+	++mk__g_fs_cache.count;
+	return ent;
+}
+
+/*
+================
+mk_fs_stat
+
+stat() a path, reusing the result of any earlier call for the same path.
+Returns 1 and fills `dst` (which may be null) if the path exists, or 0 with
+errno set if it doesn't. Safe to call from any thread.
+================
+*/
+int mk_fs_stat( const char *path, MkStat_t *dst ) {
+	MkFsCacheEntry *ent;
+	MkStat_t s;
+	size_t generation;
+	int e;
+
+	MK_ASSERT( path != (const char *)0 );
+
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	ent = mk_fs__cacheEntry( path );
+	if( ent->statErr != -1 ) {
+		++mk__g_fs_cache.statHits;
+		e = ent->statErr;
+		s = ent->st;
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
+		mk_stats_count( kMkStats_StatCacheHits, 1 );
+	} else {
+		++mk__g_fs_cache.statMisses;
+		generation = mk__g_fs_cache.generation;
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
+		/* don't hold the lock across the call; it may be a network round trip */
+		memset( (void *)&s, 0, sizeof( s ) );
+		e = stat( path, &s ) == -1 ? ( errno ? errno : ENOENT ) : 0;
+		mk_stats_count( kMkStats_StatCalls, 1 );
+
+		mk_async_mtxLock( &mk__g_fs_cache.lock );
+		if( generation == mk__g_fs_cache.generation ) {
+			ent = mk_fs__cacheEntry( path );
+			ent->statErr = e;
+			ent->st      = s;
+		}
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+	}
+
+	if( e != 0 ) {
+		errno = e;
+		return 0;
+	}
+
+	if( dst != (MkStat_t *)0 ) {
+		*dst = s;
+	}
+	return 1;
+}
+
+static int mk_fs__hashFile( const char *path, mk_uint64_t *dst ) {
+	unsigned char *data;
+	FILE *fp;
+	long n;
+	int r;
+
+	if( !( fp = fopen( path, "rb" ) ) ) {
+		return 0;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
+
+	r = 0;
+	if( fseek( fp, 0, SEEK_END ) == 0 && ( n = ftell( fp ) ) >= 0 && fseek( fp, 0, SEEK_SET ) == 0 ) {
+		data = (unsigned char *)mk_com_memory( (void *)0, ( size_t )n + 1 );
+
+		if( !n || fread( (void *)data, ( size_t )n, 1, fp ) == 1 ) {
+			*dst = mk_com_hashContent64( (const void *)data, ( size_t )n );
+			r    = 1;
+		}
+
+		data = (unsigned char *)mk_com_memory( (void *)data, 0 );
+	}
+
+	fclose( fp );
+	return r;
+}
+
+/* hash the contents of a file (see mk_com_hashContent64), reading it at most
+   once until it's invalidated; returns 0 if it couldn't be read. Safe to call
+   from any thread. */
+int mk_fs_hashFile( const char *path, mk_uint64_t *dst ) {
+	MkFsCacheEntry *ent;
+	mk_uint64_t hash;
+	size_t generation;
+	int e;
+
+	MK_ASSERT( path != (const char *)0 );
+	MK_ASSERT( dst != (mk_uint64_t *)0 );
+
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	ent = mk_fs__cacheEntry( path );
+	if( ent->hashErr != -1 ) {
+		e    = ent->hashErr;
+		hash = ent->contentHash;
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+	} else {
+		generation = mk__g_fs_cache.generation;
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
+		hash = 0;
+		e    = mk_fs__hashFile( path, &hash ) ? 0 : EIO;
+
+		mk_async_mtxLock( &mk__g_fs_cache.lock );
+		if( generation == mk__g_fs_cache.generation ) {
+			ent = mk_fs__cacheEntry( path );
+			ent->hashErr     = e;
+			ent->contentHash = hash;
+		}
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+	}
+
+	if( e != 0 ) {
+		return 0;
+	}
+
+	*dst = hash;
+	return 1;
+}
+
+/* copy a file's contents to another (which is replaced); returns 0 on
+   failure, in which case `dst` is removed */
+int mk_fs_copyFile( const char *src, const char *dst ) {
+	FILE *in, *out;
+	char buf[ 65536 ];
+	size_t n;
+	int ok;
+
+	MK_ASSERT( src != (const char *)0 );
+	MK_ASSERT( dst != (const char *)0 );
+
+	if( !( in = fopen( src, "rb" ) ) ) {
+		return 0;
+	}
+	if( !( out = fopen( dst, "wb" ) ) ) {
+		fclose( in );
+		return 0;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 2 );
+
+	ok = 1;
+	while( ( n = fread( (void *)buf, 1, sizeof( buf ), in ) ) > 0 ) {
+		if( fwrite( (const void *)buf, n, 1, out ) != 1 ) {
+			ok = 0;
+			break;
+		}
+	}
+	if( ferror( in ) ) {
+		ok = 0;
+	}
+
+	fclose( in );
+	if( fclose( out ) != 0 ) {
+		ok = 0;
+	}
+
+	if( !ok ) {
+		remove( dst );
+	}
+	mk_fs_invalidate( dst );
+
+	return ok;
+}
+
+/* make `dst` a copy-on-write clone of `src` (FICLONE on btrfs/XFS, clonefile()
+   on APFS); returns 0 if the file system or platform can't do that, in which
+   case `dst` is left alone */
+int mk_fs_reflinkFile( const char *src, const char *dst ) {
+#if MK_HOST_OS_LINUX && defined( FICLONE )
+	int in, out;
+	int ok;
+
+	MK_ASSERT( src != (const char *)0 );
+	MK_ASSERT( dst != (const char *)0 );
+
+	if( ( in = open( src, O_RDONLY ) ) == -1 ) {
+		return 0;
+	}
+	if( ( out = open( dst, O_WRONLY|O_CREAT|O_EXCL, 0644 ) ) == -1 ) {
+		close( in );
+		return 0;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 2 );
+
+	ok = +( ioctl( out, FICLONE, in ) == 0 );
+
+	close( in );
+	close( out );
+	if( !ok ) {
+		remove( dst );
+	}
+	mk_fs_invalidate( dst );
+
+	return ok;
+#elif MK_HOST_OS_MACOSX
+	int ok;
+
+	MK_ASSERT( src != (const char *)0 );
+	MK_ASSERT( dst != (const char *)0 );
+
+	ok = +( clonefile( src, dst, 0 ) == 0 );
+	mk_fs_invalidate( dst );
+
+	return ok;
+#else
+	(void)src;
+	(void)dst;
+	return 0;
+#endif
+}
+
+/* make `dst` another name for `src`; returns 0 if that isn't possible (e.g.,
+   they're on different file systems) */
+int mk_fs_hardLinkFile( const char *src, const char *dst ) {
+#if MK_WINDOWS_ENABLED
+	int ok;
+
+	MK_ASSERT( src != (const char *)0 );
+	MK_ASSERT( dst != (const char *)0 );
+
+	ok = +( CreateHardLinkA( dst, src, NULL ) != FALSE );
+	mk_fs_invalidate( dst );
+
+	return ok;
+#else
+	int ok;
+
+	MK_ASSERT( src != (const char *)0 );
+	MK_ASSERT( dst != (const char *)0 );
+
+	ok = +( link( src, dst ) == 0 );
+	mk_fs_invalidate( dst );
+
+	return ok;
+#endif
+}
+
+/*
+================
+mk_fs_transferFile
+
+replace `dst` with the contents of `src`, using the cheapest of the methods
+allowed (any of kMkFsTransfer_*) that works: a reflink, then a hard link, then
+a plain copy. Returns the method that was used, or 0 if none worked.
+
+A hard link shares the file itself, so it's only safe if neither side is ever
+written in place afterward.
+================
+*/
+int mk_fs_transferFile( const char *src, const char *dst, int methods ) {
+	MK_ASSERT( src != (const char *)0 );
+	MK_ASSERT( dst != (const char *)0 );
+
+	remove( dst );
+	mk_fs_invalidate( dst );
+
+	if( ( methods & kMkFsTransfer_Reflink ) && mk_fs_reflinkFile( src, dst ) ) {
+		return kMkFsTransfer_Reflink;
+	}
+	if( ( methods & kMkFsTransfer_HardLink ) && mk_fs_hardLinkFile( src, dst ) ) {
+		return kMkFsTransfer_HardLink;
+	}
+	if( ( methods & kMkFsTransfer_Copy ) && mk_fs_copyFile( src, dst ) ) {
+		return kMkFsTransfer_Copy;
+	}
+
+	return 0;
+}
+
+/* forget what's known about a path; call after creating, writing, or removing
+   it */
+void mk_fs_invalidate( const char *path ) {
+	MkFsCacheEntry *ent;
+	size_t n;
+	char other[PATH_MAX];
+
+	MK_ASSERT( path != (const char *)0 );
+
+	/* "dir" and "dir/" are cached separately */
+	n = mk_com_strlen( path );
+	if( n > 1 && path[n - 1] == '/' ) {
+		mk_com_strncpy( other, sizeof( other ), path, n - 1 );
+	} else if( n + 1 < sizeof( other ) ) {
+		mk_com_strcpy( other, sizeof( other ), path );
+		mk_com_strcat( other, sizeof( other ), "/" );
+	} else {
+		other[0] = '\0';
+	}
+
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	ent = mk_fs__cacheEntry( path );
+	ent->statErr = -1;
+	ent->realErr = -1;
+	ent->hashErr = -1;
+	ent->real    = (char *)mk_com_memory( (void *)ent->real, 0 );
+	if( other[0] != '\0' ) {
+		ent = mk_fs__cacheEntry( other );
+		ent->statErr = -1;
+		ent->realErr = -1;
+		ent->real    = (char *)mk_com_memory( (void *)ent->real, 0 );
+	}
+	++mk__g_fs_cache.generation;
+	mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+}
+
 /* determine whether the path specified is a file. */
 int mk_fs_isFile( const char *path ) {
 	MkStat_t s;
 
-	if( stat( path, &s ) == -1 ) {
+	if( !mk_fs_stat( path, &s ) ) {
 		errno = 0;
 		return 0;
 	}
@@ -153,7 +626,7 @@ int mk_fs_isFile( const char *path ) {
 
 /* determine whether the path specified is a directory. */
 int mk_fs_isDir( const char *path ) {
-	static char temp[PATH_MAX];
+	char temp[PATH_MAX];
 	MkStat_t s;
 	const char *p;
 
@@ -166,7 +639,7 @@ int mk_fs_isDir( const char *path ) {
 		p = path;
 	}
 
-	if( stat( p, &s ) == -1 ) {
+	if( !mk_fs_stat( p, &s ) ) {
 		errno = 0;
 		return 0;
 	}
@@ -213,23 +686,29 @@ void mk_fs_makeDirs( const char *dirs ) {
 		if( *p == '/' || *p == 0 ) {
 			*path = 0;
 
-			errno = 0;
+			/* most of these exist already; only the cache is asked then */
+			if( !mk_fs_isDir( buf ) ) {
+				errno = 0;
 #if MK_WINDOWS_ENABLED
-			mkdir( buf );
+				mkdir( buf );
 #else
-			mkdir( buf, 0740 );
+				mkdir( buf, 0740 );
 #endif
-			if( errno && errno != EEXIST ) {
-				mk_log_fatalError( mk_com_va( "couldn't create directory \"%s\"", buf ) );
-			}
+				if( errno && errno != EEXIST ) {
+					mk_log_fatalError( mk_com_va( "couldn't create directory \"%s\"", buf ) );
+				}
+				errno = 0;
+
+				mk_fs_invalidate( buf );
 
 #if MK_WINDOWS_ENABLED
-			if( ishidden ) {
-				SetFileAttributesA( buf, FILE_ATTRIBUTE_HIDDEN );
-			}
+				if( ishidden ) {
+					SetFileAttributesA( buf, FILE_ATTRIBUTE_HIDDEN );
+				}
 #else
-			((void)ishidden);
+				((void)ishidden);
 #endif
+			}
 
 			if( p[0] == '/' && p[1] == '.' ) {
 				ishidden = 1;
@@ -289,28 +768,53 @@ char *mk_fs_realPath( const char *filename, char *resolvedname, size_t maxn ) {
 }
 #else /*#elif __linux__||__linux||linux*/
 char *mk_fs_realPath( const char *filename, char *resolvedname, size_t maxn ) {
-	static char buf[PATH_MAX + 1];
+	MkFsCacheEntry *ent;
+	size_t generation;
+	char buf[PATH_MAX + 2];
+	int e;
 
-	if( maxn > PATH_MAX ) {
-		if( !realpath( filename, resolvedname ) ) {
-			return (char *)0;
+	MK_ASSERT( filename != (const char *)0 );
+	MK_ASSERT( resolvedname != (char *)0 );
+	MK_ASSERT( maxn > 1 );
+
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	ent = mk_fs__cacheEntry( filename );
+	if( ent->realErr != -1 ) {
+		++mk__g_fs_cache.realHits;
+		if( ( e = ent->realErr ) == 0 ) {
+			mk_com_strcpy( buf, sizeof( buf ), ent->real );
+		}
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+	} else {
+		++mk__g_fs_cache.realMisses;
+		generation = mk__g_fs_cache.generation;
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
+		e = 0;
+		if( !realpath( filename, buf ) ) {
+			e = errno ? errno : ENOENT;
+		} else {
+			buf[PATH_MAX] = 0;
+			if( mk_fs_isDir( buf ) ) {
+				mk_com_strcat( buf, sizeof( buf ), "/" );
+			}
 		}
 
-		resolvedname[PATH_MAX] = 0;
-		return resolvedname;
+		mk_async_mtxLock( &mk__g_fs_cache.lock );
+		if( generation == mk__g_fs_cache.generation ) {
+			ent = mk_fs__cacheEntry( filename );
+			ent->realErr = e;
+			ent->real    = e == 0 ? mk_com_dup( ent->real, buf ) : (char *)mk_com_memory( (void *)ent->real, 0 );
+		}
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
 	}
 
-	if( !realpath( filename, buf ) ) {
+	if( e != 0 ) {
+		errno = e;
 		return (char *)0;
 	}
 
-	buf[PATH_MAX] = 0;
 	strncpy( resolvedname, buf, maxn );
-
-	if( mk_fs_isDir( resolvedname ) ) {
-		mk_com_strcat( resolvedname, maxn, "/" );
-	}
-
 	resolvedname[maxn - 1] = 0;
 	return resolvedname;
 }
@@ -343,6 +847,7 @@ DIR *mk_fs_openDir( const char *path ) {
 	}
 
 	mk_dbg_outf( "\tOK: #%x\n", (unsigned)(size_t)d );
+	mk_stats_count( kMkStats_DirsOpened, 1 );
 	return d;
 }
 DIR *mk_fs_closeDir( DIR *p ) {
@@ -415,12 +920,441 @@ void mk_fs_remove( const char *path ) {
 
 		mk_dbg_outf( "Deleting directory \"%s\"...\n", path );
 		rmdir( path );
+		mk_fs_invalidate( path );
 	} else {
 		errno = 0;
 
 		mk_dbg_outf( "Deleting file \"%s\"...\n", path );
 		remove( path );
+		mk_fs_invalidate( path );
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* directory entries carry their type on most systems, which saves a stat() of
+   every entry just to tell files from directories */
+#if defined( DT_UNKNOWN ) && defined( DT_REG ) && defined( DT_DIR )
+#	define MK__FS_HAS_D_TYPE 1
+#else
+#	define MK__FS_HAS_D_TYPE 0
+#endif
+
+static void mk_fs__freeDirList( MkFsDirList *list ) {
+	size_t i;
+
+	if( !list ) {
+		return;
+	}
+
+	for( i = 0; i < list->numEntries; ++i ) {
+		list->entries[ i ].name = (const char *)mk_com_memory( (void *)list->entries[ i ].name, 0 );
+	}
+
+	list->entries = (MkFsDirEntry *)mk_com_memory( (void *)list->entries, 0 );
+	(void)mk_com_memory( (void *)list, 0 );
+}
+
+static int mk_fs__cmpDirEntries( const void *a, const void *b ) {
+	return strcmp( ( (const MkFsDirEntry *)a )->name, ( (const MkFsDirEntry *)b )->name );
+}
+
+/* read a directory (given without a trailing '/'); safe to call from any
+   thread */
+static MkFsDirList *mk_fs__readDirList( const char *path ) {
+	struct dirent *dp;
+	MkFsDirEntry *ent;
+	MkFsDirList *list;
+	MkStat_t s;
+	size_t capacity;
+	DIR *d;
+	char entpath[PATH_MAX];
+	int e;
+
+	if( !( d = opendir( path[0] != '\0' ? path : "/" ) ) ) {
+		return (MkFsDirList *)0;
+	}
+	mk_stats_count( kMkStats_DirsOpened, 1 );
+
+	list = (MkFsDirList *)mk_com_memory( (void *)0, sizeof( *list ) );
+	list->numEntries = 0;
+	list->entries    = (MkFsDirEntry *)0;
+	capacity         = 0;
+
+	for(;;) {
+		errno = 0;
+		if( !( dp = readdir( d ) ) ) {
+			break;
+		}
+
+		if( !strcmp( dp->d_name, "." ) || !strcmp( dp->d_name, ".." ) ) {
+			continue;
+		}
+
+		if( list->numEntries == capacity ) {
+			capacity      = capacity ? capacity*2 : 16;
+			list->entries = (MkFsDirEntry *)mk_com_memory( (void *)list->entries, sizeof( MkFsDirEntry )*capacity );
+		}
+
+		ent = &list->entries[ list->numEntries++ ];
+		ent->name = mk_com_dup( (char *)0, dp->d_name );
+		ent->type = kMkFsEntry_Other;
+
+#if MK__FS_HAS_D_TYPE
+		if( dp->d_type == DT_REG ) {
+			ent->type = kMkFsEntry_File;
+			continue;
+		}
+		if( dp->d_type == DT_DIR ) {
+			ent->type = kMkFsEntry_Dir;
+			continue;
+		}
+		if( dp->d_type != DT_UNKNOWN && dp->d_type != DT_LNK ) {
+			continue;
+		}
+#endif
+
+		/* links, and file systems that don't fill in the type */
+		mk_com_strcpy( entpath, sizeof( entpath ), path );
+		mk_com_strcat( entpath, sizeof( entpath ), "/" );
+		mk_com_strcat( entpath, sizeof( entpath ), dp->d_name );
+		if( mk_fs_stat( entpath, &s ) ) {
+			if( ( s.st_mode & S_IFMT ) == S_IFREG ) {
+				ent->type = kMkFsEntry_File;
+			} else if( ( s.st_mode & S_IFMT ) == S_IFDIR ) {
+				ent->type = kMkFsEntry_Dir;
+			}
+		}
+	}
+
+	e = errno;
+	closedir( d );
+
+	if( e != 0 ) {
+		mk_fs__freeDirList( list );
+		errno = e;
+		return (MkFsDirList *)0;
+	}
+
+	if( list->numEntries > 1 ) {
+		qsort( (void *)list->entries, list->numEntries, sizeof( MkFsDirEntry ), &mk_fs__cmpDirEntries );
+	}
+
+	return list;
+}
+
+/*
+================
+mk_fs_listDir
+
+retrieve the (sorted) entries of a directory, reading it only if no earlier
+call or walk has. Returns null with errno set if the directory can't be read.
+The listing lives until the program exits. Safe to call from any thread.
+================
+*/
+const MkFsDirList *mk_fs_listDir( const char *path ) {
+	MkFsCacheEntry *ent;
+	MkFsDirList *list, *other;
+	size_t n;
+	char dirpath[PATH_MAX];
+
+	MK_ASSERT( path != (const char *)0 );
+
+	/* "dir" and "dir/" share a listing */
+	mk_com_strcpy( dirpath, sizeof( dirpath ), path[0] != '\0' ? path : "." );
+	n = mk_com_strlen( dirpath );
+	while( n > 1 && dirpath[n - 1] == '/' ) {
+		dirpath[--n] = '\0';
+	}
+
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	ent = mk_fs__cacheEntry( dirpath );
+	if( ( list = ent->list ) != (MkFsDirList *)0 ) {
+		++mk__g_fs_cache.listHits;
+		mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+		return list;
+	}
+	++mk__g_fs_cache.listMisses;
+	mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
+	mk_dbg_outf( "mk_fs_listDir(\"%s\")\n", dirpath );
+	if( !( list = mk_fs__readDirList( strcmp( dirpath, "/" ) != 0 ? dirpath : "" ) ) ) {
+		return (const MkFsDirList *)0;
+	}
+
+	/* another thread may have listed the same directory meanwhile */
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	ent = mk_fs__cacheEntry( dirpath );
+	if( ( other = ent->list ) == (MkFsDirList *)0 ) {
+		ent->list = list;
+	}
+	mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
+	if( other != (MkFsDirList *)0 ) {
+		mk_fs__freeDirList( list );
+		return other;
+	}
+
+	return list;
+}
+
+/* find an entry in a directory listing by name */
+const MkFsDirEntry *mk_fs_findDirEntry( const MkFsDirList *list, const char *name ) {
+	size_t lo, hi, mid;
+	int r;
+
+	MK_ASSERT( list != (const MkFsDirList *)0 );
+	MK_ASSERT( name != (const char *)0 );
+
+	lo = 0;
+	hi = list->numEntries;
+	while( lo < hi ) {
+		mid = lo + ( hi - lo )/2;
+		if( ( r = strcmp( name, list->entries[ mid ].name ) ) == 0 ) {
+			return &list->entries[ mid ];
+		}
+
+		if( r < 0 ) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return (const MkFsDirEntry *)0;
+}
+
+/* skip to the next entry of a listing that `pfnFilter` accepts */
+static size_t mk_fs__nextDirEntry( const MkFsDirList *list, size_t i, MkFsEntryFilterFunc_t pfnFilter ) {
+	while( i < list->numEntries && pfnFilter != (MkFsEntryFilterFunc_t)0 &&
+	    !pfnFilter( list->entries[ i ].name, list->entries[ i ].type ) ) {
+		++i;
+	}
+
+	return i;
+}
+
+/*
+================
+mk_fs_isDirListCurrent
+
+determine whether a directory still has the entries (of the same types) that
+it had when it was listed, considering only those `pfnFilter` accepts, or all
+of them if it's null. A directory that was never listed counts as current,
+one that can no longer be read does not.
+================
+*/
+int mk_fs_isDirListCurrent( const char *path, MkFsEntryFilterFunc_t pfnFilter ) {
+	const MkFsDirList *cached;
+	MkFsDirList *fresh;
+	size_t i, j, n;
+	int r;
+	char dirpath[PATH_MAX];
+
+	MK_ASSERT( path != (const char *)0 );
+
+	mk_com_strcpy( dirpath, sizeof( dirpath ), path[0] != '\0' ? path : "." );
+	n = mk_com_strlen( dirpath );
+	while( n > 1 && dirpath[n - 1] == '/' ) {
+		dirpath[--n] = '\0';
+	}
+
+	mk_async_mtxLock( &mk__g_fs_cache.lock );
+	cached = mk_fs__cacheEntry( dirpath )->list;
+	mk_async_mtxUnlock( &mk__g_fs_cache.lock );
+
+	if( !cached ) {
+		return 1;
 	}
+
+	if( !( fresh = mk_fs__readDirList( strcmp( dirpath, "/" ) != 0 ? dirpath : "" ) ) ) {
+		errno = 0;
+		return 0;
+	}
+
+	i = mk_fs__nextDirEntry( cached, 0, pfnFilter );
+	j = mk_fs__nextDirEntry( fresh, 0, pfnFilter );
+	while( i < cached->numEntries && j < fresh->numEntries ) {
+		if( cached->entries[ i ].type != fresh->entries[ j ].type || strcmp( cached->entries[ i ].name, fresh->entries[ j ].name ) != 0 ) {
+			break;
+		}
+
+		i = mk_fs__nextDirEntry( cached, i + 1, pfnFilter );
+		j = mk_fs__nextDirEntry( fresh, j + 1, pfnFilter );
+	}
+	r = +( i == cached->numEntries && j == fresh->numEntries );
+
+	mk_fs__freeDirList( fresh );
+	return r;
+}
+
+typedef struct MkFsWalkItem_s {
+	char *path;
+	int   state;
+} MkFsWalkItem;
+
+typedef struct MkFsWalk_s {
+	mk_mutex_t     lock;
+	mk_semaphore_t waiter;
+
+	/* directories waiting to be listed (taken from the back) */
+	MkFsWalkItem * items;
+	size_t         numItems;
+	size_t         capacity;
+
+	/* directories queued or being listed; the walk is over at zero */
+	size_t         pending;
+	int            done;
+	unsigned int   numWorkers;
+
+	MkFsWalkFunc_t pfn;
+	void *         userData;
+} MkFsWalk;
+
+/* NOTE: must be called with the walk locked */
+static void mk_fs__walkPush( MkFsWalk *walk, const char *dir, const char *name, int state ) {
+	MkFsWalkItem *item;
+	size_t n;
+	char path[PATH_MAX];
+
+	if( walk->numItems == walk->capacity ) {
+		walk->capacity = walk->capacity ? walk->capacity*2 : 64;
+		walk->items    = (MkFsWalkItem *)mk_com_memory( (void *)walk->items, sizeof( MkFsWalkItem )*walk->capacity );
+	}
+
+	item = &walk->items[ walk->numItems++ ];
+	mk_com_strcpy( path, sizeof( path ), dir );
+	if( name != (const char *)0 ) {
+		n = mk_com_strlen( path );
+		if( n > 0 && path[n - 1] != '/' ) {
+			mk_com_strcat( path, sizeof( path ), "/" );
+		}
+		mk_com_strcat( path, sizeof( path ), name );
+	}
+	item->path  = mk_com_dup( (char *)0, path );
+	item->state = state;
+
+	++walk->pending;
+	(void)mk_async_semRaise( &walk->waiter );
+}
+
+static int mk_fs__walk_f( mk_thread_t *thread, void *userData ) {
+	const MkFsDirList *list;
+	MkFsWalkItem item;
+	MkFsWalk *walk;
+	unsigned int n;
+	size_t i;
+	int state;
+
+	((void)thread);
+	walk = (MkFsWalk *)userData;
+
+	for(;;) {
+		if( !mk_async_semWait( &walk->waiter ) ) {
+			break;
+		}
+
+		mk_async_mtxLock( &walk->lock );
+		if( walk->done ) {
+			mk_async_mtxUnlock( &walk->lock );
+			break;
+		}
+
+		MK_ASSERT_MSG( walk->numItems > 0, "Directory walk queue is out of sync with its semaphore" );
+		item = walk->items[ --walk->numItems ];
+		mk_async_mtxUnlock( &walk->lock );
+
+		state = -1;
+		if( ( list = mk_fs_listDir( item.path ) ) != (const MkFsDirList *)0 ) {
+			state = walk->pfn( item.path, list, item.state, walk->userData );
+		}
+
+		mk_async_mtxLock( &walk->lock );
+		if( state >= 0 ) {
+			for( i = 0; i < list->numEntries; ++i ) {
+				if( list->entries[ i ].type == kMkFsEntry_Dir ) {
+					mk_fs__walkPush( walk, item.path, list->entries[ i ].name, state );
+				}
+			}
+		}
+
+		if( --walk->pending == 0 ) {
+			walk->done = 1;
+			for( n = walk->numWorkers; n > 0; --n ) {
+				(void)mk_async_semRaise( &walk->waiter );
+			}
+		}
+		mk_async_mtxUnlock( &walk->lock );
+
+		item.path = (char *)mk_com_memory( (void *)item.path, 0 );
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+================
+mk_fs_walkDirs
+
+list every directory reachable from `roots` that `pfn` asks for, with up to
+`numThreads` threads, so that later calls to mk_fs_listDir() find them ready.
+`states[i]` is the state `pfn` sees for `roots[i]`; it's then called with
+whatever it returned for a directory when that directory's subdirectories are
+listed. The order in which directories are visited is unspecified.
+================
+*/
+void mk_fs_walkDirs( MkStrList roots, const int *states, MkFsWalkFunc_t pfn, void *userData, unsigned int numThreads ) {
+	mk_thread_t *threads;
+	MkFsWalk walk;
+	unsigned int i;
+	size_t j, n;
+
+	MK_ASSERT( roots != (MkStrList)0 );
+	MK_ASSERT( states != (const int *)0 );
+	MK_ASSERT( pfn != (MkFsWalkFunc_t)0 );
+
+	if( !( n = mk_sl_getSize( roots ) ) ) {
+		return;
+	}
+
+	if( numThreads < 1 ) {
+		numThreads = 1;
+	}
+
+	memset( (void *)&walk, 0, sizeof( walk ) );
+	mk_async_mtxInit( &walk.lock );
+	mk_async_semInit( &walk.waiter, 0 );
+	walk.numWorkers = numThreads;
+	walk.pfn        = pfn;
+	walk.userData   = userData;
+
+	mk_async_mtxLock( &walk.lock );
+	for( j = 0; j < n; ++j ) {
+		mk_fs__walkPush( &walk, mk_sl_at( roots, j ), (const char *)0, states[ j ] );
+	}
+	mk_async_mtxUnlock( &walk.lock );
+
+	if( numThreads == 1 ) {
+		(void)mk_fs__walk_f( (mk_thread_t *)0, (void *)&walk );
+	} else {
+		threads = (mk_thread_t *)mk_mem_alloc( sizeof( *threads )*numThreads );
+
+		for( i = 0; i < numThreads; ++i ) {
+			if( !mk_async_threadInit( &threads[ i ], "mk-fs-walk", &mk_fs__walk_f, (void *)&walk ) ) {
+				mk_log_fatalError( "Failed to create directory walker thread" );
+			}
+		}
+		for( i = 0; i < numThreads; ++i ) {
+			mk_async_threadJoin( &threads[ i ] );
+		}
+
+		mk_mem_dealloc( (void *)threads );
+	}
+
+	walk.items = (MkFsWalkItem *)mk_com_memory( (void *)walk.items, 0 );
+
+	mk_async_semFini( &walk.waiter );
+	mk_async_mtxFini( &walk.lock );
 }
 
 MkLanguage mk_fs_getLanguage( const char *filename ) {
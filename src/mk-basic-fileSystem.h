@@ -20,8 +20,19 @@
  *	========================================================================
  *	This code deals with various file system related subjects. This includes
  *	making directories and finding where the executable is, etc.
+ *
+ *	stat() and realpath() results, and the hashes of file contents, are
+ *	cached for the whole run and shared by all threads; anything that
+ *	creates, writes, or removes a file that may have been looked at already
+ *	must call mk_fs_invalidate() on it.
+ *
+ *	Directory listings are cached the same way, but are snapshots: they're
+ *	read at most once per run, sorted by name (so whatever is built from them
+ *	comes out in the same order every time), and never change afterward.
+ *	mk_fs_walkDirs() fills that cache for whole trees from several threads.
  */
 
+#include "mk-basic-common.h"
 #include "mk-basic-stringList.h"
 #include "mk-basic-types.h"
 
@@ -39,16 +50,64 @@ void mk_fs_fini( void );
 char *mk_fs_getCWD( char *cwd, size_t n );
 int   mk_fs_enter( const char *path );
 void  mk_fs_leave( void );
+int   mk_fs_stat( const char *path, MkStat_t *dst );
+void  mk_fs_invalidate( const char *path );
 int   mk_fs_isFile( const char *path );
 int   mk_fs_isDir( const char *path );
 void  mk_fs_makeDirs( const char *dirs );
 char *mk_fs_realPath( const char *filename, char *resolvedname, size_t maxn );
+int   mk_fs_hashFile( const char *path, mk_uint64_t *dst );
+int   mk_fs_copyFile( const char *src, const char *dst );
+int   mk_fs_reflinkFile( const char *src, const char *dst );
+int   mk_fs_hardLinkFile( const char *src, const char *dst );
+
+/* ways mk_fs_transferFile() may put a file in place, cheapest first */
+typedef enum MkFsTransfer_e {
+	kMkFsTransfer_Reflink  = 0x1,
+	kMkFsTransfer_HardLink = 0x2,
+	kMkFsTransfer_Copy     = 0x4,
+
+	kMkFsTransfer_Any      = 0x7
+} MkFsTransfer;
+
+int   mk_fs_transferFile( const char *src, const char *dst, int methods );
 
 DIR *          mk_fs_openDir( const char *path );
 DIR *          mk_fs_closeDir( DIR *p );
 struct dirent *mk_fs_readDir( DIR *d );
 void           mk_fs_remove( const char *path );
 
+/* what a directory entry is; symbolic links are followed */
+typedef enum MkFsEntryType_e {
+	kMkFsEntry_Other,
+	kMkFsEntry_File,
+	kMkFsEntry_Dir
+} MkFsEntryType;
+
+typedef struct MkFsDirEntry_s {
+	const char *  name;
+	MkFsEntryType type;
+} MkFsDirEntry;
+
+/* the entries of a directory, excluding "." and "..", sorted by name */
+typedef struct MkFsDirList_s {
+	size_t        numEntries;
+	MkFsDirEntry *entries;
+} MkFsDirList;
+
+/* called by mk_fs_walkDirs() for each directory listed, possibly from several
+   threads at once; returns the state to list the subdirectories with, or -1
+   to leave them alone */
+typedef int ( *MkFsWalkFunc_t )( const char *path, const MkFsDirList *list, int state, void *userData );
+
+/* selects the directory entries mk_fs_isDirListCurrent() compares */
+typedef int ( *MkFsEntryFilterFunc_t )( const char *name, MkFsEntryType type );
+
+const MkFsDirList * mk_fs_listDir( const char *path );
+const MkFsDirEntry *mk_fs_findDirEntry( const MkFsDirList *list, const char *name );
+void                mk_fs_walkDirs( MkStrList roots, const int *states, MkFsWalkFunc_t pfn, void *userData, unsigned int numThreads );
+int                 mk_fs_isDirListCurrent( const char *path, MkFsEntryFilterFunc_t pfnFilter );
+
 typedef enum MkLanguage_e {
 	kMkLanguage_Unknown,
 
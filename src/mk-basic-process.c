@@ -0,0 +1,499 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#if defined( __linux__ ) && !defined( _GNU_SOURCE )
+/* for sched_setaffinity() */
+#	define _GNU_SOURCE 1
+#endif
+#include "mk-basic-process.h"
+
+#include "mk-basic-assert.h"
+#include "mk-basic-async.h"
+#include "mk-basic-common.h"
+#include "mk-basic-memory.h"
+#include "mk-basic-stats.h"
+#include "mk-basic-stringBuilder.h"
+#include "mk-basic-stringList.h"
+#include "mk-defs-config.h"
+#include "mk-defs-platform.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !MK_WINDOWS_ENABLED
+#	include <fcntl.h>
+#	include <poll.h>
+#	include <signal.h>
+#	include <spawn.h>
+#	include <sys/resource.h>
+#	include <sys/time.h>
+#	include <sys/types.h>
+#	include <sys/wait.h>
+#	include <unistd.h>
+
+extern char **environ;
+#endif
+#if MK_HOST_OS_LINUX
+#	include <sched.h>
+#endif
+
+/* initialize a result structure */
+void mk_proc_init( MkProcResult *result ) {
+	MK_ASSERT( result != (MkProcResult *)0 );
+
+	result->exitStatus = -1;
+	result->output     = (char *)0;
+	result->userTime   = 0.0;
+	result->systemTime = 0.0;
+	result->maxRSS     = 0;
+	result->timedOut   = 0;
+}
+/* release the memory held by a result structure */
+void mk_proc_fini( MkProcResult *result ) {
+	MK_ASSERT( result != (MkProcResult *)0 );
+
+	result->output = (char *)mk_com_memory( (void *)result->output, 0 );
+}
+
+/*
+================
+mk_proc_splitArgs
+
+split a command line into its arguments, following the quoting rules of the
+POSIX shell (single quotes, double quotes, and backslashes). Returns 0 if the
+command line needs an actual shell to be run -- i.e., it uses redirection,
+pipes, variables, globs, or the like -- or 1 on success.
+================
+*/
+int mk_proc_splitArgs( struct MkStrList_s *dst, const char *cmdline ) {
+	MkStringBuilder sb;
+	const char *p;
+	int inarg;
+
+	MK_ASSERT( dst != (struct MkStrList_s *)0 );
+	MK_ASSERT( cmdline != (const char *)0 );
+
+	mk_sb_init( &sb, 0 );
+	inarg = 0;
+
+	for( p = cmdline; *p != '\0'; ++p ) {
+		if( *p == ' ' || *p == '\t' ) {
+			if( inarg ) {
+				mk_sl_pushBack( dst, mk_sb_done( &sb ) );
+				mk_sb_clear( &sb );
+				inarg = 0;
+			}
+			continue;
+		}
+
+		/* these only mean something at the start of a word */
+		if( !inarg && ( *p == '#' || *p == '~' ) ) {
+			break;
+		}
+
+		if( *p == '\'' ) {
+			const char *e;
+
+			if( !( e = strchr( p + 1, '\'' ) ) ) {
+				break;
+			}
+
+			mk_sb_pushSubstr( &sb, p + 1, e );
+			p     = e;
+			inarg = 1;
+			continue;
+		}
+
+		if( *p == '\"' ) {
+			for( ++p; *p != '\"' && *p != '\0'; ++p ) {
+				if( *p == '$' || *p == '`' ) {
+					break;
+				}
+				if( *p == '\\' && p[1] != '\0' && strchr( "\"\\$`", p[1] ) != (const char *)0 ) {
+					++p;
+				}
+				mk_sb_pushChar( &sb, *p );
+			}
+			if( *p != '\"' ) {
+				break;
+			}
+
+			inarg = 1;
+			continue;
+		}
+
+		if( *p == '\\' ) {
+			if( p[1] == '\0' || p[1] == '\n' ) {
+				break;
+			}
+
+			mk_sb_pushChar( &sb, *++p );
+			inarg = 1;
+			continue;
+		}
+
+		if( strchr( "|&;<>()$`*?[\n", *p ) != (const char *)0 ) {
+			break;
+		}
+
+		mk_sb_pushChar( &sb, *p );
+		inarg = 1;
+	}
+
+	if( *p == '\0' && inarg ) {
+		mk_sl_pushBack( dst, mk_sb_done( &sb ) );
+	}
+
+	sb.buffer = (char *)mk_com_memory( (void *)sb.buffer, 0 );
+	return +( *p == '\0' );
+}
+
+#if !MK_WINDOWS_ENABLED
+/* keeps pipes from being inherited by programs spawned on other threads
+   before they've been marked close-on-exec */
+static mk_mutex_t mk_proc__g_spawnLock = MK_MUTEX_INITIALIZER;
+
+static int mk_proc__spawn( const char *const *argv, int *outfd, pid_t *pid ) {
+	posix_spawn_file_actions_t actions;
+	int fds[ 2 ];
+	int e;
+
+	mk_async_mtxLock( &mk_proc__g_spawnLock );
+	if( pipe( fds ) != 0 ) {
+		e = errno;
+		mk_async_mtxUnlock( &mk_proc__g_spawnLock );
+		return e;
+	}
+
+	e = 0;
+	if( fcntl( fds[0], F_SETFD, FD_CLOEXEC ) != 0 || fcntl( fds[1], F_SETFD, FD_CLOEXEC ) != 0 ) {
+		e = errno;
+	}
+
+	if( !e && ( e = posix_spawn_file_actions_init( &actions ) ) == 0 ) {
+		/* dup2() clears close-on-exec on the duplicate */
+		if( ( e = posix_spawn_file_actions_addopen( &actions, 0, "/dev/null", O_RDONLY, 0 ) ) == 0 &&
+		    ( e = posix_spawn_file_actions_adddup2( &actions, fds[1], 1 ) ) == 0 &&
+		    ( e = posix_spawn_file_actions_adddup2( &actions, fds[1], 2 ) ) == 0 ) {
+			e = posix_spawnp( pid, argv[0], &actions, (const posix_spawnattr_t *)0, (char *const *)argv, environ );
+		}
+
+		posix_spawn_file_actions_destroy( &actions );
+	}
+	mk_async_mtxUnlock( &mk_proc__g_spawnLock );
+
+	close( fds[1] );
+	if( e != 0 ) {
+		close( fds[0] );
+		return e;
+	}
+	mk_stats_count( kMkStats_Processes, 1 );
+
+	*outfd = fds[0];
+	return 0;
+}
+#endif
+
+/*
+================
+mk_proc_run
+
+run a program with the given (null-terminated) argument vector, searching PATH
+for it as needed, and wait for it to finish. Returns the exit status, which is
+also stored in `result` along with the program's output and resource usage.
+================
+*/
+int mk_proc_run( const char *const *argv, MkProcResult *result ) {
+	return mk_proc_runTimed( argv, 0, result );
+}
+
+/*
+================
+mk_proc_runTimed
+
+like mk_proc_run(), but the program is killed if it's still running after
+`timeoutMs` milliseconds (0 for no limit), in which case `result->timedOut` is
+set. Only the program itself is killed; anything it started is left to notice
+that its output went away.
+================
+*/
+int mk_proc_runTimed( const char *const *argv, unsigned int timeoutMs, MkProcResult *result ) {
+#if !MK_WINDOWS_ENABLED
+	MkStringBuilder sb;
+	struct pollfd pfd;
+	struct rusage ru;
+	mk_uint64_t deadline, now;
+	ssize_t n;
+	pid_t pid;
+	char buf[ 4096 ];
+	int status;
+	int wait;
+	int fd;
+	int e;
+
+	MK_ASSERT( argv != (const char *const *)0 && argv[0] != (const char *)0 );
+	MK_ASSERT( result != (MkProcResult *)0 );
+
+	mk_proc_init( result );
+	mk_sb_init( &sb, 0 );
+
+	fd  = -1;
+	pid = 0;
+	if( ( e = mk_proc__spawn( argv, &fd, &pid ) ) != 0 ) {
+		mk_sb_pushStr( &sb, argv[0] );
+		mk_sb_pushStr( &sb, ": " );
+		mk_sb_pushStr( &sb, strerror( e ) );
+		mk_sb_pushChar( &sb, '\n' );
+
+		result->output = mk_sb_done( &sb );
+		return result->exitStatus;
+	}
+
+	deadline = timeoutMs != 0 ? mk_com_getTimeNs() + (mk_uint64_t)timeoutMs*1000000 : 0;
+	for(;;) {
+		if( deadline != 0 ) {
+			now = mk_com_getTimeNs();
+			if( now >= deadline ) {
+				kill( pid, SIGKILL );
+				result->timedOut = 1;
+				break;
+			}
+
+			/* round up so as not to spin through the last millisecond */
+			wait = (int)( ( deadline - now + 999999 )/1000000 );
+
+			pfd.fd      = fd;
+			pfd.events  = POLLIN;
+			pfd.revents = 0;
+			if( poll( &pfd, 1, wait ) <= 0 ) {
+				continue;
+			}
+		}
+
+		n = read( fd, (void *)&buf[0], sizeof( buf ) );
+		if( n > 0 ) {
+			mk_sb_pushSubstr( &sb, &buf[0], &buf[n] );
+		} else if( n == 0 || errno != EINTR ) {
+			break;
+		}
+	}
+	close( fd );
+
+	result->output = mk_sb_done( &sb );
+
+	memset( (void *)&ru, 0, sizeof( ru ) );
+	while( wait4( pid, &status, 0, &ru ) == -1 ) {
+		if( errno != EINTR ) {
+			return result->exitStatus;
+		}
+	}
+
+	if( WIFEXITED( status ) ) {
+		result->exitStatus = WEXITSTATUS( status );
+	} else if( WIFSIGNALED( status ) ) {
+		result->exitStatus = 128 + WTERMSIG( status );
+	}
+
+	result->userTime   = (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec/1000000.0;
+	result->systemTime = (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec/1000000.0;
+# if MK_HOST_OS_MACOSX
+	result->maxRSS     = (long)( ru.ru_maxrss/1024 ); /* bytes on Mac OS X */
+# else
+	result->maxRSS     = (long)ru.ru_maxrss;
+# endif
+
+	return result->exitStatus;
+#else
+	MkStringBuilder sb;
+	const char *const *arg;
+	char *cmdline;
+	int r;
+
+	MK_ASSERT( argv != (const char *const *)0 && argv[0] != (const char *)0 );
+
+	/* FIXME: Use CreateProcess() here instead of going through the shell (and
+	          kill the program through its handle once the time is up) */
+	(void)timeoutMs;
+
+	mk_sb_init( &sb, 0 );
+	for( arg = argv; *arg != (const char *)0; ++arg ) {
+		if( arg != argv ) {
+			mk_sb_pushChar( &sb, ' ' );
+		}
+		if( strpbrk( *arg, " \t" ) != (char *)0 ) {
+			mk_sb_pushChar( &sb, '\"' );
+			mk_sb_pushStr( &sb, *arg );
+			mk_sb_pushChar( &sb, '\"' );
+		} else {
+			mk_sb_pushStr( &sb, *arg );
+		}
+	}
+	cmdline = mk_sb_done( &sb );
+
+	r = mk_proc_runCmdLine( cmdline, result );
+
+	cmdline = (char *)mk_com_memory( (void *)cmdline, 0 );
+	return r;
+#endif
+}
+
+/*
+================
+mk_proc_runCmdLine
+
+run a command line. It's split into arguments and run directly, unless it
+relies on the shell, in which case it's handed to `/bin/sh -c`.
+================
+*/
+int mk_proc_runCmdLine( const char *cmdline, MkProcResult *result ) {
+#if !MK_WINDOWS_ENABLED
+	struct MkStrList_s *args;
+	const char **argv;
+	size_t i, n;
+	int r;
+
+	MK_ASSERT( cmdline != (const char *)0 );
+	MK_ASSERT( result != (MkProcResult *)0 );
+
+	args = mk_sl_new();
+	if( !mk_proc_splitArgs( args, cmdline ) ) {
+		mk_sl_clear( args );
+		mk_sl_pushBack( args, "/bin/sh" );
+		mk_sl_pushBack( args, "-c" );
+		mk_sl_pushBack( args, cmdline );
+	}
+
+	n = mk_sl_getSize( args );
+	if( !n ) {
+		mk_sl_delete( args );
+
+		mk_proc_init( result );
+		result->exitStatus = 0;
+		return 0;
+	}
+
+	argv = (const char **)mk_com_memory( (void *)0, sizeof( *argv )*( n + 1 ) );
+	for( i = 0; i < n; ++i ) {
+		argv[ i ] = mk_sl_at( args, i );
+	}
+	argv[ n ] = (const char *)0;
+
+	r = mk_proc_run( argv, result );
+
+	argv = (const char **)mk_com_memory( (void *)argv, 0 );
+	mk_sl_delete( args );
+
+	return r;
+#else
+	MkStringBuilder sb;
+	FILE *fp;
+	char *fixedcmd;
+	char buf[ 512 ];
+	size_t n;
+
+	MK_ASSERT( cmdline != (const char *)0 );
+	MK_ASSERT( result != (MkProcResult *)0 );
+
+	mk_proc_init( result );
+
+	n = mk_com_strlen( cmdline );
+	fixedcmd = (char *)mk_com_memory( (void *)0, n + sizeof( " 2>&1" ) );
+	memcpy( (void *)fixedcmd, (const void *)cmdline, n );
+	memcpy( (void *)&fixedcmd[n], (const void *)" 2>&1", sizeof( " 2>&1" ) );
+	mk_com_fixCommandSlashes( fixedcmd );
+
+	fp = _popen( fixedcmd, "r" );
+	fixedcmd = (char *)mk_com_memory( (void *)fixedcmd, 0 );
+	if( !fp ) {
+		return result->exitStatus;
+	}
+	mk_stats_count( kMkStats_Processes, 1 );
+
+	mk_sb_init( &sb, 0 );
+	while( ( n = fread( &buf[0], 1, sizeof( buf ), fp ) ) > 0 ) {
+		mk_sb_pushSubstr( &sb, &buf[0], &buf[n] );
+	}
+
+	result->exitStatus = _pclose( fp );
+	result->output     = mk_sb_done( &sb );
+
+	return result->exitStatus;
+#endif
+}
+
+#if MK_HOST_OS_LINUX
+static cpu_set_t mk_proc__g_savedAffinity;
+#endif
+static int mk_proc__g_pinned = 0;
+
+/*
+================
+mk_proc_pinToOneCPU
+
+restrict the calling thread to a single CPU -- and with it the programs it runs
+from then on, as they inherit its affinity -- so that timing them isn't thrown
+off by the scheduler moving them between CPUs. The last CPU the thread may run
+on is picked, being the least likely to be busy with interrupts. Returns 0 if
+that isn't supported here. Call mk_proc_unpin() to undo it.
+================
+*/
+int mk_proc_pinToOneCPU( void ) {
+#if MK_HOST_OS_LINUX
+	cpu_set_t one;
+	int cpu;
+
+	if( mk_proc__g_pinned ) {
+		return 1;
+	}
+
+	if( sched_getaffinity( 0, sizeof( mk_proc__g_savedAffinity ), &mk_proc__g_savedAffinity ) != 0 ) {
+		return 0;
+	}
+
+	for( cpu = CPU_SETSIZE - 1; cpu >= 0; --cpu ) {
+		if( CPU_ISSET( cpu, &mk_proc__g_savedAffinity ) ) {
+			break;
+		}
+	}
+	if( cpu < 0 ) {
+		return 0;
+	}
+
+	CPU_ZERO( &one );
+	CPU_SET( cpu, &one );
+	if( sched_setaffinity( 0, sizeof( one ), &one ) != 0 ) {
+		return 0;
+	}
+
+	mk_proc__g_pinned = 1;
+	return 1;
+#else
+	/* FIXME: SetThreadAffinityMask() isn't inherited by child processes on
+	          Windows; CreateProcess() would need to start them suspended */
+	return 0;
+#endif
+}
+/* let the calling thread run on the CPUs it could before mk_proc_pinToOneCPU() */
+void mk_proc_unpin( void ) {
+	if( !mk_proc__g_pinned ) {
+		return;
+	}
+
+#if MK_HOST_OS_LINUX
+	(void)sched_setaffinity( 0, sizeof( mk_proc__g_savedAffinity ), &mk_proc__g_savedAffinity );
+#endif
+	mk_proc__g_pinned = 0;
+}
@@ -0,0 +1,59 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+ *	========================================================================
+ *	PROCESS RUNNER
+ *	========================================================================
+ *	Runs external programs (compilers, linkers, ...) without going through
+ *	the shell. The program's stdout and stderr are captured together into a
+ *	buffer owned by the caller, so the output of concurrent jobs never
+ *	interleaves. Everything here is safe to call from build worker threads.
+ */
+
+#include "mk-defs-platform.h"
+
+struct MkStrList_s;
+
+typedef struct MkProcResult_s {
+	/* exit code of the program; 128+N if killed by signal N, or -1 if the
+	   program could not be run at all */
+	int exitStatus;
+
+	/* everything written to stdout and stderr (free with mk_proc_fini) */
+	char *output;
+
+	/* resource usage of the program (zero where unsupported) */
+	double userTime;   /* seconds */
+	double systemTime; /* seconds */
+	long   maxRSS;     /* peak resident set size, in KiB */
+
+	/* whether the program was killed for running past its time limit */
+	int timedOut;
+} MkProcResult;
+
+void mk_proc_init( MkProcResult *result );
+void mk_proc_fini( MkProcResult *result );
+
+int mk_proc_splitArgs( struct MkStrList_s *dst, const char *cmdline );
+
+int mk_proc_run( const char *const *argv, MkProcResult *result );
+int mk_proc_runTimed( const char *const *argv, unsigned int timeoutMs, MkProcResult *result );
+int mk_proc_runCmdLine( const char *cmdline, MkProcResult *result );
+
+/* not thread-safe; for the main thread only */
+int  mk_proc_pinToOneCPU( void );
+void mk_proc_unpin( void );
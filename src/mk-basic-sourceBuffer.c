@@ -17,6 +17,7 @@
 #include "mk-basic-assert.h"
 #include "mk-basic-common.h"
 #include "mk-basic-logging.h"
+#include "mk-basic-stats.h"
 #include "mk-defs-config.h"
 #include "mk-defs-platform.h"
 
@@ -333,6 +334,7 @@ static int mk_buf__initFromFile( MkBuffer text, const char *filename ) {
 	if( !f ) {
 		return 0;
 	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
 
 	fseek( f, 0, SEEK_END );
 	n = (size_t)ftell( f );
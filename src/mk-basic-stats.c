@@ -0,0 +1,303 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "mk-basic-stats.h"
+
+#include "mk-basic-assert.h"
+#include "mk-basic-async.h"
+#include "mk-basic-common.h"
+#include "mk-basic-logging.h"
+#include "mk-defs-platform.h"
+#include "mk-system-output.h"
+#include "mk-version.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if !MK_WINDOWS_ENABLED
+#	include <sys/resource.h>
+#	include <sys/time.h>
+#endif
+
+typedef struct MkStatsPhase_s {
+	mk_uint64_t count;
+	mk_uint64_t wall;
+	mk_uint64_t cpu;
+} MkStatsPhase;
+
+static const char *const mk_stats__g_phaseNames[ kMkStats_NumPhases ] = {
+	"discover",
+	"autolink",
+	"depparse",
+	"uptodate",
+	"flags",
+	"compile",
+	"archive",
+	"link",
+	"test",
+	"bench"
+};
+static const char *const mk_stats__g_counterNames[ kMkStats_NumCounters ] = {
+	"stat_calls",
+	"stat_cache_hits",
+	"files_opened",
+	"dirs_opened",
+	"dep_files_parsed",
+	"dep_bytes_parsed",
+	"processes_spawned"
+};
+
+static struct {
+	mk_mutex_t   lock;
+	volatile int enabled;
+	char *       filename; /* JSON goes here; null for a table on stderr */
+
+	/* when the statistics being gathered started */
+	mk_uint64_t wall;
+	mk_uint64_t selfCpu;
+	mk_uint64_t childCpu;
+
+	MkStatsPhase phases[ kMkStats_NumPhases ];
+	mk_uint64_t  counters[ kMkStats_NumCounters ];
+} mk_stats__g = { MK_MUTEX_INITIALIZER };
+
+/* processor time used by mk itself (every thread), or by the programs it ran
+   and has waited for */
+static mk_uint64_t mk_stats__getCpuTimeNs( int children ) {
+#if !MK_WINDOWS_ENABLED
+	struct rusage ru;
+
+	if( getrusage( children ? RUSAGE_CHILDREN : RUSAGE_SELF, &ru ) != 0 ) {
+		return 0;
+	}
+
+	return ( ( mk_uint64_t )ru.ru_utime.tv_sec + ( mk_uint64_t )ru.ru_stime.tv_sec )*1000000000ULL +
+	       ( ( mk_uint64_t )ru.ru_utime.tv_usec + ( mk_uint64_t )ru.ru_stime.tv_usec )*1000ULL;
+#else
+	FILETIME created, exited, kernel, user;
+
+	if( children || !GetProcessTimes( GetCurrentProcess(), &created, &exited, &kernel, &user ) ) {
+		return 0;
+	}
+
+	return ( ( ( mk_uint64_t )kernel.dwHighDateTime << 32 | kernel.dwLowDateTime ) +
+	         ( ( mk_uint64_t )user.dwHighDateTime << 32 | user.dwLowDateTime ) )*100;
+#endif
+}
+/* peak resident set size of mk, or of the largest program it ran, in KiB */
+static long mk_stats__getPeakRSS( int children ) {
+#if !MK_WINDOWS_ENABLED
+	struct rusage ru;
+
+	if( getrusage( children ? RUSAGE_CHILDREN : RUSAGE_SELF, &ru ) != 0 ) {
+		return 0;
+	}
+
+# if MK_HOST_OS_MACOSX
+	return (long)( ru.ru_maxrss/1024 ); /* bytes on Mac OS X */
+# else
+	return (long)ru.ru_maxrss;
+# endif
+#else
+	(void)children;
+	return 0;
+#endif
+}
+
+static void mk_stats__reset( void ) {
+	memset( (void *)&mk_stats__g.phases[0], 0, sizeof( mk_stats__g.phases ) );
+	memset( (void *)&mk_stats__g.counters[0], 0, sizeof( mk_stats__g.counters ) );
+
+	mk_stats__g.wall     = mk_com_getTimeNs();
+	mk_stats__g.selfCpu  = mk_stats__getCpuTimeNs( 0 );
+	mk_stats__g.childCpu = mk_stats__getCpuTimeNs( 1 );
+}
+
+/* start gathering statistics; they're written as JSON to `jsonFilename` ("-"
+   for stdout) or, if that's null, shown as a table on stderr */
+void mk_stats_start( const char *jsonFilename ) {
+	mk_stats__g.filename = jsonFilename != (const char *)0 ? mk_com_dup( mk_stats__g.filename, jsonFilename ) : (char *)0;
+
+	mk_stats__reset();
+	mk_stats__g.enabled = 1;
+}
+int mk_stats_isEnabled( void ) {
+	return mk_stats__g.enabled;
+}
+
+/* time part of a phase on the calling thread (see mk_stats_endPhase()) */
+void mk_stats_beginPhase( MkStatsTimer *timer ) {
+	MK_ASSERT( timer != (MkStatsTimer *)0 );
+
+	if( !mk_stats__g.enabled ) {
+		return;
+	}
+
+	timer->wall = mk_com_getTimeNs();
+	timer->cpu  = mk_com_getThreadCpuTimeNs();
+}
+void mk_stats_endPhase( MkStatsPhase_t phase, const MkStatsTimer *timer ) {
+	MK_ASSERT( timer != (const MkStatsTimer *)0 );
+
+	if( !mk_stats__g.enabled ) {
+		return;
+	}
+
+	mk_stats_addPhase( phase, mk_com_getTimeNs() - timer->wall, mk_com_getThreadCpuTimeNs() - timer->cpu );
+}
+/* add time spent in a phase that was measured some other way */
+void mk_stats_addPhase( MkStatsPhase_t phase, mk_uint64_t wallNs, mk_uint64_t cpuNs ) {
+	MK_ASSERT( (unsigned int)phase < kMkStats_NumPhases );
+
+	if( !mk_stats__g.enabled ) {
+		return;
+	}
+
+	mk_async_mtxLock( &mk_stats__g.lock );
+	mk_stats__g.phases[ phase ].count += 1;
+	mk_stats__g.phases[ phase ].wall  += wallNs;
+	mk_stats__g.phases[ phase ].cpu   += cpuNs;
+	mk_async_mtxUnlock( &mk_stats__g.lock );
+}
+void mk_stats_count( MkStatsCounter_t counter, mk_uint64_t n ) {
+	MK_ASSERT( (unsigned int)counter < kMkStats_NumCounters );
+
+	if( !mk_stats__g.enabled ) {
+		return;
+	}
+
+	mk_async_mtxLock( &mk_stats__g.lock );
+	mk_stats__g.counters[ counter ] += n;
+	mk_async_mtxUnlock( &mk_stats__g.lock );
+}
+
+/* processor time used by the programs mk ran and has waited for so far, for
+   measuring programs run through the shell; only meaningful while no other
+   thread is running programs */
+mk_uint64_t mk_stats_getChildCpuTimeNs( void ) {
+	return mk_stats__getCpuTimeNs( 1 );
+}
+
+static double mk_stats__ms( mk_uint64_t ns ) {
+	return ( double )ns/1000000.0;
+}
+
+static int mk_stats__writeJSON( FILE *fp, mk_uint64_t wall, mk_uint64_t selfCpu, mk_uint64_t childCpu ) {
+	const MkStatsPhase *phase;
+	unsigned int i;
+
+	fprintf( fp, "{\n\t\"mk_version\": \"%s\",\n", MK_VERSION_STR );
+	fprintf( fp, "\t\"wall_ms\": %.3f,\n", mk_stats__ms( wall ) );
+	fprintf( fp, "\t\"cpu_ms\": %.3f,\n", mk_stats__ms( selfCpu ) );
+	fprintf( fp, "\t\"child_cpu_ms\": %.3f,\n", mk_stats__ms( childCpu ) );
+	fprintf( fp, "\t\"peak_rss_kib\": %li,\n", mk_stats__getPeakRSS( 0 ) );
+	fprintf( fp, "\t\"child_peak_rss_kib\": %li,\n", mk_stats__getPeakRSS( 1 ) );
+
+	fprintf( fp, "\t\"phases\": {\n" );
+	for( i = 0; i < kMkStats_NumPhases; ++i ) {
+		phase = &mk_stats__g.phases[ i ];
+		fprintf( fp, "\t\t\"%s\": { \"count\": %llu, \"wall_ms\": %.3f, \"cpu_ms\": %.3f }%s\n",
+			mk_stats__g_phaseNames[ i ], (unsigned long long)phase->count, mk_stats__ms( phase->wall ), mk_stats__ms( phase->cpu ),
+			i + 1 < kMkStats_NumPhases ? "," : "" );
+	}
+	fprintf( fp, "\t},\n" );
+
+	fprintf( fp, "\t\"counters\": {\n" );
+	for( i = 0; i < kMkStats_NumCounters; ++i ) {
+		fprintf( fp, "\t\t\"%s\": %llu%s\n", mk_stats__g_counterNames[ i ], (unsigned long long)mk_stats__g.counters[ i ],
+			i + 1 < kMkStats_NumCounters ? "," : "" );
+	}
+	fprintf( fp, "\t}\n}\n" );
+
+	return +( ferror( fp ) == 0 );
+}
+
+static void mk_stats__printTable( mk_uint64_t wall, mk_uint64_t selfCpu, mk_uint64_t childCpu ) {
+	const MkStatsPhase *phase;
+	const mk_uint64_t *n;
+	unsigned int i;
+
+	n = &mk_stats__g.counters[ 0 ];
+
+	mk_sys_printf( kMkSIO_Err, "\n%-10s %8s %12s %12s\n", "phase", "count", "wall ms", "cpu ms" );
+	for( i = 0; i < kMkStats_NumPhases; ++i ) {
+		phase = &mk_stats__g.phases[ i ];
+		mk_sys_printf( kMkSIO_Err, "%-10s %8llu %12.1f %12.1f\n", mk_stats__g_phaseNames[ i ],
+			(unsigned long long)phase->count, mk_stats__ms( phase->wall ), mk_stats__ms( phase->cpu ) );
+	}
+	mk_sys_printf( kMkSIO_Err, "%-10s %8s %12.1f %12.1f (mk), %.1f (programs)\n", "total", "",
+		mk_stats__ms( wall ), mk_stats__ms( selfCpu ), mk_stats__ms( childCpu ) );
+
+	mk_sys_printf( kMkSIO_Err, "stat() calls: %llu (%llu more cached); files opened: %llu; directories read: %llu\n",
+		(unsigned long long)n[ kMkStats_StatCalls ], (unsigned long long)n[ kMkStats_StatCacheHits ],
+		(unsigned long long)n[ kMkStats_FilesOpened ], (unsigned long long)n[ kMkStats_DirsOpened ] );
+	mk_sys_printf( kMkSIO_Err, "dependency files parsed: %llu (%llu bytes); processes spawned: %llu\n",
+		(unsigned long long)n[ kMkStats_DepFiles ], (unsigned long long)n[ kMkStats_DepBytes ],
+		(unsigned long long)n[ kMkStats_Processes ] );
+	mk_sys_printf( kMkSIO_Err, "peak RSS: %li KiB (mk), %li KiB (largest program)\n",
+		mk_stats__getPeakRSS( 0 ), mk_stats__getPeakRSS( 1 ) );
+}
+
+/*
+================
+mk_stats_report
+
+report the statistics gathered since they were started or last reported,
+then start over (so that each build of `mk --watch` is reported on its own).
+Returns 0 if the JSON file couldn't be written. Must not be called while
+worker threads are running.
+================
+*/
+int mk_stats_report( void ) {
+	mk_uint64_t wall, selfCpu, childCpu;
+	FILE *fp;
+	int r;
+
+	if( !mk_stats__g.enabled ) {
+		return 1;
+	}
+
+	wall     = mk_com_getTimeNs() - mk_stats__g.wall;
+	selfCpu  = mk_stats__getCpuTimeNs( 0 ) - mk_stats__g.selfCpu;
+	childCpu = mk_stats__getCpuTimeNs( 1 ) - mk_stats__g.childCpu;
+
+	r = 1;
+	if( !mk_stats__g.filename ) {
+		mk_stats__printTable( wall, selfCpu, childCpu );
+	} else if( !strcmp( mk_stats__g.filename, "-" ) ) {
+		fflush( stdout );
+		r = mk_stats__writeJSON( stdout, wall, selfCpu, childCpu );
+		fflush( stdout );
+	} else if( ( fp = fopen( mk_stats__g.filename, "w" ) ) != (FILE *)0 ) {
+		r = mk_stats__writeJSON( fp, wall, selfCpu, childCpu );
+		if( fclose( fp ) != 0 ) {
+			r = 0;
+		}
+	} else {
+		r = 0;
+	}
+
+	if( !r ) {
+		mk_log_error( mk_stats__g.filename, 0, (const char *)0, "failed to write the statistics" );
+	}
+
+	mk_stats__reset();
+	return r;
+}
+
+/* stop gathering statistics */
+void mk_stats_fini( void ) {
+	mk_stats__g.enabled  = 0;
+	mk_stats__g.filename = (char *)mk_com_memory( (void *)mk_stats__g.filename, 0 );
+}
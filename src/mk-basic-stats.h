@@ -0,0 +1,82 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+ *	========================================================================
+ *	BUILD STATISTICS
+ *	========================================================================
+ *	`mk --stats` reports where a build spent its time, phase by phase, along
+ *	with how much file system and process work it did. The report is either
+ *	a table on stderr or, with --stats=<file>, JSON meant to be compared
+ *	across runs and versions of mk.
+ *
+ *	A phase's wall time is the sum over every time it was entered, on any
+ *	thread, so phases that run in parallel (compiles) can add up to more
+ *	than the build took. CPU time is that of the thread for phases within
+ *	mk itself, and that of the programs run for the compile, archive, link,
+ *	test, and bench phases. Phases may nest: the up-to-date check includes the
+ *	dependency files it parses.
+ *
+ *	Nothing is recorded until mk_stats_start() is called. Everything here is
+ *	safe to call from build worker threads.
+ */
+
+#include "mk-basic-common.h"
+
+typedef enum {
+	kMkStats_Discover,
+	kMkStats_Autolink,
+	kMkStats_DepParse,
+	kMkStats_UpToDate,
+	kMkStats_Flags,
+	kMkStats_Compile,
+	kMkStats_Archive,
+	kMkStats_Link,
+	kMkStats_Test,
+	kMkStats_Bench,
+
+	kMkStats_NumPhases
+} MkStatsPhase_t;
+
+typedef enum {
+	kMkStats_StatCalls,
+	kMkStats_StatCacheHits,
+	kMkStats_FilesOpened,
+	kMkStats_DirsOpened,
+	kMkStats_DepFiles,
+	kMkStats_DepBytes,
+	kMkStats_Processes,
+
+	kMkStats_NumCounters
+} MkStatsCounter_t;
+
+typedef struct MkStatsTimer_s {
+	mk_uint64_t wall;
+	mk_uint64_t cpu;
+} MkStatsTimer;
+
+void mk_stats_start( const char *jsonFilename );
+int  mk_stats_isEnabled( void );
+
+void mk_stats_beginPhase( MkStatsTimer *timer );
+void mk_stats_endPhase( MkStatsPhase_t phase, const MkStatsTimer *timer );
+void mk_stats_addPhase( MkStatsPhase_t phase, mk_uint64_t wallNs, mk_uint64_t cpuNs );
+void mk_stats_count( MkStatsCounter_t counter, mk_uint64_t n );
+
+mk_uint64_t mk_stats_getChildCpuTimeNs( void );
+
+int  mk_stats_report( void );
+void mk_stats_fini( void );
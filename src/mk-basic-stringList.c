@@ -413,26 +413,16 @@ void mk_sl_makeUnique( MkStrList arr ) {
 		}
 	}
 
-	arr->size = 0;
-	for( i = 0; i < n; ++i ) {
+	/* squeeze out the removed entries; the slots left over at the end must not
+	   keep pointers to strings that moved */
+	for( i = 0, k = 0; i < n; ++i ) {
 		if( arr->data[i] != (char *)0 ) {
-			arr->size = i + 1;
-			continue;
-		}
-
-		j = i + 1;
-		while( j < n && arr->data[j] == (char *)0 ) {
-			++j;
-		}
-
-		if( j == n ) {
-			break;
+			arr->data[k++] = arr->data[i];
 		}
-
-		for( k = 0; j + k < n; ++k ) {
-			arr->data[i + k] = arr->data[j + k];
-		}
-
-		--i;
 	}
+	for( i = k; i < n; ++i ) {
+		arr->data[i] = (char *)0;
+	}
+
+	arr->size = k;
 }
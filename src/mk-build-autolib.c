@@ -26,10 +26,153 @@
 
 #include <stddef.h>
 #include <string.h>
+#if MK_DEBUG_AUTOLINK_INDEX_ENABLED
+#	include <time.h>
+#endif
 
 struct MkAutolink_s *mk__g_al_head = (struct MkAutolink_s *)0;
 struct MkAutolink_s *mk__g_al_tail = (struct MkAutolink_s *)0;
 
+/*
+ *	Headers are indexed by (system, path) in a hash table. An entry's header
+ *	matches any path that ends with it at a directory boundary (see
+ *	mk_com_matchPath()), so a lookup probes the table once for each such tail
+ *	of the path: "/a/b/c.h", "a/b/c.h", "b/c.h", and "c.h". The table is only
+ *	added to as headers are set; when an entry is deleted or its header
+ *	changes, it is rebuilt on the next lookup instead.
+ */
+typedef struct MkAlIndexEntry_s {
+	MkAutolink  al;
+	int         sys;
+	mk_uint64_t hash;
+} MkAlIndexEntry;
+
+static struct {
+	MkAlIndexEntry *entries;
+	size_t          capacity; /* power of two */
+	size_t          count;
+	int             isStale;
+
+	size_t          nextOrder;
+
+#if MK_DEBUG_AUTOLINK_INDEX_ENABLED
+	size_t          numLookups;
+	clock_t         indexedTime;
+	clock_t         scanTime;
+#endif
+} mk__g_al_index;
+
+/* hash a header path for the given system */
+static mk_uint64_t mk_al__hashHeader( int sys, const char *header ) {
+	mk_uint64_t hash;
+#if MK_WINDOWS_ENABLED
+	const char *p;
+	char c;
+#endif
+
+	hash = mk_com_hash64( MK_HASH64_INIT, (const void *)&sys, sizeof( sys ) );
+#if MK_WINDOWS_ENABLED
+	/* paths are matched without regard to case */
+	for( p = header; *p != '\0'; ++p ) {
+		c = *p;
+		if( c >= 'A' && c <= 'Z' ) {
+			c = c - 'A' + 'a';
+		}
+		hash = mk_com_hash64( hash, (const void *)&c, 1 );
+	}
+#else
+	hash = mk_com_hash64( hash, (const void *)header, strlen( header ) );
+#endif
+
+	return hash;
+}
+/* compare two header paths the way mk_com_matchPath() does */
+static int mk_al__headersEqual( const char *a, const char *b ) {
+#if MK_WINDOWS_ENABLED
+	return _stricmp( a, b ) == 0;
+#else
+	return strcmp( a, b ) == 0;
+#endif
+}
+
+/* find the index slot for a header, or the empty slot it would go in */
+static MkAlIndexEntry *mk_al__indexSlot( int sys, const char *header, mk_uint64_t hash ) {
+	MkAlIndexEntry *ent;
+	size_t mask, i;
+
+	mask = mk__g_al_index.capacity - 1;
+	for( i = ( size_t )hash & mask; ( ent = &mk__g_al_index.entries[ i ] )->al != (MkAutolink)0; i = ( i + 1 ) & mask ) {
+		if( ent->hash == hash && ent->sys == sys && mk_al__headersEqual( ent->al->header[sys], header ) ) {
+			break;
+		}
+	}
+
+	return ent;
+}
+
+/* add an entry's header for one system to the index */
+static void mk_al__indexInsert( MkAutolink al, int sys ) {
+	MkAlIndexEntry *ent;
+	mk_uint64_t hash;
+
+	if( !al->header[sys] ) {
+		return;
+	}
+
+	if( ( mk__g_al_index.count + 1 )*2 > mk__g_al_index.capacity ) {
+		MkAlIndexEntry *oldEntries;
+		size_t oldCapacity, i;
+
+		oldEntries  = mk__g_al_index.entries;
+		oldCapacity = mk__g_al_index.capacity;
+
+		mk__g_al_index.capacity = oldCapacity ? oldCapacity*2 : 256;
+		mk__g_al_index.entries  = (MkAlIndexEntry *)mk_com_memory( (void *)0, sizeof( MkAlIndexEntry )*mk__g_al_index.capacity );
+		memset( (void *)mk__g_al_index.entries, 0, sizeof( MkAlIndexEntry )*mk__g_al_index.capacity );
+
+		for( i = 0; i < oldCapacity; ++i ) {
+			if( oldEntries[ i ].al != (MkAutolink)0 ) {
+				*mk_al__indexSlot( oldEntries[ i ].sys, oldEntries[ i ].al->header[oldEntries[ i ].sys], oldEntries[ i ].hash ) = oldEntries[ i ];
+			}
+		}
+
+		oldEntries = (MkAlIndexEntry *)mk_com_memory( (void *)oldEntries, 0 );
+	}
+
+	hash = mk_al__hashHeader( sys, al->header[sys] );
+	ent  = mk_al__indexSlot( sys, al->header[sys], hash );
+
+	if( ent->al != (MkAutolink)0 ) {
+		if( ent->al->order > al->order ) {
+			ent->al = al;
+		}
+		return;
+	}
+
+	ent->al   = al;
+	ent->sys  = sys;
+	ent->hash = hash;
+	++mk__g_al_index.count;
+}
+
+/* rebuild the index from the list of entries */
+static void mk_al__indexRebuild( void ) {
+	MkAutolink al;
+	int sys;
+
+	if( mk__g_al_index.capacity > 0 ) {
+		memset( (void *)mk__g_al_index.entries, 0, sizeof( MkAlIndexEntry )*mk__g_al_index.capacity );
+	}
+	mk__g_al_index.count   = 0;
+	mk__g_al_index.isStale = 0;
+
+	for( al = mk__g_al_head; al; al = al->next ) {
+		for( sys = 0; sys < kMkNumOS; ++sys ) {
+			mk_al__indexInsert( al, sys );
+		}
+	}
+}
+
 /* allocate a new auto-link entry */
 MkAutolink mk_al_new( void ) {
 	MkAutolink al;
@@ -42,6 +185,8 @@ MkAutolink mk_al_new( void ) {
 	}
 	al->lib = (char *)0;
 
+	al->order = mk__g_al_index.nextOrder++;
+
 	al->next = (struct MkAutolink_s *)0;
 	if( ( al->prev = mk__g_al_tail ) != (struct MkAutolink_s *)0 ) {
 		mk__g_al_tail->next = al;
@@ -62,6 +207,9 @@ void mk_al_delete( MkAutolink al ) {
 	}
 
 	for( i = 0; i < kMkNumOS; i++ ) {
+		if( al->header[i] != (char *)0 ) {
+			mk__g_al_index.isStale = 1;
+		}
 		al->header[i] = (char *)mk_com_memory( (void *)al->header[i], 0 );
 	}
 	al->lib = (char *)mk_com_memory( (void *)al->lib, 0 );
@@ -88,6 +236,18 @@ void mk_al_deleteAll( void ) {
 	while( mk__g_al_head ) {
 		mk_al_delete( mk__g_al_head );
 	}
+
+#if MK_DEBUG_AUTOLINK_INDEX_ENABLED
+	if( mk__g_al_index.numLookups > 0 ) {
+		mk_dbg_outf( "autolink index: %u lookups; indexed %.3f ms; scan %.3f ms\n",
+			(unsigned)mk__g_al_index.numLookups,
+			(double)mk__g_al_index.indexedTime*1000.0/(double)CLOCKS_PER_SEC,
+			(double)mk__g_al_index.scanTime*1000.0/(double)CLOCKS_PER_SEC );
+	}
+#endif
+
+	mk__g_al_index.entries = (MkAlIndexEntry *)mk_com_memory( (void *)mk__g_al_index.entries, 0 );
+	memset( (void *)&mk__g_al_index, 0, sizeof( mk__g_al_index ) );
 }
 
 /* set a header for an auto-link entry (determines whether to auto-link) */
@@ -105,7 +265,14 @@ void mk_al_setHeader( MkAutolink al, int sys, const char *header ) {
 		p = (const char *)0;
 	}
 
+	if( al->header[sys] != (char *)0 ) {
+		mk__g_al_index.isStale = 1;
+	}
+
 	al->header[sys] = mk_com_dup( al->header[sys], p );
+	if( !mk__g_al_index.isStale ) {
+		mk_al__indexInsert( al, sys );
+	}
 }
 
 /* set the library an auto-link entry refers to */
@@ -130,13 +297,11 @@ const char *mk_al_getLib( MkAutolink al ) {
 	return al->lib;
 }
 
-/* find an auto-link entry by header and system */
-MkAutolink mk_al_find( int sys, const char *header ) {
+#if MK_DEBUG_AUTOLINK_INDEX_ENABLED
+/* find an auto-link entry the slow way, to check the index against */
+static MkAutolink mk_al__scan( int sys, const char *header ) {
 	MkAutolink al;
 
-	MK_ASSERT( sys >= 0 && sys < kMkNumOS );
-	MK_ASSERT( header != (const char *)0 );
-
 	for( al = mk__g_al_head; al; al = al->next ) {
 		if( !al->header[sys] ) {
 			continue;
@@ -149,6 +314,70 @@ MkAutolink mk_al_find( int sys, const char *header ) {
 
 	return (MkAutolink)0;
 }
+#endif
+
+/* find the first entry (by creation order) whose header for `sys` matches the
+   given path per mk_com_matchPath() */
+static MkAutolink mk_al__findIndexed( int sys, const char *header ) {
+	MkAlIndexEntry *ent;
+	MkAutolink best;
+	const char *tail;
+
+	if( mk__g_al_index.isStale ) {
+		mk_al__indexRebuild();
+	}
+	if( !mk__g_al_index.count ) {
+		return (MkAutolink)0;
+	}
+
+	best = (MkAutolink)0;
+	tail = header;
+	for(;;) {
+		ent = mk_al__indexSlot( sys, tail, mk_al__hashHeader( sys, tail ) );
+		if( ent->al != (MkAutolink)0 && ( !best || ent->al->order < best->order ) ) {
+			best = ent->al;
+		}
+
+		if( !( tail = strchr( tail, '/' ) ) ) {
+			break;
+		}
+		++tail;
+	}
+
+	return best;
+}
+
+/* find an auto-link entry by header and system */
+MkAutolink mk_al_find( int sys, const char *header ) {
+#if MK_DEBUG_AUTOLINK_INDEX_ENABLED
+	MkAutolink al, check;
+	clock_t t0, t1, t2;
+#endif
+
+	MK_ASSERT( sys >= 0 && sys < kMkNumOS );
+	MK_ASSERT( header != (const char *)0 );
+
+#if MK_DEBUG_AUTOLINK_INDEX_ENABLED
+	t0    = clock();
+	al    = mk_al__findIndexed( sys, header );
+	t1    = clock();
+	check = mk_al__scan( sys, header );
+	t2    = clock();
+
+	++mk__g_al_index.numLookups;
+	mk__g_al_index.indexedTime += t1 - t0;
+	mk__g_al_index.scanTime    += t2 - t1;
+
+	if( al != check ) {
+		mk_log_errorMsg( mk_com_va( "autolink index mismatch for \"%s\": \"%s\" vs. \"%s\"", header,
+			al ? al->header[sys] : "(none)", check ? check->header[sys] : "(none)" ) );
+	}
+
+	return check;
+#else
+	return mk_al__findIndexed( sys, header );
+#endif
+}
 
 /* find or create an auto-link entry by header and system */
 MkAutolink mk_al_lookup( int sys, const char *header ) {
@@ -200,7 +429,7 @@ void mk_al_managePackage_r( const char *libname, int sys, const char *incdir ) {
 		mk_dbg_outf( "    mk_al_managePackage_r failed to enter directory\n" );
 		return;
 	}
-	while( ( dp = readdir( d ) ) != (struct dirent *)0 ) {
+	while( ( dp = mk_fs_readDir( d ) ) != (struct dirent *)0 ) {
 		if( mk_fs_isDir( dp->d_name ) ) {
 			mk_al_managePackage_r( libname, sys, dp->d_name );
 			continue;
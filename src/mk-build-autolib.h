@@ -26,6 +26,8 @@
 #include "mk-build-platform.h"
 #include "mk-defs-config.h"
 
+#include <stddef.h>
+
 #if !MK_DEBUG_ENABLED
 #	undef MK_DEBUG_AUTOLIBCONF_ENABLED
 #	define MK_DEBUG_AUTOLIBCONF_ENABLED 0
@@ -35,12 +37,26 @@
 #	endif
 #endif
 
+/* check every indexed lookup against a plain scan of all entries, and report
+   how long each took (in the debug log) */
+#if !MK_DEBUG_ENABLED
+#	undef MK_DEBUG_AUTOLINK_INDEX_ENABLED
+#	define MK_DEBUG_AUTOLINK_INDEX_ENABLED 0
+#else
+#	ifndef MK_DEBUG_AUTOLINK_INDEX_ENABLED
+#		define MK_DEBUG_AUTOLINK_INDEX_ENABLED 0
+#	endif
+#endif
+
 typedef struct MkAutolink_s *MkAutolink;
 
 struct MkAutolink_s {
 	char *header[kMkNumOS];
 	char *lib;
 
+	/* creation order; when several entries match a header the first wins */
+	size_t order;
+
 	struct MkAutolink_s *prev, *next;
 };
 
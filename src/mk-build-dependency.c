@@ -17,74 +17,250 @@
 #include "mk-basic-assert.h"
 #include "mk-basic-common.h"
 #include "mk-basic-debug.h"
-#include "mk-basic-stringList.h"
 #include "mk-defs-config.h"
 
 #include <string.h>
 
+/*
+ *	Dependency lists live in a hash table keyed by the name of the file they
+ *	track (open addressing, linear probing). Every string is interned, so the
+ *	same header listed by a thousand objects is stored once. Strings and list
+ *	records are carved out of large blocks that are only released, all at once,
+ *	by mk_dep_deleteAll().
+ */
+
+#define MK_DEP__BLOCK_SIZE 65536
+#define MK_DEP__ALIGN      ( sizeof( void * )*2 )
+
 struct MkDep_s {
-	char *name;
-	MkStrList deps;
+	const char *name;
+	mk_uint64_t hash;
 
-	struct MkDep_s *prev, *next;
+	const char **deps;
+	size_t numDeps;
+	size_t capDeps;
 };
-MkDep mk__g_dep_head = (MkDep)0;
-MkDep mk__g_dep_tail = (MkDep)0;
 
-/* create a new dependency list */
+typedef struct MkDepBlock_s {
+	struct MkDepBlock_s *next;
+	size_t used;
+	size_t size;
+} MkDepBlock;
+
+typedef struct MkDepString_s {
+	const char *str;
+	mk_uint64_t hash;
+} MkDepString;
+
+static struct {
+	/* dependency lists; null for unused slots */
+	MkDep *table;
+	size_t capacity; /* power of two */
+	size_t count;
+
+	/* interned strings */
+	MkDepString *strings;
+	size_t stringCapacity; /* power of two */
+	size_t stringCount;
+
+	MkDepBlock *blocks;
+} mk__g_dep;
+
+/* allocate memory that lives until mk_dep_deleteAll() */
+static void *mk_dep__alloc( size_t n ) {
+	MkDepBlock *block;
+	size_t header, size;
+	void *p;
+
+	header = ( sizeof( MkDepBlock ) + MK_DEP__ALIGN - 1 ) & ~( MK_DEP__ALIGN - 1 );
+	n      = ( n + MK_DEP__ALIGN - 1 ) & ~( MK_DEP__ALIGN - 1 );
+
+	block = mk__g_dep.blocks;
+	if( !block || block->size - block->used < n ) {
+		size = n > MK_DEP__BLOCK_SIZE/4 ? n : MK_DEP__BLOCK_SIZE;
+
+		block = (MkDepBlock *)mk_com_memory( (void *)0, header + size );
+		block->used = 0;
+		block->size = size;
+
+		/* keep filling the current block if this one is just for a big item */
+		if( size != MK_DEP__BLOCK_SIZE && mk__g_dep.blocks != (MkDepBlock *)0 ) {
+			block->next             = mk__g_dep.blocks->next;
+			mk__g_dep.blocks->next  = block;
+		} else {
+			block->next      = mk__g_dep.blocks;
+			mk__g_dep.blocks = block;
+		}
+	}
+
+	p = (void *)( (char *)block + header + block->used );
+	block->used += n;
+
+	return p;
+}
+
+/* retrieve the single stored copy of a string */
+static const char *mk_dep__intern( const char *str, mk_uint64_t hash ) {
+	MkDepString *ent;
+	size_t mask, i, n;
+	char *p;
+
+	if( ( mk__g_dep.stringCount + 1 )*2 > mk__g_dep.stringCapacity ) {
+		MkDepString *oldStrings;
+		size_t oldCapacity, j;
+
+		oldStrings  = mk__g_dep.strings;
+		oldCapacity = mk__g_dep.stringCapacity;
+
+		mk__g_dep.stringCapacity = oldCapacity ? oldCapacity*2 : 1024;
+		mk__g_dep.strings        = (MkDepString *)mk_com_memory( (void *)0, sizeof( MkDepString )*mk__g_dep.stringCapacity );
+		memset( (void *)mk__g_dep.strings, 0, sizeof( MkDepString )*mk__g_dep.stringCapacity );
+
+		mask = mk__g_dep.stringCapacity - 1;
+		for( j = 0; j < oldCapacity; ++j ) {
+			if( !oldStrings[ j ].str ) {
+				continue;
+			}
+
+			for( i = ( size_t )oldStrings[ j ].hash & mask; mk__g_dep.strings[ i ].str != (const char *)0; i = ( i + 1 ) & mask ) {
+			}
+			mk__g_dep.strings[ i ] = oldStrings[ j ];
+		}
+
+		oldStrings = (MkDepString *)mk_com_memory( (void *)oldStrings, 0 );
+	}
+
+	mask = mk__g_dep.stringCapacity - 1;
+	for( i = ( size_t )hash & mask; ( ent = &mk__g_dep.strings[ i ] )->str != (const char *)0; i = ( i + 1 ) & mask ) {
+		if( ent->hash == hash && !strcmp( ent->str, str ) ) {
+			return ent->str;
+		}
+	}
+
+	n = strlen( str ) + 1;
+	p = (char *)mk_dep__alloc( n );
+	memcpy( (void *)p, (const void *)str, n );
+
+	ent->str  = p;
+	ent->hash = hash;
+	++mk__g_dep.stringCount;
+
+	return p;
+}
+
+/* find the slot a dependency list with the given name is in (or would go) */
+static size_t mk_dep__slot( const char *name, mk_uint64_t hash ) {
+	MkDep dep;
+	size_t mask, i;
+
+	mask = mk__g_dep.capacity - 1;
+	for( i = ( size_t )hash & mask; ( dep = mk__g_dep.table[ i ] ) != (MkDep)0; i = ( i + 1 ) & mask ) {
+		if( dep->hash == hash && !strcmp( dep->name, name ) ) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+/* create a new dependency list, replacing any older list for the same file */
 MkDep mk_dep_new( const char *name ) {
+	mk_uint64_t hash;
+	size_t i;
 	MkDep dep;
 
 	MK_ASSERT( name != (const char *)0 );
 
-	dep = (MkDep)mk_com_memory( (void *)0, sizeof( *dep ) );
+	if( ( mk__g_dep.count + 1 )*2 > mk__g_dep.capacity ) {
+		MkDep *oldTable;
+		size_t oldCapacity, j;
 
-	dep->name = mk_com_strdup( name );
-	dep->deps = mk_sl_new();
+		oldTable    = mk__g_dep.table;
+		oldCapacity = mk__g_dep.capacity;
 
-	dep->next = (MkDep)0;
-	if( ( dep->prev = mk__g_dep_tail ) != (MkDep)0 ) {
-		mk__g_dep_tail->next = dep;
-	} else {
-		mk__g_dep_head = dep;
+		mk__g_dep.capacity = oldCapacity ? oldCapacity*2 : 256;
+		mk__g_dep.table    = (MkDep *)mk_com_memory( (void *)0, sizeof( MkDep )*mk__g_dep.capacity );
+		memset( (void *)mk__g_dep.table, 0, sizeof( MkDep )*mk__g_dep.capacity );
+
+		for( j = 0; j < oldCapacity; ++j ) {
+			if( oldTable[ j ] != (MkDep)0 ) {
+				mk__g_dep.table[ mk_dep__slot( oldTable[ j ]->name, oldTable[ j ]->hash ) ] = oldTable[ j ];
+			}
+		}
+
+		oldTable = (MkDep *)mk_com_memory( (void *)oldTable, 0 );
+	}
+
+	hash = mk_com_hashStr64( MK_HASH64_INIT, name );
+	i    = mk_dep__slot( name, hash );
+
+	if( ( dep = mk__g_dep.table[ i ] ) != (MkDep)0 ) {
+		dep->numDeps = 0;
+		return dep;
 	}
-	mk__g_dep_tail = dep;
+
+	dep = (MkDep)mk_dep__alloc( sizeof( *dep ) );
+
+	dep->name    = mk_dep__intern( name, hash );
+	dep->hash    = hash;
+	dep->deps    = (const char **)0;
+	dep->numDeps = 0;
+	dep->capDeps = 0;
+
+	mk__g_dep.table[ i ] = dep;
+	++mk__g_dep.count;
 
 	return dep;
 }
 
 /* delete a dependency list */
 void mk_dep_delete( MkDep dep ) {
+	size_t mask, i, j, k;
+
 	if( !dep ) {
 		return;
 	}
 
-	dep->name = (char *)mk_com_memory( (void *)dep->name, 0 );
-	mk_sl_delete( dep->deps );
-	dep->deps = (MkStrList)0;
+	mask = mk__g_dep.capacity - 1;
+	i    = mk_dep__slot( dep->name, dep->hash );
+	MK_ASSERT( mk__g_dep.table[ i ] == dep );
 
-	if( dep->prev ) {
-		dep->prev->next = dep->next;
-	}
-	if( dep->next ) {
-		dep->next->prev = dep->prev;
-	}
-
-	if( mk__g_dep_head == dep ) {
-		mk__g_dep_head = dep->next;
-	}
-	if( mk__g_dep_tail == dep ) {
-		mk__g_dep_tail = dep->prev;
+	/* close the gap so later entries in the probe sequence stay reachable */
+	for( j = ( i + 1 ) & mask; mk__g_dep.table[ j ] != (MkDep)0; j = ( j + 1 ) & mask ) {
+		k = ( size_t )mk__g_dep.table[ j ]->hash & mask;
+		if( ( j > i && ( k <= i || k > j ) ) || ( j < i && ( k <= i && k > j ) ) ) {
+			mk__g_dep.table[ i ] = mk__g_dep.table[ j ];
+			i = j;
+		}
 	}
+	mk__g_dep.table[ i ] = (MkDep)0;
+	--mk__g_dep.count;
 
-	mk_com_memory( (void *)dep, 0 );
+	/* the record itself goes away with the rest in mk_dep_deleteAll() */
+	dep->deps    = (const char **)mk_com_memory( (void *)dep->deps, 0 );
+	dep->numDeps = 0;
+	dep->capDeps = 0;
 }
 
 /* delete all dependency lists */
 void mk_dep_deleteAll( void ) {
-	while( mk__g_dep_head ) {
-		mk_dep_delete( mk__g_dep_head );
+	MkDepBlock *block, *next;
+	size_t i;
+
+	for( i = 0; i < mk__g_dep.capacity; ++i ) {
+		if( mk__g_dep.table[ i ] != (MkDep)0 ) {
+			mk__g_dep.table[ i ]->deps = (const char **)mk_com_memory( (void *)mk__g_dep.table[ i ]->deps, 0 );
+		}
+	}
+
+	for( block = mk__g_dep.blocks; block != (MkDepBlock *)0; block = next ) {
+		next = block->next;
+		mk_com_memory( (void *)block, 0 );
 	}
+
+	mk__g_dep.table   = (MkDep *)mk_com_memory( (void *)mk__g_dep.table, 0 );
+	mk__g_dep.strings = (MkDepString *)mk_com_memory( (void *)mk__g_dep.strings, 0 );
+	memset( (void *)&mk__g_dep, 0, sizeof( mk__g_dep ) );
 }
 
 /* retrieve the name of the file a dependency list is tracking */
@@ -99,7 +275,12 @@ void mk_dep_push( MkDep dep, const char *name ) {
 	MK_ASSERT( dep != (MkDep)0 );
 	MK_ASSERT( name != (const char *)0 );
 
-	mk_sl_pushBack( dep->deps, name );
+	if( dep->numDeps == dep->capDeps ) {
+		dep->capDeps = dep->capDeps ? dep->capDeps*2 : 16;
+		dep->deps    = (const char **)mk_com_memory( (void *)dep->deps, sizeof( *dep->deps )*dep->capDeps );
+	}
+
+	dep->deps[ dep->numDeps++ ] = mk_dep__intern( name, mk_com_hashStr64( MK_HASH64_INIT, name ) );
 #if MK_DEBUG_DEPENDENCY_TRACKER_ENABLED
 	mk_dbg_outf( "~ mk_dep_push \"%s\": \"%s\";\n", dep->name, name );
 #endif
@@ -109,7 +290,7 @@ void mk_dep_push( MkDep dep, const char *name ) {
 size_t mk_dep_getSize( MkDep dep ) {
 	MK_ASSERT( dep != (MkDep)0 );
 
-	return mk_sl_getSize( dep->deps );
+	return dep->numDeps;
 }
 
 /* retrieve a dependency from a list */
@@ -117,29 +298,29 @@ const char *mk_dep_at( MkDep dep, size_t i ) {
 	MK_ASSERT( dep != (MkDep)0 );
 	MK_ASSERT( i < mk_dep_getSize( dep ) );
 
-	return mk_sl_at( dep->deps, i );
+	return dep->deps[ i ];
 }
 
 /* find a dependency */
 MkDep mk_dep_find( const char *name ) {
-	MkDep dep;
+	MK_ASSERT( name != (const char *)0 );
 
-	for( dep = mk__g_dep_head; dep; dep = dep->next ) {
-		if( !strcmp( dep->name, name ) ) {
-			return dep;
-		}
+	if( !mk__g_dep.count ) {
+		return (MkDep)0;
 	}
 
-	return (MkDep)0;
+	return mk__g_dep.table[ mk_dep__slot( name, mk_com_hashStr64( MK_HASH64_INIT, name ) ) ];
 }
 
 /* print all known dependencies */
 void mk_dep_debugPrintAll( void ) {
 #if MK_DEBUG_DEPENDENCY_TRACKER_ENABLED
-	MkDep dep;
+	size_t i;
 
-	for( dep = mk__g_dep_head; dep; dep = dep->next ) {
-		mk_dbg_outf( " ** dep: \"%s\"\n", dep->name );
+	for( i = 0; i < mk__g_dep.capacity; ++i ) {
+		if( mk__g_dep.table[ i ] != (MkDep)0 ) {
+			mk_dbg_outf( " ** dep: \"%s\"\n", mk__g_dep.table[ i ]->name );
+		}
 	}
 #endif
 }
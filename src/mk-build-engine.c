@@ -15,45 +15,74 @@
 #include "mk-build-engine.h"
 
 #include "mk-basic-assert.h"
+#include "mk-basic-async.h"
 #include "mk-basic-common.h"
 #include "mk-basic-debug.h"
 #include "mk-basic-fileSystem.h"
 #include "mk-basic-logging.h"
+#include "mk-basic-memory.h"
 #include "mk-basic-options.h"
+#include "mk-basic-process.h"
+#include "mk-basic-stats.h"
+#include "mk-basic-stringBuilder.h"
 #include "mk-basic-stringList.h"
 #include "mk-basic-types.h"
 #include "mk-build-autolib.h"
 #include "mk-build-dependency.h"
 #include "mk-build-library.h"
+#include "mk-build-libraryInterface.h"
 #include "mk-build-makefileDependency.h"
+#include "mk-build-node.h"
+#include "mk-build-objectCache.h"
 #include "mk-build-project.h"
 #include "mk-build-projectFS.h"
+#include "mk-build-seed.h"
+#include "mk-build-stateDatabase.h"
+#include "mk-build-trace.h"
 #include "mk-defs-config.h"
 #include "mk-defs-platform.h"
 #include "mk-frontend.h"
 #include "mk-system-output.h"
 #include "mk-util-git.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 
 MkStrList mk__g_unitTestCompiles = (MkStrList)0;
 MkStrList mk__g_unitTestRuns     = (MkStrList)0;
 MkStrList mk__g_unitTestNames    = (MkStrList)0;
+MkStrList mk__g_unitTestLibs     = (MkStrList)0;
+MkStrList mk__g_unitTestObjs     = (MkStrList)0;
+MkStrList mk__g_unitTestLinks    = (MkStrList)0;
 
-/* initialize unit test arrays */
+MkStrList mk__g_benchCompiles = (MkStrList)0;
+MkStrList mk__g_benchRuns     = (MkStrList)0;
+MkStrList mk__g_benchNames    = (MkStrList)0;
+MkStrList mk__g_benchLibs     = (MkStrList)0;
+
+/* initialize unit test (and benchmark) arrays */
 void mk_bld_initUnitTestArrays( void ) {
 	mk__g_unitTestCompiles = mk_sl_new();
 	mk__g_unitTestRuns     = mk_sl_new();
 	mk__g_unitTestNames    = mk_sl_new();
+	mk__g_unitTestLibs     = mk_sl_new();
+	mk__g_unitTestObjs     = mk_sl_new();
+	mk__g_unitTestLinks    = mk_sl_new();
+
+	mk__g_benchCompiles = mk_sl_new();
+	mk__g_benchRuns     = mk_sl_new();
+	mk__g_benchNames    = mk_sl_new();
+	mk__g_benchLibs     = mk_sl_new();
 }
 
 /* find which libraries are to be autolinked from a source file */
 int mk_bld_findSourceLibs( MkStrList dst, int sys, const char *obj, const char *dep ) {
 	MkAutolink al;
-	size_t i, n;
+	size_t i, n, numLibs;
 	MkDep d;
 	MkLib l;
 
@@ -62,7 +91,7 @@ int mk_bld_findSourceLibs( MkStrList dst, int sys, const char *obj, const char *
 #endif
 
 	d = mk_dep_find( obj );
-	if( !d ) {
+	if( !d && !( d = mk_bdb_loadDeps( obj ) ) ) {
 		if( !mk_mfdep_load( dep ) ) {
 			mk_log_errorMsg( mk_com_va( "failed to read dependency ^F\"%s\"^&", dep ) );
 			return 0;
@@ -76,6 +105,8 @@ int mk_bld_findSourceLibs( MkStrList dst, int sys, const char *obj, const char *
 		}
 	}
 
+	numLibs = mk_sl_getSize( dst );
+
 	n = mk_dep_getSize( d );
 	for( i = 0; i < n; i++ ) {
 		if( !( al = mk_al_find( sys, mk_dep_at( d, i ) ) ) ) {
@@ -110,17 +141,23 @@ int mk_bld_findSourceLibs( MkStrList dst, int sys, const char *obj, const char *
 	}
 
 	mk_sl_makeUnique( dst );
+	if( mk_sl_getSize( dst ) != numLibs ) {
+		mk_lib_invalidateDeps();
+	}
 	return 1;
 }
 
-/* determine whether a source file should be built */
-int mk_bld_shouldCompile( const char *obj ) {
+/* determine whether a source file should be built; `cmd` is the command that
+   would build it */
+int mk_bld_shouldCompile( const char *obj, const char *cmd ) {
 	MkStat_t s, obj_s;
+	mk_uint64_t cmdHash;
 	size_t i, n;
 	MkDep d;
 	char dep[PATH_MAX];
 
 	MK_ASSERT( obj != (const char *)0 );
+	MK_ASSERT( cmd != (const char *)0 );
 
 	if( mk__g_flags & kMkFlag_Rebuild_Bit ) {
 		return 1;
@@ -129,13 +166,24 @@ int mk_bld_shouldCompile( const char *obj ) {
 		return 0;
 	}
 
-	if( stat( obj, &obj_s ) == -1 ) {
+	mk_com_substExt( dep, sizeof( dep ), obj, ".d" );
+	cmdHash = mk_com_hashStr64( MK_HASH64_INIT, cmd );
+
+	/* the build state usually knows without reading the dependency file */
+	switch( mk_bdb_checkObject( obj, dep, cmdHash ) ) {
+	case kMkBdb_UpToDate:
+		return 0;
+	case kMkBdb_OutOfDate:
 		return 1;
+	case kMkBdb_Unknown:
+		break;
 	}
 
-	mk_com_substExt( dep, sizeof( dep ), obj, ".d" );
+	if( !mk_fs_stat( obj, &obj_s ) ) {
+		return 1;
+	}
 
-	if( stat( dep, &s ) == -1 ) {
+	if( !mk_fs_stat( dep, &s ) ) {
 		return 1;
 	}
 
@@ -153,16 +201,15 @@ int mk_bld_shouldCompile( const char *obj ) {
 
 	n = mk_dep_getSize( d );
 	for( i = 0; i < n; i++ ) {
-		if( stat( mk_dep_at( d, i ), &s ) == -1 ) {
-			return 1; /* need recompile for new dependency list; this file is
-			             (potentially) missing */
-		}
-
-		if( obj_s.st_mtime <= s.st_mtime ) {
+		/* need recompile for new dependency list if this file is
+		   (potentially) missing */
+		if( !mk_fs_stat( mk_dep_at( d, i ), &s ) || obj_s.st_mtime <= s.st_mtime ) {
+			mk_dep_delete( d ); /* stale once the object is rebuilt */
 			return 1;
 		}
 	}
 
+	mk_bdb_setObject( obj, cmdHash, d, 0 );
 	return 0; /* no reason to rebuild */
 }
 
@@ -179,7 +226,7 @@ int mk_bld_shouldLink( const char *bin, int numbuilds ) {
 		return 0;
 	}
 
-	if( stat( bin, &bin_s ) == -1 ) {
+	if( !mk_fs_stat( bin, &bin_s ) ) {
 		return 1;
 	}
 
@@ -231,6 +278,20 @@ const char *mk_bld_getCompiler( int iscxx ) {
 	return iscxx ? cxx : cc;
 }
 
+/* retrieve the archiver to make static libraries with */
+const char *mk_bld_getArchiver( void ) {
+	static char ar[128];
+
+	if( ar[0] == '\0' ) {
+		const char *p;
+
+		p = getenv( "AR" );
+		mk_com_strcpy( ar, sizeof( ar ), p != (const char *)0 && *p != '\0' ? p : MK_DEFAULT_ARCHIVER_NAME );
+	}
+
+	return ar;
+}
+
 /* retrieve the warning flags for compilation */
 void mk_bld_getCFlags_warnings( char *flags, size_t nflags ) {
 	static int didinit         = 0;
@@ -657,99 +718,16 @@ void mk_bld_getDeps_r( MkProject proj, MkStrList deparray ) {
 
 /* determine whether a library depends upon another library */
 int mk_bld_doesLibDependOnLib( MkLib mainlib, MkLib deplib ) {
-	static size_t nest      = 0;
-	static char spaces[512] = {
-		'\0',
-	};
-	size_t i, n;
-	MkLib libs[1024];
-
 	MK_ASSERT( mainlib != (MkLib)0 );
 	MK_ASSERT( deplib != (MkLib)0 );
 
-	if( !spaces[0] ) {
-		for( i = 0; i < sizeof( spaces ) - 1; i++ )
-			spaces[i] = ' ';
-
-		spaces[i] = '\0';
-	}
-
-	nest++;
-
-	mk_dbg_outf( "%.*sdoeslibdependonlib_r(\"%s\",\"%s\")\n",
-	    ( nest - 1 ) * 2, spaces, mainlib->name, deplib->name );
-
-	if( nest > 10 ) {
-		nest--;
-		return 0;
-	}
-
-#if 0
-	printf("%s%p %s%p\n", _WIN32 ? "0x" : "",
-		(void *)mainlib, _WIN32 ? "0x" : "", (void *)deplib);
-	printf("%s %s\n", mainlib->name, deplib->name);
-#endif
-
-	if( !mainlib->proj || mainlib == deplib ) {
-		nest--;
-		return 0;
-	}
-
-	mk_sl_makeUnique( mainlib->proj->libs );
-	n = mk_sl_getSize( mainlib->proj->libs );
-	if( n > sizeof( libs ) / sizeof( libs[0] ) ) {
-		mk_log_error( __FILE__, __LINE__, __func__, "n > 1024; too many libraries" );
-		exit( EXIT_FAILURE );
-	}
-
-	/* first check; any immediate dependencies? */
-	for( i = 0; i < n; i++ ) {
-		mk_dbg_outf( "%.*s%.2u of %u \"%s\"\n", ( nest - 1 ) * 2, spaces,
-		    i + 1, n, mk_sl_at( mainlib->proj->libs, i ) );
-		libs[i] = mk_lib_find( mk_sl_at( mainlib->proj->libs, i ) );
-
-		if( libs[i] == deplib ) {
-			mk_dbg_outf( "%.*s\"%s\" depends on \"%s\"\n",
-			    ( nest - 1 ) * 2, spaces, libs[i]->name, deplib->name );
-			nest--;
-			return 1;
-		}
-	}
-
-	/* second check; recursive check */
-	for( i = 0; i < n; i++ ) {
-		if( !mk_bld_doesLibDependOnLib( libs[i], deplib ) ) {
-			continue;
-		}
-
-		nest--;
-		return 1;
-	}
-
-	/* nope; this lib does not depend on that lib */
-	nest--;
-	return 0;
+	return mk_lib_dependsOn( mainlib, deplib );
 }
 
-/* determine which library should come first */
-int mk_bld__cmpLibs( const void *a, const void *b ) {
-#if 0
-	int r;
-	printf("About to compare \"%s\" to \"%s\"\n",
-		(*(MkLib *)a)->name, (*(MkLib *)b)->name);
-	fflush(stdout);
-	r = mk_bld_doesLibDependOnLib(*(MkLib *)a, *(MkLib *)b);
-	printf("mk_bld__cmpLibs \"%s\" \"%s\" -> %i\n",
-		(*(MkLib *)a)->name, (*(MkLib *)b)->name, r);
-	fflush(stdout);
-	return 1 - r;
-#else
-	return 1 - mk_bld_doesLibDependOnLib( *(MkLib *)a, *(MkLib *)b );
-#endif
-}
+/* sort a list of library names into link order (see mk_lib_sortByDeps()) */
 void mk_bld_sortDeps( MkStrList deparray ) {
 	size_t i, n;
-	MkLib libs[1024];
+	MkLib *libs;
 
 	MK_ASSERT( deparray != (MkStrList)0 );
 
@@ -760,14 +738,13 @@ void mk_bld_sortDeps( MkStrList deparray ) {
 	mk_dbg_outf( "Dependency Array:\n" );
 	mk_sl_debugPrint( deparray );
 
-	/* too many libraries? */
 	n = mk_sl_getSize( deparray );
-	if( n > sizeof( libs ) / sizeof( libs[0] ) ) {
-		mk_log_error( __FILE__, __LINE__, __func__, "Too many libraries" );
-		exit( EXIT_FAILURE );
+	if( !n ) {
+		return;
 	}
 
 	/* fill the array, then sort it */
+	libs = (MkLib *)mk_com_memory( (void *)0, sizeof( MkLib )*n );
 	for( i = 0; i < n; i++ ) {
 		libs[i] = mk_lib_find( mk_sl_at( deparray, i ) );
 		if( !libs[i] ) {
@@ -776,15 +753,15 @@ void mk_bld_sortDeps( MkStrList deparray ) {
 		}
 	}
 
-	mk_dbg_outf( "About to sort...\n" );
-	qsort( (void *)libs, n, sizeof( MkLib ), mk_bld__cmpLibs );
-	mk_dbg_outf( "Sorted!\n" );
+	mk_lib_sortByDeps( libs, n );
 
 	/* set the array elements, sorted */
 	for( i = 0; i < n; i++ ) {
 		mk_sl_set( deparray, i, mk_lib_getName( libs[i] ) );
 	}
 
+	libs = (MkLib *)mk_com_memory( (void *)libs, 0 );
+
 	mk_dbg_outf( "Sorted Dependency Array:\n" );
 	mk_sl_debugPrint( deparray );
 }
@@ -927,7 +904,9 @@ const char *mk_bld_getLFlags( MkProject proj, const char *bin, MkStrList objs )
 		mk_com_strcat( flags, sizeof( flags ), mk_com_va( "%s-o \"%s\" ", pszStaticFlags, bin ) );
 		break;
 	case kMkProjTy_StaticLib:
-		mk_com_strcat( flags, sizeof( flags ), mk_com_va( "cr \"%s\" ", bin ) );
+		mk_com_strcat( flags, sizeof( flags ), mk_com_va( "cr%s%s \"%s\" ",
+		    MK_ARCHIVER_DETERMINISTIC_ENABLED ? "D" : "",
+		    ( mk__g_flags & kMkFlag_ThinArchives_Bit ) ? "T" : "", bin ) );
 		break;
 	case kMkProjTy_DynamicLib:
 		mk_com_strcat( flags, sizeof( flags ),
@@ -1126,16 +1105,86 @@ void mk_bld_getBinName( MkProject proj, char *bin, size_t n ) {
 	}
 }
 
+/* find the dependency file written when compiling a unit test */
+static void mk_bld__getTestDepFile( char *dep, size_t n, const char *out ) {
+#if MK_WINDOWS_ENABLED
+	mk_com_substExt( dep, n, out, ".d" );
+#else
+	mk_com_strcpy( dep, n, out );
+	mk_com_strcat( dep, n, ".d" );
+#endif
+}
+
+/* find the program a project's tests are linked into with --combine-tests */
+static void mk_bld__getTestRunner( char *runner, size_t n, MkProject proj ) {
+	mk_com_strcpy( runner, n, mk_com_va( "%s/%s/%s/test/mk-test-runner.test", mk_opt_getObjdirBase(), mk_opt_getConfigName(), mk_prj_getName( proj ) ) );
+#if MK_WINDOWS_ENABLED
+	mk_com_strcat( runner, n, ".exe" );
+#endif
+}
+/* name a test's main() is renamed to with --combine-tests; the test's name
+   picks it so that adding or removing other tests doesn't change it */
+static void mk_bld__getTestMain( char *dst, size_t n, const char *name ) {
+	snprintf( dst, n, "mk_test__main_%.16llx", (unsigned long long)mk_com_hashStr64( MK_HASH64_INIT, name ) );
+}
+
+/*
+================
+mk_bld__getTestFlags
+
+determine the flags a unit test (or benchmark) of a project is compiled with,
+returning the compiler to use; `defs` are the macros that tell it what kind of
+program it is. `projbin` receives the binary of the project to link against if
+it's a library, or "" if it isn't.
+================
+*/
+static const char *mk_bld__getTestFlags( MkProject proj, const char *src, const char *defs, char *flags, size_t nflags, char *projbin, size_t nprojbin ) {
+	const char *tool;
+	size_t i, n;
+
+	flags[0] = '\0';
+
+	mk_bld_getCFlags_warnings( flags, nflags );
+	if( mk_bld_getCFlags_standard( flags, nflags, src ) ) {
+		tool = mk_bld_getCompiler( 1 );
+	} else {
+		tool = mk_bld_getCompiler( ( proj->config & kMkProjCfg_UsesCxx_Bit ) != 0 );
+	}
+	mk_bld_getCFlags_config( flags, nflags, proj->arch );
+	mk_bld_getCFlags_platform( flags, nflags, proj->arch, proj->sys, 1 );
+	mk_com_strcat( flags, nflags, defs );
+	mk_com_strcat( flags, nflags, "-DEXECUTABLE -DMK_EXECUTABLE " );
+	mk_bld_getCFlags_incDirs( flags, nflags );
+	mk_bld_getCFlags_defines( flags, nflags, proj->defs );
+
+	/* retrieve all of the library directories */
+	n = mk_sl_getSize( mk__g_libdirs );
+	for( i = 0; i < n; i++ ) {
+		mk_com_strcat( flags, nflags, mk_com_va( "-L \"%s\" ", mk_sl_at( mk__g_libdirs, i ) ) );
+	}
+
+	/* link to the project directly if it's a library (static or dynamic) */
+	projbin[0] = '\0';
+	switch( mk_prj_getType( proj ) ) {
+	case kMkProjTy_StaticLib:
+	case kMkProjTy_DynamicLib:
+		mk_bld_getBinName( proj, projbin, nprojbin );
+		break;
+	}
+
+	return tool;
+}
+
 /* compile and run a unit test */
 void mk_bld_unitTest( MkProject proj, const char *src ) {
 	static char flags[32768];
 	static char libs[16384], libs_stripped[16384];
 	const char *tool, *libname, *libf;
-	const char *cc, *cxx;
 	MkProject chld;
 	size_t i, j, n;
 	MkLib lib;
 	char out[PATH_MAX], dep[PATH_MAX], projbin[PATH_MAX];
+	char obj[PATH_MAX], runner[PATH_MAX], testmain[64];
 
 	MK_ASSERT( proj != (MkProject)0 );
 	MK_ASSERT( src != (const char *)0 );
@@ -1143,9 +1192,6 @@ void mk_bld_unitTest( MkProject proj, const char *src ) {
 	(void)chld;
 	(void)libs_stripped;
 
-	cc  = mk_bld_getCompiler( 0 );
-	cxx = mk_bld_getCompiler( 1 );
-
 	/* determine the name for the unit test's executable */
 	mk_com_strcpy( out, sizeof( out ), mk_com_va( "%s/%s/%s/test/", mk_opt_getObjdirBase(), mk_opt_getConfigName(), mk_prj_getName( proj ) ) );
 	mk_fs_makeDirs( out );
@@ -1154,44 +1200,10 @@ void mk_bld_unitTest( MkProject proj, const char *src ) {
 
 #if MK_WINDOWS_ENABLED
 	mk_com_strcat( out, sizeof( out ), ".exe" );
-	mk_com_substExt( dep, sizeof( dep ), out, ".d" );
-#else
-	mk_com_strcpy( dep, sizeof( dep ), out );
-	mk_com_strcat( dep, sizeof( dep ), ".d" );
 #endif
+	mk_bld__getTestDepFile( dep, sizeof( dep ), out );
 
-	flags[0] = '\0';
-
-	mk_bld_getCFlags_warnings( flags, sizeof( flags ) );
-	if( mk_bld_getCFlags_standard( flags, sizeof( flags ), src ) ) {
-		tool = cxx;
-	} else {
-		tool = ( proj->config & kMkProjCfg_UsesCxx_Bit ) ? cxx : cc;
-	}
-	mk_bld_getCFlags_config( flags, sizeof( flags ), proj->arch );
-	mk_bld_getCFlags_platform( flags, sizeof( flags ), proj->arch, proj->sys, 1 );
-	mk_com_strcat( flags, sizeof( flags ), "-DTEST -DMK_TEST " );
-	mk_com_strcat( flags, sizeof( flags ), "-DEXECUTABLE -DMK_EXECUTABLE " );
-	mk_bld_getCFlags_incDirs( flags, sizeof( flags ) );
-	mk_bld_getCFlags_defines( flags, sizeof( flags ), proj->defs );
-
-	/* retrieve all of the library directories */
-	n = mk_sl_getSize( mk__g_libdirs );
-	for( i = 0; i < n; i++ ) {
-		mk_com_strcat( flags, sizeof( flags ), mk_com_va( "-L \"%s\" ", mk_sl_at( mk__g_libdirs, i ) ) );
-	}
-
-	/* determine compilation flags: output and source */
-	mk_com_strcat( flags, sizeof( flags ), mk_com_va( "-o \"%s\" \"%s\" ", out, src ) );
-
-	/* link to the project directly if it's a library (static or dynamic) */
-	switch( mk_prj_getType( proj ) ) {
-	case kMkProjTy_StaticLib:
-	case kMkProjTy_DynamicLib:
-		mk_bld_getBinName( proj, projbin, sizeof( projbin ) );
-		mk_com_strcat( flags, sizeof( flags ), mk_com_va( "\"%s\" ", projbin ) );
-		break;
-	}
+	tool = mk_bld__getTestFlags( proj, src, "-DTEST -DMK_TEST ", flags, sizeof( flags ), projbin, sizeof( projbin ) );
 
 	/* now include all of the necessary libs we depend on (we're assuming these
 	   are the same libs the project itself depends on)
@@ -1289,248 +1301,1896 @@ void mk_bld_unitTest( MkProject proj, const char *src ) {
 #	endif
 #endif
 
+	/* with --combine-tests, a project's C tests are compiled to objects and
+	   linked into one runner (see mk_bld__writeTestRunner()); each test's
+	   main() is renamed so that they can all be linked together */
+	if( ( mk__g_flags & kMkFlag_CombineTests_Bit ) && tool == mk_bld_getCompiler( 0 ) ) {
+		mk_com_substExt( obj, sizeof( obj ), out, ".o" );
+		mk_bld__getTestDepFile( dep, sizeof( dep ), obj );
+		mk_bld__getTestRunner( runner, sizeof( runner ), proj );
+
+		mk_com_relPathCWD( out, sizeof( out ), src );
+		mk_bld__getTestMain( testmain, sizeof( testmain ), out );
+
+		mk_sl_pushBack( mk__g_unitTestCompiles, mk_com_va( "%s %s-D\"main=%s\" -MD -MP -MF \"%s\" -c -o \"%s\" \"%s\"",
+		    tool, flags, testmain, dep, obj, src ) );
+		mk_sl_pushBack( mk__g_unitTestLinks, mk_com_va( "%s %s", tool, flags ) );
+		mk_sl_pushBack( mk__g_unitTestRuns, runner );
+		mk_sl_pushBack( mk__g_unitTestObjs, obj );
+		mk_sl_pushBack( mk__g_unitTestLibs, projbin );
+		mk_sl_pushBack( mk__g_unitTestNames, out );
+		return;
+	}
+
 	/* queue unit tests */
-	mk_sl_pushBack( mk__g_unitTestCompiles, mk_com_va( "%s %s", tool, flags ) );
+	mk_sl_pushBack( mk__g_unitTestCompiles, mk_com_va( "%s %s-MD -MP -MF \"%s\" -o \"%s\" \"%s\"%s%s%s", tool, flags, dep, out, src,
+	    *projbin != '\0' ? " \"" : "", projbin, *projbin != '\0' ? "\"" : "" ) );
+	mk_sl_pushBack( mk__g_unitTestLinks, "" );
 	mk_sl_pushBack( mk__g_unitTestRuns, out );
+	mk_sl_pushBack( mk__g_unitTestObjs, "" );
+	mk_sl_pushBack( mk__g_unitTestLibs, projbin );
 
 	mk_com_relPathCWD( out, sizeof( out ), src );
 	mk_sl_pushBack( mk__g_unitTestNames, out );
 }
 
-/* perform each unit test */
-void mk_bld_runTests( void ) {
-	static size_t buffer[65536];
-	MkStrList failedtests;
-	size_t i, n;
-	int e;
-
-	MK_ASSERT( mk_sl_getSize( mk__g_unitTestCompiles ) == mk_sl_getSize( mk__g_unitTestRuns ) );
-	MK_ASSERT( mk_sl_getSize( mk__g_unitTestRuns ) == mk_sl_getSize( mk__g_unitTestNames ) );
-
-	n = mk_sl_getSize( mk__g_unitTestCompiles );
-	if( !n ) {
+/* flags for tuning code to the CPU mk runs on, if the project is built for it */
+static void mk_bld__getCFlags_native( char *flags, size_t nflags, int projarch ) {
+	if( projarch != mk__g_hostCPU ) {
 		return;
 	}
-	MK_ASSERT( n <= sizeof( buffer ) / sizeof( buffer[0] ) );
-	mk_sl_orderedSort( mk__g_unitTestNames, buffer, sizeof( buffer ) / sizeof( buffer[0] ) );
-	mk_sl_indexedSort( mk__g_unitTestCompiles, buffer, n );
-	mk_sl_indexedSort( mk__g_unitTestRuns, buffer, n );
 
-	failedtests = mk_sl_new();
+	switch( projarch ) {
+	case kMkCPU_X86:
+	case kMkCPU_X86_64:
+		mk_com_strcat( flags, nflags, "-march=native " );
+		break;
+	case kMkCPU_ARM:
+	case kMkCPU_AArch64:
+	case kMkCPU_PowerPC:
+		mk_com_strcat( flags, nflags, "-mcpu=native " );
+		break;
+	default:
+		break;
+	}
+}
+
+/* compile and run a benchmark (`mk bench` builds in release mode) */
+void mk_bld_benchmark( MkProject proj, const char *src ) {
+	static char flags[32768];
+	const char *tool;
+	char out[PATH_MAX], dep[PATH_MAX], projbin[PATH_MAX];
 
-	for( i = 0; i < n; i++ ) {
-		/* compile the unit test */
-		if( mk_com_shellf( "%s", mk_sl_at( mk__g_unitTestCompiles, i ) ) != 0 ) {
+	MK_ASSERT( proj != (MkProject)0 );
+	MK_ASSERT( src != (const char *)0 );
+
+	/* determine the name for the benchmark's executable */
+	mk_com_strcpy( out, sizeof( out ), mk_com_va( "%s/%s/%s/bench/", mk_opt_getObjdirBase(), mk_opt_getConfigName(), mk_prj_getName( proj ) ) );
+	mk_fs_makeDirs( out );
+	mk_com_substExt( out, sizeof( out ), mk_com_va( "%s%s", out, strrchr( src, '/' ) + 1 ),
+	    ".bench" );
+
+#if MK_WINDOWS_ENABLED
+	mk_com_strcat( out, sizeof( out ), ".exe" );
+#endif
+	mk_bld__getTestDepFile( dep, sizeof( dep ), out );
+
+	tool = mk_bld__getTestFlags( proj, src, "-DBENCH -DMK_BENCH ", flags, sizeof( flags ), projbin, sizeof( projbin ) );
+	mk_bld__getCFlags_native( flags, sizeof( flags ), proj->arch );
+
+	/* queue benchmarks */
+	mk_sl_pushBack( mk__g_benchCompiles, mk_com_va( "%s %s-MD -MP -MF \"%s\" -o \"%s\" \"%s\"%s%s%s", tool, flags, dep, out, src,
+	    *projbin != '\0' ? " \"" : "", projbin, *projbin != '\0' ? "\"" : "" ) );
+	mk_sl_pushBack( mk__g_benchRuns, out );
+	mk_sl_pushBack( mk__g_benchLibs, projbin );
+
+	mk_com_relPathCWD( out, sizeof( out ), src );
+	mk_sl_pushBack( mk__g_benchNames, out );
+}
+
+/*
+ *	Unit tests are compiled and run on the build's worker threads, with each
+ *	test's run depending on its compile. Everything a test (or its compiler)
+ *	prints is captured, then shown along with its OK/KO line in the order of
+ *	the tests' names -- as soon as that test and every test before it are
+ *	done -- so the report reads the same however the jobs were scheduled.
+ *
+ *	A test is only built and run if it changed since it was last run: its
+ *	compile command, the files its source depends on, or the binary it
+ *	links against. Otherwise its last result stands (see mk_bdb_checkTest()),
+ *	unless --force-tests or --rebuild was given.
+ *
+ *	With --combine-tests, a project's C tests are compiled to objects that
+ *	are all linked into one runner program, which then runs each test by
+ *	name. Only the tests that changed are compiled and run, but the runner
+ *	is relinked with every test's object.
+ */
+typedef struct MkUnitTest_s {
+	struct MkUnitTestRun_s *run;
+
+	const char *name; /* source file, relative to the current directory */
+	const char *cmd;  /* compiles the test */
+	const char *exe;  /* the compiled test, or the runner it's linked into */
+	const char *obj;  /* the test's object if it's linked into a runner */
+	const char *link; /* links the runner, up to the output and objects */
+	const char *lib;  /* the project binary it links against, or "" */
+	const char *key;  /* what the build state records the test under */
+	mk_uint64_t cmdHash;
+
+	int built;        /* whether the test compiled */
+	int done;         /* whether it's ready to be reported */
+	int cached;       /* whether it's unchanged; `passed` says how it went */
+	int passed;
+	char *buildOutput;
+	MkProcResult result;
+	mk_uint64_t wallNs;
+} MkUnitTest;
+
+typedef struct MkUnitTestRun_s {
+	MkUnitTest *tests;
+	size_t numTests;
+	size_t numReported;
+
+	MkStrList failed;
+	mk_mutex_t lock;
+} MkUnitTestRun;
+
+typedef struct MkTestRunner_s {
+	MkUnitTestRun *run;
+	const MkUnitTest *first; /* (for the link command and binary) */
+} MkTestRunner;
+
+/* list a failed test by how to run it again */
+static void mk_bld__pushFailedTest( MkUnitTestRun *run, const MkUnitTest *test ) {
+	char buf[PATH_MAX*2];
+
+	mk_com_strcpy( buf, sizeof( buf ), test->exe );
+	if( *test->obj != '\0' ) {
+		mk_com_strcat( buf, sizeof( buf ), " " );
+		mk_com_strcat( buf, sizeof( buf ), test->name );
+	}
+
+	mk_sl_pushBack( run->failed, buf );
+}
+
+/* show the results of every finished test not yet shown, up to the first one
+   still going; must be called with the run's lock held */
+static void mk_bld__reportTests( MkUnitTestRun *run ) {
+	MkUnitTest *test;
+	double secs;
+
+	while( run->numReported < run->numTests && run->tests[ run->numReported ].done ) {
+		test = &run->tests[ run->numReported++ ];
+
+		if( mk__g_flags & kMkFlag_Verbose_Bit ) {
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_CYAN, "> " );
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_CYAN, test->cmd );
+			mk_sys_uncoloredPuts( kMkSIO_Err, "\n", 1 );
+		}
+		if( test->cached ) {
+			if( test->passed ) {
+				mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_GREEN, "OK" );
+				mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
+				mk_sys_printStr( kMkSIO_Err, MK_COLOR_WHITE, test->name );
+				mk_sys_uncoloredPuts( kMkSIO_Err, " (unchanged)\n", 0 );
+			} else {
+				mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, "KO" );
+				mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
+				mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, test->name );
+				mk_sys_uncoloredPuts( kMkSIO_Err, " (unchanged since it failed)\n", 0 );
+				mk_bld__pushFailedTest( run, test );
+			}
+			continue;
+		}
+
+		if( test->buildOutput != (char *)0 ) {
+			mk_sys_uncoloredPuts( kMkSIO_Err, test->buildOutput, 0 );
+		}
+		if( test->result.output != (char *)0 ) {
+			mk_sys_uncoloredPuts( kMkSIO_Err, test->result.output, 0 );
+		}
+
+		if( !test->built ) {
 			mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, "KO" );
 			mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
-			mk_sys_printStr( kMkSIO_Err, MK_COLOR_PURPLE, mk_sl_at( mk__g_unitTestNames, i ) );
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_PURPLE, test->name );
 			mk_sys_uncoloredPuts( kMkSIO_Err, " (did not build)\n", 0 );
-			mk_sl_pushBack( failedtests, mk_sl_at( mk__g_unitTestNames, i ) );
+			mk_sl_pushBack( run->failed, test->name );
 			continue;
 		}
 
-		/* run the unit test */
-		e = mk_com_shellf( "%s", mk_sl_at( mk__g_unitTestRuns, i ) );
-		if( e != 0 ) {
+		secs = (double)test->wallNs/1000000000.0;
+		if( test->result.timedOut ) {
 			mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, "KO" );
 			mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
-			mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, mk_sl_at( mk__g_unitTestNames, i ) );
-			mk_sys_printf( kMkSIO_Err, " (returned " MK_S_COLOR_WHITE "%i" MK_S_COLOR_RESTORE ")\n", e );
-			mk_sl_pushBack( failedtests, mk_sl_at( mk__g_unitTestRuns, i ) );
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, test->name );
+			mk_sys_printf( kMkSIO_Err, " (timed out after " MK_S_COLOR_WHITE "%.2fs" MK_S_COLOR_RESTORE ")\n", secs );
+			mk_bld__pushFailedTest( run, test );
+		} else if( test->result.exitStatus != 0 ) {
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, "KO" );
+			mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, test->name );
+			mk_sys_printf( kMkSIO_Err, " (returned " MK_S_COLOR_WHITE "%i" MK_S_COLOR_RESTORE "; %.2fs, %.1f MiB)\n",
+			    test->result.exitStatus, secs, (double)test->result.maxRSS/1024.0 );
+			mk_bld__pushFailedTest( run, test );
 		} else {
 			mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_GREEN, "OK" );
 			mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
-			mk_sys_printStr( kMkSIO_Err, MK_COLOR_WHITE, mk_sl_at( mk__g_unitTestNames, i ) );
-			mk_sys_uncoloredPuts( kMkSIO_Err, "\n", 1 );
-		}
-	}
-
-	n = mk_sl_getSize( failedtests );
-	if( n > 0 ) {
-		mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, "\n  *** " );
-		mk_sys_printStr( kMkSIO_Err, MK_COLOR_WHITE, mk_com_va( "%u", (unsigned int)n ) );
-		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, n == 1 ? " FAILURE" : " FAILURES" );
-		mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, " ***\n  " );
-		for( i = 0; i < n; i++ ) {
-			mk_sys_printStr( kMkSIO_Err, MK_COLOR_YELLOW, mk_sl_at( failedtests, i ) );
-			mk_sys_uncoloredPuts( kMkSIO_Err, "\n  ", 3 );
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_WHITE, test->name );
+			mk_sys_printf( kMkSIO_Err, " (%.2fs, %.1f MiB)\n", secs, (double)test->result.maxRSS/1024.0 );
 		}
-		mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, "\n" );
 	}
 
-	mk_sl_delete( failedtests );
+	fflush( mk__g_siof[kMkSIO_Err] );
+}
+/* mark a test as done, then show whatever can be shown */
+static void mk_bld__finishTest( MkUnitTest *test, int built ) {
+	mk_async_mtxLock( &test->run->lock );
+	test->built = built;
+	test->done  = 1;
+	mk_bld__reportTests( test->run );
+	mk_async_mtxUnlock( &test->run->lock );
 }
 
-/* sort the projects in a list */
-void mk_bld_sortProjects( struct MkProject_s *proj ) {
-	struct MkProject_s **head, **tail;
-	struct MkProject_s *p, *next;
-	int numsorts;
+/* build node function: compile a unit test */
+static int mk_bld__testCompile_f( MkBuildNode node, void *userData, MkStrList inputs, MkStrList outputs ) {
+	MkProcResult result;
+	MkUnitTest *test;
+	mk_uint64_t start;
+	int e;
 
-	head = proj ? &proj->head : &mk__g_proj_head;
-	tail = proj ? &proj->tail : &mk__g_proj_tail;
+	(void)inputs;
+	(void)outputs;
 
-	do {
-		numsorts = 0;
+	test = (MkUnitTest *)userData;
 
-		for( p = *head; p; p = next ) {
-			if( !( next = p->next ) ) {
-				break;
-			}
+	start = mk_com_getTimeNs();
+	e = mk_proc_runCmdLine( test->cmd, &result );
+	mk_stats_addPhase( kMkStats_Test, mk_com_getTimeNs() - start, ( mk_uint64_t )( ( result.userTime + result.systemTime )*1000000000.0 ) );
+	mk_bldno_setExitStatus( node, e );
 
-			if( p->type > next->type ) {
-				numsorts++;
+	/* any warnings are shown along with the test's own output */
+	test->buildOutput = result.output;
+	result.output     = (char *)0;
+	mk_proc_fini( &result );
 
-				if( p == *head ) {
-					*head = next;
-				}
-				if( next == *tail ) {
-					*tail = p;
-				}
+	if( e != 0 ) {
+		mk_bld__finishTest( test, 0 );
 
-				if( p->prev ) {
-					p->prev->next = next;
-				}
-				if( next->next ) {
-					next->next->prev = p;
-				}
+		/* one test that doesn't build mustn't keep its runner from linking */
+		return *test->obj != '\0' ? 1 : 0;
+	}
 
-				next->prev = p->prev;
-				p->prev    = next;
-				p->next    = next->next;
-				next->next = p;
+	test->built = 1;
+	return 1;
+}
 
-				next = p;
-			}
+static void mk_bld__writeCString( FILE *fp, const char *s ) {
+	fputc( '\"', fp );
+	for(; *s != '\0'; ++s ) {
+		if( *s == '\"' || *s == '\\' ) {
+			fputc( '\\', fp );
 		}
-	} while( numsorts > 0 );
+		fputc( *s, fp );
+	}
+	fputc( '\"', fp );
+}
+/* whether a test is linked into the given runner */
+static int mk_bld__isInRunner( const MkUnitTest *test, const MkTestRunner *runner ) {
+	return +( *test->obj != '\0' && test->built && !strcmp( test->exe, runner->first->exe ) );
 }
 
-/* set a projects dependents to be relinked */
-void mk_bld_relinkDeps( MkProject proj ) {
-	MkProject prnt, next;
-
-	MK_ASSERT( proj != (MkProject)0 );
+/*
+================
+mk_bld__writeTestRunner
+
+write the source of a test runner: `runner <name> [args...]` calls the main()
+of the test called <name> with <name> and the args as its argv, and just
+listing the names of the tests is what it does without any arguments. Every
+test's main() is declared as taking argc and argv, which is harmless for those
+taking none with the C calling conventions mk supports.
+================
+*/
+static int mk_bld__writeTestRunner( const char *filename, const MkTestRunner *runner ) {
+	const MkUnitTest *test;
+	size_t i;
+	FILE *fp;
+	char testmain[64];
+	int r;
 
-	for( prnt = proj->prnt; prnt; prnt = prnt->prnt ) {
-		prnt->config |= kMkProjCfg_NeedRelink_Bit;
+	if( !( fp = fopen( filename, "w" ) ) ) {
+		return 0;
 	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
 
-	if( proj->type == kMkProjTy_Program || proj->type == kMkProjTy_Application ) {
-		return;
-	}
+	fputs( "/* generated by mk --combine-tests; do not edit */\n", fp );
+	fputs( "#include <stdio.h>\n#include <string.h>\n\n", fp );
+
+	for( i = 0; i < runner->run->numTests; i++ ) {
+		test = &runner->run->tests[ i ];
+		if( mk_bld__isInRunner( test, runner ) ) {
+			mk_bld__getTestMain( testmain, sizeof( testmain ), test->name );
+			fprintf( fp, "int %s( int, char ** );\n", testmain );
+		}
+	}
+
+	fputs( "\nstatic const struct { const char *name; int( *fn )( int, char ** ); } tests[] = {\n", fp );
+	for( i = 0; i < runner->run->numTests; i++ ) {
+		test = &runner->run->tests[ i ];
+		if( mk_bld__isInRunner( test, runner ) ) {
+			mk_bld__getTestMain( testmain, sizeof( testmain ), test->name );
+			fputs( "\t{ ", fp );
+			mk_bld__writeCString( fp, test->name );
+			fprintf( fp, ", &%s },\n", testmain );
+		}
+	}
+	fputs( "\t{ 0, 0 }\n};\n\n", fp );
+
+	fputs( "int main( int argc, char **argv ) {\n", fp );
+	fputs( "\tsize_t i;\n\n", fp );
+	fputs( "\tfor( i = 0; tests[ i ].name != 0; ++i ) {\n", fp );
+	fputs( "\t\tif( argc < 2 ) {\n\t\t\tputs( tests[ i ].name );\n", fp );
+	fputs( "\t\t} else if( !strcmp( argv[ 1 ], tests[ i ].name ) ) {\n\t\t\treturn tests[ i ].fn( argc - 1, argv + 1 );\n\t\t}\n", fp );
+	fputs( "\t}\n\n", fp );
+	fputs( "\tif( argc < 2 ) {\n\t\treturn 0;\n\t}\n\n", fp );
+	fputs( "\tfprintf( stderr, \"%s: no test named \\\"%s\\\"\\n\", argv[ 0 ], argv[ 1 ] );\n", fp );
+	fputs( "\treturn 2;\n}\n", fp );
+
+	r = +( ferror( fp ) == 0 );
+	if( fclose( fp ) != 0 ) {
+		r = 0;
+	}
+
+	return r;
+}
+
+/* build node function: link a project's tests into its test runner */
+static int mk_bld__testLink_f( MkBuildNode node, void *userData, MkStrList inputs, MkStrList outputs ) {
+	const MkTestRunner *runner;
+	const MkUnitTest *test;
+	MkStringBuilder sb;
+	MkProcResult result;
+	mk_uint64_t start;
+	size_t i;
+	char *cmd;
+	char src[PATH_MAX];
+	int e;
+
+	(void)inputs;
+	(void)outputs;
+
+	runner = (const MkTestRunner *)userData;
+
+	mk_com_substExt( src, sizeof( src ), runner->first->exe, ".c" );
+	if( !mk_bld__writeTestRunner( src, runner ) ) {
+		mk_async_mtxLock( &runner->run->lock );
+		mk_log_error( src, 0, (const char *)0, "failed to write the test runner" );
+		mk_async_mtxUnlock( &runner->run->lock );
+		return 0;
+	}
+
+	mk_sb_init( &sb, 0 );
+	mk_sb_pushStr( &sb, runner->first->link );
+	mk_sb_pushStr( &sb, "-o \"" );
+	mk_sb_pushStr( &sb, runner->first->exe );
+	mk_sb_pushStr( &sb, "\" \"" );
+	mk_sb_pushStr( &sb, src );
+	mk_sb_pushChar( &sb, '\"' );
+	for( i = 0; i < runner->run->numTests; i++ ) {
+		test = &runner->run->tests[ i ];
+		if( mk_bld__isInRunner( test, runner ) ) {
+			mk_sb_pushStr( &sb, " \"" );
+			mk_sb_pushStr( &sb, test->obj );
+			mk_sb_pushChar( &sb, '\"' );
+		}
+	}
+	if( *runner->first->lib != '\0' ) {
+		mk_sb_pushStr( &sb, " \"" );
+		mk_sb_pushStr( &sb, runner->first->lib );
+		mk_sb_pushChar( &sb, '\"' );
+	}
+	cmd = mk_sb_done( &sb );
+
+	start = mk_com_getTimeNs();
+	e = mk_proc_runCmdLine( cmd, &result );
+	mk_stats_addPhase( kMkStats_Test, mk_com_getTimeNs() - start, ( mk_uint64_t )( ( result.userTime + result.systemTime )*1000000000.0 ) );
+	mk_bldno_setExitStatus( node, e );
+
+	/* nothing's reported past a test still waiting on this, so the output
+	   doesn't land in the middle of another test's */
+	if( ( mk__g_flags & kMkFlag_Verbose_Bit ) || e != 0 || ( result.output != (char *)0 && *result.output != '\0' ) ) {
+		mk_async_mtxLock( &runner->run->lock );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_CYAN, "> " );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_CYAN, ( mk__g_flags & kMkFlag_Verbose_Bit ) ? cmd : runner->first->exe );
+		mk_sys_uncoloredPuts( kMkSIO_Err, "\n", 1 );
+		if( result.output != (char *)0 ) {
+			mk_sys_uncoloredPuts( kMkSIO_Err, result.output, 0 );
+		}
+		fflush( mk__g_siof[kMkSIO_Err] );
+		mk_async_mtxUnlock( &runner->run->lock );
+	}
+
+	mk_proc_fini( &result );
+	cmd = (char *)mk_com_memory( (void *)cmd, 0 );
+
+	return +( e == 0 );
+}
+
+/* build node function: run a unit test that compiled */
+static int mk_bld__testRun_f( MkBuildNode node, void *userData, MkStrList inputs, MkStrList outputs ) {
+	MkUnitTest *test;
+	const char *argv[ 3 ];
+	mk_uint64_t start;
+
+	(void)inputs;
+	(void)outputs;
+
+	test = (MkUnitTest *)userData;
+
+	/* already reported as not building */
+	if( !test->built ) {
+		return 0;
+	}
+
+	argv[ 0 ] = test->exe;
+	argv[ 1 ] = *test->obj != '\0' ? test->name : (const char *)0;
+	argv[ 2 ] = (const char *)0;
+
+	start = mk_com_getTimeNs();
+	(void)mk_proc_runTimed( argv, mk__g_testTimeout*1000, &test->result );
+	test->wallNs = mk_com_getTimeNs() - start;
+	mk_stats_addPhase( kMkStats_Test, test->wallNs, ( mk_uint64_t )( ( test->result.userTime + test->result.systemTime )*1000000000.0 ) );
+	mk_bldno_setExitStatus( node, test->result.exitStatus );
+
+	mk_bld__finishTest( test, 1 );
+	return +( test->result.exitStatus == 0 && !test->result.timedOut );
+}
+
+/* remember how each unit test that was run went */
+static void mk_bld__recordTests( const MkUnitTestRun *run ) {
+	const MkUnitTest *test;
+	size_t i;
+	MkDep d;
+	char dep[PATH_MAX];
+
+	for( i = 0; i < run->numTests; i++ ) {
+		test = &run->tests[ i ];
+		if( test->cached ) {
+			continue;
+		}
+
+		/* a test that ran out of time may well pass next time */
+		if( !test->built || test->result.timedOut ) {
+			mk_bdb_removeObject( test->key );
+			continue;
+		}
+
+		if( ( d = mk_dep_find( test->key ) ) != (MkDep)0 ) {
+			mk_dep_delete( d );
+		}
+		mk_bld__getTestDepFile( dep, sizeof( dep ), test->key );
+		if( !mk_mfdep_load( dep ) || !( d = mk_dep_find( test->key ) ) ) {
+			mk_bdb_removeObject( test->key );
+			continue;
+		}
+
+		if( *test->lib != '\0' ) {
+			mk_dep_push( d, test->lib );
+		}
+		mk_bdb_setTest( test->key, test->cmdHash, d, +( test->result.exitStatus == 0 ) );
+	}
+
+	if( !mk_bdb_save() ) {
+		mk_dbg_outf( "failed to save the build state\n" );
+	}
+}
+
+/* perform each unit test */
+void mk_bld_runTests( void ) {
+	static size_t buffer[65536];
+	MkBuildContext ctx;
+	MkBuildNode compnode, runnode, linknode;
+	MkBuildNode *linknodes;
+	MkTestRunner *runners;
+	MkUnitTestRun run;
+	MkUnitTest *test;
+	size_t i, j, n, numRunners;
+	int force;
+	char dep[PATH_MAX];
+
+	MK_ASSERT( mk_sl_getSize( mk__g_unitTestCompiles ) == mk_sl_getSize( mk__g_unitTestRuns ) );
+	MK_ASSERT( mk_sl_getSize( mk__g_unitTestRuns ) == mk_sl_getSize( mk__g_unitTestNames ) );
+
+	n = mk_sl_getSize( mk__g_unitTestCompiles );
+	if( !n ) {
+		return;
+	}
+	MK_ASSERT( n <= sizeof( buffer ) / sizeof( buffer[0] ) );
+	mk_sl_orderedSort( mk__g_unitTestNames, buffer, sizeof( buffer ) / sizeof( buffer[0] ) );
+	mk_sl_indexedSort( mk__g_unitTestCompiles, buffer, n );
+	mk_sl_indexedSort( mk__g_unitTestRuns, buffer, n );
+	mk_sl_indexedSort( mk__g_unitTestLibs, buffer, n );
+	mk_sl_indexedSort( mk__g_unitTestObjs, buffer, n );
+	mk_sl_indexedSort( mk__g_unitTestLinks, buffer, n );
+
+	run.tests       = (MkUnitTest *)mk_com_memory( (void *)0, sizeof( *run.tests )*n );
+	run.numTests    = n;
+	run.numReported = 0;
+	run.failed      = mk_sl_new();
+	mk_async_mtxInit( &run.lock );
+
+	/* at most one runner per test */
+	runners    = (MkTestRunner *)mk_com_memory( (void *)0, sizeof( *runners )*n );
+	linknodes  = (MkBuildNode *)mk_com_memory( (void *)0, sizeof( *linknodes )*n );
+	numRunners = 0;
+
+	force = +( ( mk__g_flags & ( kMkFlag_ForceTests_Bit | kMkFlag_Rebuild_Bit ) ) != 0 );
+
+	ctx = mk_bldctx_new();
+	for( i = 0; i < n; i++ ) {
+		test = &run.tests[ i ];
+
+		test->run     = &run;
+		test->name    = mk_sl_at( mk__g_unitTestNames, i );
+		test->cmd     = mk_sl_at( mk__g_unitTestCompiles, i );
+		test->exe     = mk_sl_at( mk__g_unitTestRuns, i );
+		test->obj     = mk_sl_at( mk__g_unitTestObjs, i );
+		test->link    = mk_sl_at( mk__g_unitTestLinks, i );
+		test->lib     = mk_sl_at( mk__g_unitTestLibs, i );
+		test->key     = *test->obj != '\0' ? test->obj : test->exe;
+		test->cmdHash = mk_com_hashStr64( MK_HASH64_INIT, test->cmd );
+		test->built   = 0;
+		test->done    = 0;
+		test->cached  = 0;
+		test->passed  = 0;
+		test->wallNs  = 0;
+
+		test->buildOutput = (char *)0;
+		mk_proc_init( &test->result );
+
+		mk_bld__getTestDepFile( dep, sizeof( dep ), test->key );
+		if( !force && mk_bdb_checkTest( test->key, dep, test->cmdHash, &test->passed ) == kMkBdb_UpToDate ) {
+			test->cached = 1;
+			test->built  = 1;
+			test->done   = 1;
+			continue;
+		}
+
+		runnode = mk_bldctx_addNode( ctx, test->name, kMkBldNo_Target_Bit | kMkBldNo_Phony_Bit, &mk_bld__testRun_f, (void *)test );
+		mk_bldno_setTraceKind( runnode, kMkTrace_Test );
+
+		if( *test->obj == '\0' ) {
+			compnode = mk_bldctx_addNode( ctx, test->exe, 0, &mk_bld__testCompile_f, (void *)test );
+			mk_bldno_addInput( runnode, compnode );
+			continue;
+		}
+
+		for( j = 0; j < numRunners; j++ ) {
+			if( !strcmp( runners[ j ].first->exe, test->exe ) ) {
+				break;
+			}
+		}
+		if( j == numRunners ) {
+			runners[ j ].run   = &run;
+			runners[ j ].first = test;
+
+			linknodes[ j ] = mk_bldctx_addNode( ctx, test->exe, 0, &mk_bld__testLink_f, (void *)&runners[ j ] );
+			mk_bldno_setTraceKind( linknodes[ j ], kMkTrace_Link );
+			++numRunners;
+		}
+		linknode = linknodes[ j ];
+
+		/* a failed compile is reported by the test; see mk_bld__testCompile_f() */
+		compnode = mk_bldctx_addNode( ctx, test->obj, kMkBldNo_Phony_Bit, &mk_bld__testCompile_f, (void *)test );
+		mk_bldno_addInput( linknode, compnode );
+		mk_bldno_addInput( runnode, linknode );
+	}
+
+	/* the unchanged tests ahead of the first one to run can be shown now */
+	mk_async_mtxLock( &run.lock );
+	mk_bld__reportTests( &run );
+	mk_async_mtxUnlock( &run.lock );
+
+	(void)mk_bldctx_run( ctx, mk__g_numTestJobs != 0 ? mk__g_numTestJobs : mk__g_numJobs );
+	mk_bldctx_delete( ctx );
+
+	/* anything the build didn't get to (it stops early if every test failed) */
+	for( i = 0; i < n; i++ ) {
+		if( !run.tests[ i ].done ) {
+			mk_bld__finishTest( &run.tests[ i ], 0 );
+		}
+	}
+
+	mk_bld__recordTests( &run );
+
+	n = mk_sl_getSize( run.failed );
+	if( n > 0 ) {
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, "\n  *** " );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_WHITE, mk_com_va( "%u", (unsigned int)n ) );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, n == 1 ? " FAILURE" : " FAILURES" );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, " ***\n  " );
+		for( i = 0; i < n; i++ ) {
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_YELLOW, mk_sl_at( run.failed, i ) );
+			mk_sys_uncoloredPuts( kMkSIO_Err, "\n  ", 3 );
+		}
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, "\n" );
+	}
+
+	for( i = 0; i < run.numTests; i++ ) {
+		run.tests[ i ].buildOutput = (char *)mk_com_memory( (void *)run.tests[ i ].buildOutput, 0 );
+		mk_proc_fini( &run.tests[ i ].result );
+	}
+	mk_sl_delete( run.failed );
+	mk_async_mtxFini( &run.lock );
+	run.tests = (MkUnitTest *)mk_com_memory( (void *)run.tests, 0 );
+	runners   = (MkTestRunner *)mk_com_memory( (void *)runners, 0 );
+	linknodes = (MkBuildNode *)mk_com_memory( (void *)linknodes, 0 );
+}
+
+/*
+ *	Benchmarks are compiled on the build's worker threads like unit tests
+ *	are (and only once they've changed), but then run one at a time on the
+ *	main thread -- pinned to a single CPU where that's supported -- so that
+ *	they compete with neither each other nor mk. Each is run
+ *	MK_BENCH_WARMUP_RUNS times without being timed, then --bench-runs times.
+ *
+ *	A run's wall time is divided by the number of operations the benchmark
+ *	says it did by printing a line "MK_BENCH_OPS=<n>"; without one, a whole
+ *	run counts as one operation. The mean time per operation, its standard
+ *	deviation, and the peak RSS over the runs are kept in the object
+ *	directory, where `mk bench --compare` looks for the previous run's to
+ *	flag the benchmarks that got slower.
+ */
+typedef struct MkBenchResult_s {
+	double nsPerOp;
+	double stddev;     /* of nsPerOp, in nanoseconds */
+	long maxRSS;       /* KiB */
+	unsigned int runs;
+} MkBenchResult;
+
+typedef struct MkBenchmark_s {
+	const char *name; /* source file, relative to the current directory */
+	const char *cmd;  /* compiles the benchmark */
+	const char *exe;
+	const char *lib;  /* the project binary it links against, or "" */
+	mk_uint64_t cmdHash;
+
+	int compiled;     /* whether it had changed, and was compiled */
+	int built;
+	char *buildOutput;
+
+	int measured;     /* whether every run succeeded; see `result` */
+	MkBenchResult result;
+} MkBenchmark;
+
+typedef struct MkBenchResults_s {
+	MkStrList names;
+	MkBenchResult *results;
+	size_t maxResults;
+} MkBenchResults;
+
+/* find where the results of the benchmarks' last run are kept */
+static void mk_bld__getBenchResultsFile( char *dst, size_t n ) {
+	mk_com_strcpy( dst, n, mk_com_va( "%s/%s/bench-results.txt", mk_opt_getObjdirBase(), mk_opt_getConfigName() ) );
+}
+
+/* add a benchmark's results to a set of them */
+static void mk_bld__pushBenchResult( MkBenchResults *res, const char *name, const MkBenchResult *result ) {
+	size_t n;
+
+	n = mk_sl_getSize( res->names );
+	if( n == res->maxResults ) {
+		res->maxResults = res->maxResults ? res->maxResults*2 : 32;
+		res->results = (MkBenchResult *)mk_com_memory( (void *)res->results, sizeof( *res->results )*res->maxResults );
+	}
+
+	res->results[ n ] = *result;
+	mk_sl_pushBack( res->names, name );
+}
+/* retrieve the results of the named benchmark, or null if there are none */
+static const MkBenchResult *mk_bld__findBenchResult( const MkBenchResults *res, const char *name ) {
+	size_t i, n;
+
+	n = mk_sl_getSize( res->names );
+	for( i = 0; i < n; i++ ) {
+		if( !strcmp( mk_sl_at( res->names, i ), name ) ) {
+			return &res->results[ i ];
+		}
+	}
+
+	return (const MkBenchResult *)0;
+}
+
+/*
+================
+mk_bld__loadBenchResults
+
+read the results written by mk_bld__saveBenchResults(); a missing file has no
+results, and lines that can't be read are skipped. Each line holds the time per
+operation, its standard deviation, the peak RSS, the number of runs, and then
+the benchmark's name (which may contain spaces).
+================
+*/
+static void mk_bld__loadBenchResults( MkBenchResults *res, const char *filename ) {
+	MkBenchResult result;
+	FILE *fp;
+	char line[PATH_MAX + 256], *name, *p;
+	int off;
+
+	res->names      = mk_sl_new();
+	res->results    = (MkBenchResult *)0;
+	res->maxResults = 0;
+
+	if( !( fp = fopen( filename, "r" ) ) ) {
+		return;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
+
+	while( fgets( line, sizeof( line ), fp ) != (char *)0 ) {
+		if( line[0] == '#' ) {
+			continue;
+		}
+
+		off = 0;
+		if( sscanf( line, "%lf %lf %ld %u %n", &result.nsPerOp, &result.stddev, &result.maxRSS, &result.runs, &off ) < 4 || !off ) {
+			continue;
+		}
+
+		name = &line[ off ];
+		if( ( p = strpbrk( name, "\r\n" ) ) != (char *)0 ) {
+			*p = '\0';
+		}
+		if( *name == '\0' ) {
+			continue;
+		}
+
+		mk_bld__pushBenchResult( res, name, &result );
+	}
+
+	fclose( fp );
+}
+/* write the results of the benchmarks just measured, keeping the previous
+   results of those that weren't */
+static int mk_bld__saveBenchResults( const char *filename, const MkBenchmark *benches, size_t n, const MkBenchResults *prev ) {
+	const MkBenchResult *result;
+	const char *name;
+	size_t i, j, numPrev;
+	FILE *fp;
+	int r;
+
+	if( !( fp = fopen( filename, "w" ) ) ) {
+		return 0;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
+
+	fputs( "# mk bench results: ns/op, stddev, peak KiB, runs, name\n", fp );
+
+	for( i = 0; i < n; i++ ) {
+		if( benches[ i ].measured ) {
+			result = &benches[ i ].result;
+			fprintf( fp, "%.3f %.3f %ld %u %s\n", result->nsPerOp, result->stddev, result->maxRSS, result->runs, benches[ i ].name );
+		}
+	}
+
+	numPrev = mk_sl_getSize( prev->names );
+	for( j = 0; j < numPrev; j++ ) {
+		name = mk_sl_at( prev->names, j );
+		for( i = 0; i < n; i++ ) {
+			if( benches[ i ].measured && !strcmp( benches[ i ].name, name ) ) {
+				break;
+			}
+		}
+		if( i < n ) {
+			continue;
+		}
+
+		result = &prev->results[ j ];
+		fprintf( fp, "%.3f %.3f %ld %u %s\n", result->nsPerOp, result->stddev, result->maxRSS, result->runs, name );
+	}
+
+	r = +( ferror( fp ) == 0 );
+	if( fclose( fp ) != 0 ) {
+		r = 0;
+	}
+
+	return r;
+}
+
+/* build node function: compile a benchmark */
+static int mk_bld__benchCompile_f( MkBuildNode node, void *userData, MkStrList inputs, MkStrList outputs ) {
+	MkProcResult result;
+	MkBenchmark *bench;
+	mk_uint64_t start;
+	int e;
+
+	(void)inputs;
+	(void)outputs;
+
+	bench = (MkBenchmark *)userData;
+
+	start = mk_com_getTimeNs();
+	e = mk_proc_runCmdLine( bench->cmd, &result );
+	mk_stats_addPhase( kMkStats_Compile, mk_com_getTimeNs() - start, ( mk_uint64_t )( ( result.userTime + result.systemTime )*1000000000.0 ) );
+	mk_bldno_setExitStatus( node, e );
+
+	/* any warnings are shown along with the benchmark's results */
+	bench->buildOutput = result.output;
+	result.output      = (char *)0;
+	mk_proc_fini( &result );
+
+	bench->built = +( e == 0 );
+	return bench->built;
+}
+
+/* remember the benchmarks that were compiled, so they needn't be again */
+static void mk_bld__recordBenchmarks( const MkBenchmark *benches, size_t n ) {
+	const MkBenchmark *bench;
+	size_t i;
+	MkDep d;
+	char dep[PATH_MAX];
+
+	for( i = 0; i < n; i++ ) {
+		bench = &benches[ i ];
+		if( !bench->compiled ) {
+			continue;
+		}
+
+		if( !bench->built ) {
+			mk_bdb_removeObject( bench->exe );
+			continue;
+		}
+
+		if( ( d = mk_dep_find( bench->exe ) ) != (MkDep)0 ) {
+			mk_dep_delete( d );
+		}
+		mk_bld__getTestDepFile( dep, sizeof( dep ), bench->exe );
+		if( !mk_mfdep_load( dep ) || !( d = mk_dep_find( bench->exe ) ) ) {
+			mk_bdb_removeObject( bench->exe );
+			continue;
+		}
+
+		if( *bench->lib != '\0' ) {
+			mk_dep_push( d, bench->lib );
+		}
+		mk_bdb_setObject( bench->exe, bench->cmdHash, d, 0 );
+	}
+
+	if( !mk_bdb_save() ) {
+		mk_dbg_outf( "failed to save the build state\n" );
+	}
+}
+
+/* the number of operations a run of a benchmark did, going by the last
+   "MK_BENCH_OPS=<n>" line it printed */
+static mk_uint64_t mk_bld__getBenchOps( const char *output ) {
+	static const char prefix[] = "MK_BENCH_OPS=";
+	const char *p;
+	mk_uint64_t ops, n;
+	char *end;
+
+	ops = 1;
+	if( !output ) {
+		return ops;
+	}
+
+	for( p = output; ( p = strstr( p, prefix ) ) != (const char *)0; p += sizeof( prefix ) - 1 ) {
+		if( p != output && p[ -1 ] != '\n' ) {
+			continue;
+		}
+
+		n = ( mk_uint64_t )strtoull( p + sizeof( prefix ) - 1, &end, 10 );
+		if( n > 0 ) {
+			ops = n;
+		}
+	}
+
+	return ops;
+}
+
+/* square root by Newton's method, so as not to need libm just for this */
+static double mk_bld__sqrt( double x ) {
+	double r;
+	int i;
+
+	if( x <= 0.0 ) {
+		return 0.0;
+	}
+
+	r = x > 1.0 ? x : 1.0;
+	for( i = 0; i < 64; i++ ) {
+		r = 0.5*( r + x/r );
+	}
+
+	return r;
+}
+
+/* show that a benchmark failed, and why */
+static void mk_bld__showBenchFailure( const MkBenchmark *bench, const char *why ) {
+	mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, "KO" );
+	mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
+	mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, bench->name );
+	mk_sys_printf( kMkSIO_Err, " (%s)\n", why );
+}
+
+/*
+================
+mk_bld__measureBenchmark
+
+run a benchmark for its warm-up and timed runs, filling in its results. If a
+run fails, what it printed is shown along with why, and 0 is returned.
+================
+*/
+static int mk_bld__measureBenchmark( MkBenchmark *bench ) {
+	MkProcResult result;
+	const char *argv[ 2 ];
+	mk_uint64_t start, end;
+	unsigned int i, numRuns;
+	double *samples;
+	double sum, mean;
+	char why[128];
+
+	argv[ 0 ] = bench->exe;
+	argv[ 1 ] = (const char *)0;
+
+	bench->result.nsPerOp = 0.0;
+	bench->result.stddev  = 0.0;
+	bench->result.maxRSS  = 0;
+	bench->result.runs    = mk__g_numBenchRuns;
+
+	numRuns = MK_BENCH_WARMUP_RUNS + mk__g_numBenchRuns;
+	samples = (double *)mk_com_memory( (void *)0, sizeof( *samples )*numRuns );
+
+	for( i = 0; i < numRuns; i++ ) {
+		start = mk_com_getTimeNs();
+		(void)mk_proc_runTimed( argv, mk__g_testTimeout*1000, &result );
+		end = mk_com_getTimeNs();
+		mk_stats_addPhase( kMkStats_Bench, end - start, ( mk_uint64_t )( ( result.userTime + result.systemTime )*1000000000.0 ) );
+		mk_trace_add( mk_trace_getBuffer( 0 ), kMkTrace_Bench, bench->name, start, end, result.exitStatus,
+		    i < MK_BENCH_WARMUP_RUNS ? "warm-up" : (const char *)0 );
+
+		if( result.exitStatus != 0 || result.timedOut ) {
+			if( result.output != (char *)0 ) {
+				mk_sys_uncoloredPuts( kMkSIO_Err, result.output, 0 );
+			}
+
+			if( result.timedOut ) {
+				snprintf( why, sizeof( why ), "timed out after %.2fs", (double)( end - start )/1000000000.0 );
+			} else {
+				snprintf( why, sizeof( why ), "returned %i", result.exitStatus );
+			}
+			mk_bld__showBenchFailure( bench, why );
+
+			mk_proc_fini( &result );
+			samples = (double *)mk_com_memory( (void *)samples, 0 );
+			return 0;
+		}
+
+		if( ( mk__g_flags & kMkFlag_Verbose_Bit ) && i + 1 == numRuns && result.output != (char *)0 ) {
+			mk_sys_uncoloredPuts( kMkSIO_Err, result.output, 0 );
+		}
+
+		samples[ i ] = (double)( end - start )/(double)mk_bld__getBenchOps( result.output );
+		if( i >= MK_BENCH_WARMUP_RUNS && bench->result.maxRSS < result.maxRSS ) {
+			bench->result.maxRSS = result.maxRSS;
+		}
+
+		mk_proc_fini( &result );
+	}
+
+	/* only the timed runs count */
+	sum = 0.0;
+	for( i = MK_BENCH_WARMUP_RUNS; i < numRuns; i++ ) {
+		sum += samples[ i ];
+	}
+	mean = sum/(double)mk__g_numBenchRuns;
+
+	sum = 0.0;
+	for( i = MK_BENCH_WARMUP_RUNS; i < numRuns; i++ ) {
+		sum += ( samples[ i ] - mean )*( samples[ i ] - mean );
+	}
+
+	bench->result.nsPerOp = mean;
+	bench->result.stddev  = mk__g_numBenchRuns > 1 ? mk_bld__sqrt( sum/(double)( mk__g_numBenchRuns - 1 ) ) : 0.0;
+
+	samples = (double *)mk_com_memory( (void *)samples, 0 );
+	return 1;
+}
+
+/* show how a benchmark did -- compared to its previous run if `prev` isn't
+   null -- returning whether it got slower */
+static int mk_bld__reportBenchmark( const MkBenchmark *bench, const MkBenchResult *prev ) {
+	const MkBenchResult *result;
+	double change;
+	int regressed;
+
+	result = &bench->result;
+
+	regressed = 0;
+	change    = 0.0;
+	if( prev != (const MkBenchResult *)0 && prev->nsPerOp > 0.0 ) {
+		change = ( result->nsPerOp - prev->nsPerOp )*100.0/prev->nsPerOp;
+		regressed = +( change > (double)MK_BENCH_REGRESSION_PERCENT && result->nsPerOp - prev->nsPerOp > result->stddev + prev->stddev );
+	}
+
+	if( regressed ) {
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, "KO" );
+		mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, bench->name );
+	} else {
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_GREEN, "OK" );
+		mk_sys_uncoloredPuts( kMkSIO_Err, ": ", 2 );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_WHITE, bench->name );
+	}
+
+	mk_sys_printf( kMkSIO_Err, " " MK_S_COLOR_WHITE "%.1f ns/op" MK_S_COLOR_RESTORE " +/- %.1f%% (%u runs, %.1f MiB)",
+	    result->nsPerOp, result->nsPerOp > 0.0 ? result->stddev*100.0/result->nsPerOp : 0.0, result->runs,
+	    (double)result->maxRSS/1024.0 );
+	if( prev != (const MkBenchResult *)0 && prev->nsPerOp > 0.0 ) {
+		mk_sys_printf( kMkSIO_Err, "; was %.1f ns/op (%+.1f%%)", prev->nsPerOp, change );
+	}
+	mk_sys_uncoloredPuts( kMkSIO_Err, "\n", 1 );
+
+	return regressed;
+}
+
+/* list the benchmarks that failed, or got slower */
+static void mk_bld__showBenchList( MkStrList list, const char *what, const char *whats ) {
+	size_t i, n;
+
+	n = mk_sl_getSize( list );
+	if( !n ) {
+		return;
+	}
+
+	mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, "\n  *** " );
+	mk_sys_printStr( kMkSIO_Err, MK_COLOR_WHITE, mk_com_va( "%u", (unsigned int)n ) );
+	mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_RED, n == 1 ? what : whats );
+	mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, " ***\n  " );
+	for( i = 0; i < n; i++ ) {
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_YELLOW, mk_sl_at( list, i ) );
+		mk_sys_uncoloredPuts( kMkSIO_Err, "\n  ", 3 );
+	}
+	mk_sys_printStr( kMkSIO_Err, MK_COLOR_RED, "\n" );
+}
+
+/* perform each benchmark; returns 0 if any failed, or (with --compare) got
+   slower than in the previous run */
+int mk_bld_runBenchmarks( void ) {
+	static size_t buffer[65536];
+	MkBuildContext ctx;
+	MkBuildNode node;
+	MkBenchResults prev;
+	MkBenchmark *benches, *bench;
+	MkStrList failed, regressed;
+	size_t i, n;
+	int force, pinned, r;
+	char dep[PATH_MAX], filename[PATH_MAX];
+
+	MK_ASSERT( mk_sl_getSize( mk__g_benchCompiles ) == mk_sl_getSize( mk__g_benchRuns ) );
+	MK_ASSERT( mk_sl_getSize( mk__g_benchRuns ) == mk_sl_getSize( mk__g_benchNames ) );
+
+	n = mk_sl_getSize( mk__g_benchCompiles );
+	if( !n ) {
+		return 1;
+	}
+	MK_ASSERT( n <= sizeof( buffer ) / sizeof( buffer[0] ) );
+	mk_sl_orderedSort( mk__g_benchNames, buffer, sizeof( buffer ) / sizeof( buffer[0] ) );
+	mk_sl_indexedSort( mk__g_benchCompiles, buffer, n );
+	mk_sl_indexedSort( mk__g_benchRuns, buffer, n );
+	mk_sl_indexedSort( mk__g_benchLibs, buffer, n );
+
+	benches = (MkBenchmark *)mk_com_memory( (void *)0, sizeof( *benches )*n );
+
+	force = +( ( mk__g_flags & kMkFlag_Rebuild_Bit ) != 0 );
+
+	/* compile what changed, in parallel */
+	ctx = mk_bldctx_new();
+	for( i = 0; i < n; i++ ) {
+		bench = &benches[ i ];
+
+		bench->name     = mk_sl_at( mk__g_benchNames, i );
+		bench->cmd      = mk_sl_at( mk__g_benchCompiles, i );
+		bench->exe      = mk_sl_at( mk__g_benchRuns, i );
+		bench->lib      = mk_sl_at( mk__g_benchLibs, i );
+		bench->cmdHash  = mk_com_hashStr64( MK_HASH64_INIT, bench->cmd );
+		bench->compiled = 0;
+		bench->built    = 0;
+		bench->measured = 0;
+
+		bench->buildOutput = (char *)0;
+
+		mk_bld__getTestDepFile( dep, sizeof( dep ), bench->exe );
+		if( !force && mk_bdb_checkObject( bench->exe, dep, bench->cmdHash ) == kMkBdb_UpToDate ) {
+			bench->built = 1;
+			continue;
+		}
+
+		bench->compiled = 1;
+		node = mk_bldctx_addNode( ctx, bench->exe, kMkBldNo_Target_Bit, &mk_bld__benchCompile_f, (void *)bench );
+		mk_bldno_setTraceKind( node, kMkTrace_Compile );
+	}
+
+	(void)mk_bldctx_run( ctx, mk__g_numJobs );
+	mk_bldctx_delete( ctx );
+
+	mk_bld__recordBenchmarks( benches, n );
+
+	mk_bld__getBenchResultsFile( filename, sizeof( filename ) );
+	mk_bld__loadBenchResults( &prev, filename );
+
+	failed    = mk_sl_new();
+	regressed = mk_sl_new();
+
+	/* then run each on its own */
+	pinned = mk_proc_pinToOneCPU();
+	if( !pinned ) {
+		mk_dbg_outf( "couldn't pin the benchmarks to a CPU\n" );
+	}
+
+	for( i = 0; i < n; i++ ) {
+		bench = &benches[ i ];
+
+		if( ( mk__g_flags & kMkFlag_Verbose_Bit ) && bench->compiled ) {
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_CYAN, "> " );
+			mk_sys_printStr( kMkSIO_Err, MK_COLOR_CYAN, bench->cmd );
+			mk_sys_uncoloredPuts( kMkSIO_Err, "\n", 1 );
+		}
+		if( bench->buildOutput != (char *)0 ) {
+			mk_sys_uncoloredPuts( kMkSIO_Err, bench->buildOutput, 0 );
+		}
+
+		if( !bench->built ) {
+			mk_bld__showBenchFailure( bench, "did not build" );
+			mk_sl_pushBack( failed, bench->name );
+			continue;
+		}
+
+		if( !mk_bld__measureBenchmark( bench ) ) {
+			mk_sl_pushBack( failed, bench->exe );
+			continue;
+		}
+		bench->measured = 1;
+
+		if( mk_bld__reportBenchmark( bench, ( mk__g_flags & kMkFlag_BenchCompare_Bit ) ? mk_bld__findBenchResult( &prev, bench->name ) : (const MkBenchResult *)0 ) ) {
+			mk_sl_pushBack( regressed, bench->name );
+		}
+
+		fflush( mk__g_siof[kMkSIO_Err] );
+	}
+
+	mk_proc_unpin();
+
+	if( !mk_bld__saveBenchResults( filename, benches, n, &prev ) ) {
+		mk_log_error( filename, 0, (const char *)0, "failed to save the benchmark results" );
+	}
+
+	mk_bld__showBenchList( failed, " FAILURE", " FAILURES" );
+	mk_bld__showBenchList( regressed, " REGRESSION", " REGRESSIONS" );
+
+	r = +( mk_sl_getSize( failed ) == 0 && mk_sl_getSize( regressed ) == 0 );
+
+	for( i = 0; i < n; i++ ) {
+		benches[ i ].buildOutput = (char *)mk_com_memory( (void *)benches[ i ].buildOutput, 0 );
+	}
+	mk_sl_delete( failed );
+	mk_sl_delete( regressed );
+	mk_sl_delete( prev.names );
+	prev.results = (MkBenchResult *)mk_com_memory( (void *)prev.results, 0 );
+	benches      = (MkBenchmark *)mk_com_memory( (void *)benches, 0 );
+
+	return r;
+}
+
+/* sort the projects in a list */
+void mk_bld_sortProjects( struct MkProject_s *proj ) {
+	struct MkProject_s **head, **tail;
+	struct MkProject_s *p, *next;
+	int numsorts;
+
+	head = proj ? &proj->head : &mk__g_proj_head;
+	tail = proj ? &proj->tail : &mk__g_proj_tail;
+
+	do {
+		numsorts = 0;
+
+		for( p = *head; p; p = next ) {
+			if( !( next = p->next ) ) {
+				break;
+			}
+
+			if( p->type > next->type ) {
+				numsorts++;
+
+				if( p == *head ) {
+					*head = next;
+				}
+				if( next == *tail ) {
+					*tail = p;
+				}
+
+				if( p->prev ) {
+					p->prev->next = next;
+				}
+				if( next->next ) {
+					next->next->prev = p;
+				}
+
+				next->prev = p->prev;
+				p->prev    = next;
+				p->next    = next->next;
+				next->next = p;
+
+				next = p;
+			}
+		}
+	} while( numsorts > 0 );
+}
+
+/* set a projects dependents to be relinked */
+void mk_bld_relinkDeps( MkProject proj ) {
+	MkProject prnt, next;
+
+	MK_ASSERT( proj != (MkProject)0 );
+
+	for( prnt = proj->prnt; prnt; prnt = prnt->prnt ) {
+		prnt->config |= kMkProjCfg_NeedRelink_Bit;
+	}
+
+	if( proj->type == kMkProjTy_Program || proj->type == kMkProjTy_Application ) {
+		return;
+	}
 
 	for( next = proj->next; next; next = next->next ) {
 		if( proj->type > next->type ) {
 			break;
 		}
 
-		next->config |= kMkProjCfg_NeedRelink_Bit;
-		mk_bld_relinkDeps( next );
+		next->config |= kMkProjCfg_NeedRelink_Bit;
+		mk_bld_relinkDeps( next );
+	}
+}
+
+/*
+ *	Build steps run on the worker threads of a build context (see
+ *	mk-build-node.h). Only the commands themselves run concurrently: anything
+ *	touching shared state (dependency lists, static flag buffers, mk_com_va(),
+ *	output) happens with mk__g_bld_lock held.
+ */
+static mk_mutex_t mk__g_bld_lock = MK_MUTEX_INITIALIZER;
+
+typedef struct MkBuildStep_s {
+	MkProject   proj;
+	const char *tool;
+	char *      cmd;  /* command line; built lazily for the link step */
+	char *      name; /* file reported alongside the command's output */
+
+	/* milliseconds the command took to run, or 0 if it wasn't */
+	mk_uint32_t duration;
+
+	/* compile step only; when it began, per mk_bdb_getTime(), and what's
+	   needed to store the object in the object cache */
+	mk_uint64_t started;
+	mk_uint64_t cacheKey; /* 0 if not to be stored */
+	char *      output;
+
+	/* compile step only; the link step counting it in `numbuilds` */
+	struct MkBuildStep_s *linkstep;
+
+	/* link step only */
+	MkStrList objs;
+	MkStrList changed; /* objects compiled that didn't come out the same */
+	int       numbuilds;
+	int       scannedLibs;
+
+	/* static library link step only */
+	mk_uint64_t cmdHash;  /* of the command making the archive from scratch */
+	int         updating; /* only replacing the `changed` members */
+	int         archived;
+} MkBuildStep;
+
+static MkBuildStep *mk_bld__newStep( MkProject proj, const char *tool, const char *cmd, const char *name ) {
+	MkBuildStep *step;
+
+	step = (MkBuildStep *)mk_mem_alloc( sizeof( *step ) );
+
+	step->proj = proj;
+	step->tool = tool;
+	step->cmd  = cmd != (const char *)0 ? mk_com_strdup( cmd ) : (char *)0;
+	step->name = mk_com_strdup( name );
+
+	return step;
+}
+static void mk_bld__deleteStep( MkBuildStep *step ) {
+	if( !step ) {
+		return;
+	}
+
+	step->cmd    = (char *)mk_com_memory( (void *)step->cmd, 0 );
+	step->name   = (char *)mk_com_memory( (void *)step->name, 0 );
+	step->output = (char *)mk_com_memory( (void *)step->output, 0 );
+
+	mk_mem_dealloc( (void *)step );
+}
+
+/* display what a build step printed, or what the object cache replayed for it
+   if `cached` (the object) isn't NULL; must be called with mk__g_bld_lock held */
+static void mk_bld__reportStep( const MkBuildStep *step, const char *cached, const char *output, int exitstatus ) {
+	if( ( mk__g_flags & kMkFlag_Verbose_Bit ) && cached != (const char *)0 ) {
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_CYAN, "> " );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_CYAN, "cached: " );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_CYAN, cached );
+		mk_sys_uncoloredPuts( kMkSIO_Err, "\n", 1 );
+	} else if( mk__g_flags & kMkFlag_Verbose_Bit ) {
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_CYAN, "> " );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_CYAN, step->cmd );
+		mk_sys_uncoloredPuts( kMkSIO_Err, "\n", 1 );
+	} else if( output != (const char *)0 && *output != '\0' ) {
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_LIGHT_CYAN, "> " );
+		mk_sys_printStr( kMkSIO_Err, MK_COLOR_WHITE, step->name );
+		mk_sys_uncoloredPuts( kMkSIO_Err, "\n", 1 );
+	}
+
+	if( output != (const char *)0 && *output != '\0' ) {
+		mk_sys_uncoloredPuts( kMkSIO_Err, output, 0 );
+	}
+
+	if( exitstatus != 0 ) {
+		errno = 0;
+		mk_log_error( step->name, 0, (const char *)0, mk_com_va( "command failed with status %i", exitstatus ) );
+	}
+
+	fflush( mk__g_siof[kMkSIO_Err] );
+}
+
+/* run a build step's command, reporting its output atomically */
+static int mk_bld__runStep( MkBuildStep *step ) {
+	MkProcResult result;
+	MkStatsPhase_t phase;
+	mk_uint64_t start, elapsed;
+
+	start = mk_com_getTimeNs();
+	(void)mk_proc_runCmdLine( step->cmd, &result );
+	elapsed = mk_com_getTimeNs() - start;
+
+	step->duration = ( mk_uint32_t )( elapsed/1000000 ) + 1;
+
+	phase = kMkStats_Compile;
+	if( step->objs != (MkStrList)0 ) {
+		phase = mk_prj_getType( step->proj ) == kMkProjTy_StaticLib ? kMkStats_Archive : kMkStats_Link;
+	}
+	mk_stats_addPhase( phase, elapsed, ( mk_uint64_t )( ( result.userTime + result.systemTime )*1000000000.0 ) );
+
+	mk_async_mtxLock( &mk__g_bld_lock );
+	mk_bld__reportStep( step, (const char *)0, result.output, result.exitStatus );
+	mk_async_mtxUnlock( &mk__g_bld_lock );
+
+	/* the object cache replays the output along with the object */
+	if( step->cacheKey != 0 ) {
+		if( result.exitStatus == 0 ) {
+			step->output  = result.output;
+			result.output = (char *)0;
+		} else {
+			step->cacheKey = 0;
+		}
+	}
+
+	mk_proc_fini( &result );
+	return result.exitStatus;
+}
+
+/*
+================
+mk_bld__isUnchanged
+
+determine whether a file that was just rebuilt came out the same as before;
+`hadPrev` and `prevHash` are what mk_fs_hashFile() gave before rebuilding it
+================
+*/
+static int mk_bld__isUnchanged( const char *path, int hadPrev, mk_uint64_t prevHash ) {
+	mk_uint64_t hash;
+
+	mk_fs_invalidate( path );
+	if( !hadPrev || !mk_fs_hashFile( path, &hash ) ) {
+		return 0;
+	}
+
+	return +( hash == prevHash );
+}
+
+/* build node function: compile one source file */
+static int mk_bld__compile_f( MkBuildNode node, void *userData, MkStrList inputs, MkStrList outputs ) {
+	MkBuildStep *step;
+	mk_uint64_t prevHash;
+	const char *obj;
+	char *output;
+	int hadPrev;
+	int r, e;
+
+	(void)inputs;
+	(void)outputs;
+
+	step = (MkBuildStep *)userData;
+	obj  = mk_bldno_getFilename( node );
+	step->started = mk_bdb_getTime();
+
+	/* the object may be a hard link into another checkout (--seed-objdir),
+	   which mustn't be written through */
+	hadPrev = mk_fs_hashFile( obj, &prevHash );
+	remove( obj );
+	mk_fs_invalidate( obj );
+
+	r = -1;
+	if( mk__g_flags & kMkFlag_Cache_Bit ) {
+		if( mk_oc_lookup( step->tool, step->cmd, step->name, obj, &step->cacheKey, &output ) ) {
+			step->cacheKey = 0;
+
+			mk_async_mtxLock( &mk__g_bld_lock );
+			mk_bld__reportStep( step, obj, output, 0 );
+			mk_async_mtxUnlock( &mk__g_bld_lock );
+
+			output = (char *)mk_com_memory( (void *)output, 0 );
+			r = 1;
+		}
+	}
+	if( r == -1 ) {
+		e = mk_bld__runStep( step );
+		mk_bldno_setExitStatus( node, e );
+		r = +( e == 0 );
+	}
+
+	/* early cutoff: an object that came out the same (e.g., only comments
+	   changed) doesn't need the project relinked */
+	if( r == 1 && step->linkstep != (MkBuildStep *)0 ) {
+		if( mk_bld__isUnchanged( obj, hadPrev, prevHash ) ) {
+			mk_dbg_outf( "\"%s\" is unchanged\n", obj );
+
+			mk_async_mtxLock( &mk__g_bld_lock );
+			--step->linkstep->numbuilds;
+			mk_async_mtxUnlock( &mk__g_bld_lock );
+		} else {
+			mk_async_mtxLock( &mk__g_bld_lock );
+			mk_sl_pushBack( step->linkstep->changed, obj );
+			mk_async_mtxUnlock( &mk__g_bld_lock );
+		}
 	}
+
+	return r;
 }
 
-/* build a project */
-int mk_bld_makeProject( MkProject proj ) {
-	const char *src, *lnk, *tool, *cxx, *cc;
-	MkProject chld;
-	MkStrList objs;
-	size_t cwd_l;
+/* find the libraries a project's objects need, once per build
+   (must be called with mk__g_bld_lock held) */
+static int mk_bld__findLinkLibs( MkBuildStep *step ) {
+	const char *obj;
 	size_t i, n;
-	char cwd[PATH_MAX], obj[PATH_MAX], bin[PATH_MAX];
-	int numbuilds;
+	char dep[PATH_MAX];
 
-	/* build the child projects */
-	mk_bld_sortProjects( proj );
-	for( chld = mk_prj_head( proj ); chld; chld = mk_prj_next( chld ) ) {
-		if( !mk_bld_makeProject( chld ) ) {
+	if( step->scannedLibs ) {
+		return 1;
+	}
+	step->scannedLibs = 1;
+
+	n = mk_sl_getSize( step->objs );
+	for( i = 0; i < n; i++ ) {
+		obj = mk_sl_at( step->objs, i );
+
+		mk_com_substExt( dep, sizeof( dep ), obj, ".d" );
+		if( !mk_bld_findSourceLibs( step->proj->libs, step->proj->sys, obj, dep ) ) {
+			mk_log_errorMsg( "call to mk_bld_findSourceLibs() failed" );
 			return 0;
 		}
 	}
 
-	/* if this project isn't targetted, just return now */
-	if( !mk_prj_isTarget( proj ) )
-		return 1;
+	return 1;
+}
 
-	/* retrieve the current working directory */
-	if( getcwd( cwd, sizeof( cwd ) ) == (char *)0 ) {
-		mk_log_fatalError( "getcwd() failed" );
-	}
+/* make a link step wait for the projects providing its libraries; returns
+   kMkBuild_Deferred if any of them aren't built yet
+   (must be called with mk__g_bld_lock held) */
+static int mk_bld__waitForLibs( MkBuildStep *step, MkBuildNode node ) {
+	const char *libname;
+	MkLib lib;
+	size_t i, n;
+	int r;
 
-	cwd_l = mk_com_strlen( cwd );
+	r = 1;
 
-	/*
-	 *	NOTE: This appears to be a hack.
-	 */
-	if( !mk_prj_numSourceFiles( proj ) && mk_prj_getType( proj ) != kMkProjTy_StaticLib ) {
-		mk_log_errorMsg( mk_com_va( "project ^E'%s'^& has no source files!",
-		    mk_prj_getName( proj ) ) );
-		return 1;
+	n = mk_sl_getSize( step->proj->libs );
+	for( i = 0; i < n; i++ ) {
+		libname = mk_sl_at( step->proj->libs, i );
+		if( !libname ) {
+			continue;
+		}
+
+		lib = mk_lib_find( libname );
+		if( !lib || !lib->proj || lib->proj == step->proj || !lib->proj->bldnode ) {
+			continue;
+		}
+
+		switch( mk_bldno_addLateInput( node, lib->proj->bldnode ) ) {
+		case -1:
+			errno = 0;
+			mk_log_error( step->name, 0, (const char *)0, mk_com_va( "dependency '%s' failed to build", libname ) );
+			return 0;
+		case 1:
+			r = kMkBuild_Deferred;
+			break;
+		}
 	}
 
-	cc   = mk_bld_getCompiler( 0 );
-	cxx  = mk_bld_getCompiler( 1 );
-	tool = proj->config & kMkProjCfg_UsesCxx_Bit ? cxx : cc;
+	return r;
+}
 
-	/* make the object directories */
-	mk_prjfs_makeObjDirs( proj );
+/* determine whether any two objects have the same file name, which a regular
+   archive can't tell apart when replacing members */
+static int mk_bld__hasDuplicateNames( MkStrList objs ) {
+	MkStrList names;
+	const char *p;
+	size_t i, n;
+	int r;
 
-	/* store each object file */
-	objs = mk_sl_new();
+	names = mk_sl_new();
 
-	/* run through each source file */
-	numbuilds = 0;
-	n         = mk_prj_numSourceFiles( proj );
+	n = mk_sl_getSize( objs );
 	for( i = 0; i < n; i++ ) {
-		src = mk_prj_sourceFileAt( proj, i );
-		mk_bld_getObjName( proj, obj, sizeof( obj ), &src[cwd_l + 1] );
-		mk_sl_pushBack( objs, obj );
-
-		if( mk_bld_shouldCompile( obj ) ) {
-			if( mk_com_shellf( "%s %s", tool,
-			        mk_bld_getCFlags( proj, obj, &src[cwd_l + 1] ) ) ) {
-				mk_sl_delete( objs );
-				return 0;
+		p = strrchr( mk_sl_at( objs, i ), '/' );
+		mk_sl_pushBack( names, p != (const char *)0 ? p + 1 : mk_sl_at( objs, i ) );
+	}
+	mk_sl_sort( names );
+
+	r = 0;
+	for( i = 1; i < n && !r; i++ ) {
+		r = +( strcmp( mk_sl_at( names, i - 1 ), mk_sl_at( names, i ) ) == 0 );
+	}
+
+	mk_sl_delete( names );
+	return r;
+}
+
+/*
+================
+mk_bld__canUpdateArchive
+
+determine whether a static library can be brought up to date by replacing
+just the objects that changed, rather than being made again from all of them:
+it has to be exactly what the same command made last time, and some of its
+objects have to be the same still
+================
+*/
+static int mk_bld__canUpdateArchive( MkBuildStep *step, const char *bin ) {
+	size_t n;
+
+	n = mk_sl_getSize( step->changed );
+	if( !n || n >= mk_sl_getSize( step->objs ) ) {
+		return 0;
+	}
+
+	/* thin archives name their members by path */
+	if( ( ~mk__g_flags & kMkFlag_ThinArchives_Bit ) && mk_bld__hasDuplicateNames( step->objs ) ) {
+		return 0;
+	}
+
+	return +( mk_bdb_checkOutput( bin, step->cmdHash ) == kMkBdb_UpToDate );
+}
+
+/* decide whether a project needs linking and, if so, form the command
+   (must be called with mk__g_bld_lock held) */
+static int mk_bld__prepareLink( MkBuildStep *step, const char *bin ) {
+	MkProject proj;
+	MkStrList objs;
+	MkStatsTimer timer;
+	const char *lnk;
+	int remake, relink, numbuilds;
+
+	proj = step->proj;
+
+	/* a static library made by another command than now (e.g., with another
+	   archiver, or before --thin-archives) is made again */
+	remake    = 0;
+	relink    = +( ( proj->config & kMkProjCfg_NeedRelink_Bit ) != 0 );
+	numbuilds = step->numbuilds;
+	if( mk_prj_getType( proj ) == kMkProjTy_StaticLib ) {
+		MkBdbStatus_t status;
+
+		mk_stats_beginPhase( &timer );
+		step->cmdHash = mk_com_hashStr64( MK_HASH64_INIT, mk_com_va( "%s %s", mk_bld_getArchiver(), mk_bld_getLFlags( proj, bin, step->objs ) ) );
+		mk_stats_endPhase( kMkStats_Flags, &timer );
+
+		/* an archive holds only its own objects, so another library changing
+		   (which marks this one to be relinked) has nothing to do with it */
+		relink = 0;
+		if( ~mk__g_flags & kMkFlag_NoLink_Bit ) {
+			status = mk_bdb_checkOutput( bin, step->cmdHash );
+			remake = +( status == kMkBdb_OutOfDate );
+
+			/* none of its objects changed and it's what was made last time */
+			if( status == kMkBdb_UpToDate && !mk_sl_getSize( step->changed ) && ( ~mk__g_flags & kMkFlag_Rebuild_Bit ) ) {
+				numbuilds = 0;
 			}
-			numbuilds++;
+		}
+	}
+
+	if( !relink && !remake && !mk_bld_shouldLink( bin, numbuilds ) ) {
+		if( ~mk__g_flags & kMkFlag_FullClean_Bit ) {
+			mk_prj_calcDeps( proj );
 		}
 
-		mk_com_substExt( bin, sizeof( bin ), obj, ".d" );
-		if( ( ~mk__g_flags & kMkFlag_NoLink_Bit ) && !mk_bld_findSourceLibs( proj->libs, proj->sys, obj, bin ) ) {
-			mk_log_errorMsg( "call to mk_bld_findSourceLibs() failed" );
-			return 0;
+		return 1;
+	}
+
+	mk_fs_makeDirs( mk_prj_getOutPath( proj ) );
+	mk_sl_makeUnique( proj->libs );
+	mk_prj_calcLibFlags( proj );
+
+	lnk  = step->tool;
+	objs = step->objs;
+	if( mk_prj_getType( proj ) == kMkProjTy_StaticLib ) {
+		lnk = mk_bld_getArchiver();
+
+		step->updating = !remake && mk_bld__canUpdateArchive( step, bin );
+		if( step->updating ) {
+			objs = step->changed;
+		}
+	}
+
+	mk_stats_beginPhase( &timer );
+	step->cmd = mk_com_dup( step->cmd, mk_com_va( "%s %s", lnk, mk_bld_getLFlags( proj, bin, objs ) ) );
+	mk_stats_endPhase( kMkStats_Flags, &timer );
+	return 1;
+}
+
+/* build node function: link a project once all of its objects are built */
+static int mk_bld__link_f( MkBuildNode node, void *userData, MkStrList inputs, MkStrList outputs ) {
+	MkBuildStep *step;
+	mk_uint64_t prevHash, prevIface, iface;
+	const char *bin;
+	int hadPrev, hadPrevIface;
+	int r, e;
+
+	(void)inputs;
+	(void)outputs;
+
+	step = (MkBuildStep *)userData;
+	bin  = mk_bldno_getFilename( node );
+
+	/* the libraries linked against are only known once the objects exist */
+	mk_async_mtxLock( &mk__g_bld_lock );
+	r = 1;
+	if( ~mk__g_flags & kMkFlag_NoLink_Bit ) {
+		r = mk_bld__findLinkLibs( step );
+		if( r == 1 ) {
+			r = mk_bld__waitForLibs( step, node );
 		}
 	}
+	if( r == 1 ) {
+		r = mk_bld__prepareLink( step, bin );
+	}
+	mk_async_mtxUnlock( &mk__g_bld_lock );
+
+	if( r != 1 || !step->cmd ) {
+		return r;
+	}
+
+	hadPrev = mk_fs_hashFile( bin, &prevHash );
+
+	/* programs only depend on what a shared library exports */
+	hadPrevIface = 0;
+	if( mk_prj_getType( step->proj ) == kMkProjTy_DynamicLib ) {
+		hadPrevIface = mk_libif_hash( bin, &prevIface );
+	}
+
+	/* We need to delete static libraries first, due to `ar` not fully recreating the library. */
+	if( mk_prj_getType( step->proj ) == kMkProjTy_StaticLib && !step->updating ) {
+		remove( bin );
+		mk_fs_invalidate( bin );
+	}
+
+	e = mk_bld__runStep( step );
+	mk_bldno_setExitStatus( node, e );
+	if( e != 0 ) {
+		return 0;
+	}
+	step->archived = +( mk_prj_getType( step->proj ) == kMkProjTy_StaticLib );
+
+	/* early cutoff: what links against this only has to be relinked if it
+	   actually changed (a thin archive can stay the same while its members
+	   don't) */
+	if( !( ( mk__g_flags & kMkFlag_ThinArchives_Bit ) && step->archived && mk_sl_getSize( step->changed ) > 0 ) &&
+	    mk_bld__isUnchanged( bin, hadPrev, prevHash ) ) {
+		mk_dbg_outf( "\"%s\" is unchanged; not relinking its dependents\n", bin );
+		return 1;
+	}
+	if( hadPrevIface && mk_libif_hash( bin, &iface ) && iface == prevIface ) {
+		mk_dbg_outf( "\"%s\" exports the same interface; not relinking its dependents\n", bin );
+		return 1;
+	}
+
+	/* dependent projects need to be rebuilt */
+	mk_async_mtxLock( &mk__g_bld_lock );
+	mk_bld_relinkDeps( step->proj );
+	mk_async_mtxUnlock( &mk__g_bld_lock );
+
+	return 1;
+}
+
+/*
+ *	How long jobs that haven't been timed yet are guessed to take, in
+ *	milliseconds; only how they compare to each other (and to the jobs that
+ *	have been timed) matters for scheduling.
+ */
+enum {
+	kMkBldEst_Compile       = 20,
+	kMkBldEst_CompilePerKiB = 1,
+	kMkBldEst_CompilePerDep = 2,
+	kMkBldEst_Link          = 50,
+	kMkBldEst_LinkPerObj    = 2,
+	kMkBldEst_Archive       = 5,
+	kMkBldEst_ArchivePerObj = 1
+};
+
+/* estimate how long compiling a source file will take: as long as it did last
+   time, or else going by its size and how many files it includes */
+static mk_uint32_t mk_bld__estimateCompile( const char *obj, const char *src ) {
+	MkStat_t s;
+	mk_uint32_t ms;
+	MkDep d;
+
+	if( ( ms = mk_bdb_getDuration( obj ) ) != 0 ) {
+		return ms;
+	}
+
+	ms = kMkBldEst_Compile;
+	if( mk_fs_stat( src, &s ) ) {
+		ms += ( mk_uint32_t )( s.st_size/1024 )*kMkBldEst_CompilePerKiB;
+	}
+	if( ( d = mk_dep_find( obj ) ) != (MkDep)0 ) {
+		ms += ( mk_uint32_t )mk_dep_getSize( d )*kMkBldEst_CompilePerDep;
+	}
+
+	return ms;
+}
+/* estimate how long linking (or archiving) a project will take */
+static mk_uint32_t mk_bld__estimateLink( MkProject proj, const char *bin, size_t numObjs ) {
+	mk_uint32_t ms;
+
+	if( ( ms = mk_bdb_getDuration( bin ) ) != 0 ) {
+		return ms;
+	}
+
+	if( mk_prj_getType( proj ) == kMkProjTy_StaticLib ) {
+		return kMkBldEst_Archive + ( mk_uint32_t )numObjs*kMkBldEst_ArchivePerObj;
+	}
+
+	return kMkBldEst_Link + ( mk_uint32_t )numObjs*kMkBldEst_LinkPerObj;
+}
+/* remember how long making a file took, smoothing out the odd slow run */
+static void mk_bld__recordDuration( const char *file, mk_uint32_t ms ) {
+	mk_uint32_t prev;
+
+	if( ( prev = mk_bdb_getDuration( file ) ) != 0 ) {
+		ms = ( mk_uint32_t )( ( ( mk_uint64_t )prev + ms + 1 )/2 );
+	}
+
+	mk_bdb_setDuration( file, ms );
+}
+
+/*
+ *	add a project's compile and link steps to a build graph, followed by those
+ *	of its children; `prntnode` is the node of the nearest targeted ancestor,
+ *	which has to wait for every targeted descendant
+ */
+static void mk_bld__addProject_r( MkBuildContext ctx, MkProject proj, MkBuildNode prntnode ) {
+	const char *src, *tool;
+	MkBuildStep *linkstep, *compstep;
+	char *cmd;
+	MkBuildNode linknode, node;
+	MkProject chld;
+	MkStatsTimer timer;
+	mk_uint32_t flags;
+	int stale;
+	size_t cwd_l;
+	size_t i, n;
+	char cwd[PATH_MAX], obj[PATH_MAX], bin[PATH_MAX];
+
+	linknode = (MkBuildNode)0;
+
+	/* only targetted projects are built */
+	if( mk_prj_isTarget( proj ) ) {
+		/*
+		 *	NOTE: This appears to be a hack.
+		 */
+		if( !mk_prj_numSourceFiles( proj ) && mk_prj_getType( proj ) != kMkProjTy_StaticLib ) {
+			mk_log_errorMsg( mk_com_va( "project ^E'%s'^& has no source files!",
+			    mk_prj_getName( proj ) ) );
+		} else {
+			/* retrieve the current working directory */
+			if( getcwd( cwd, sizeof( cwd ) ) == (char *)0 ) {
+				mk_log_fatalError( "getcwd() failed" );
+			}
+
+			cwd_l = mk_com_strlen( cwd );
 
-	/* link the project's object files together */
-	mk_bld_getBinName( proj, bin, sizeof( bin ) );
-	if( mk_sl_getSize( objs ) > 0 ) {
-		/*printf("bin: %s\n", bin);*/
-		if( ( proj->config & kMkProjCfg_NeedRelink_Bit ) || mk_bld_shouldLink( bin, numbuilds ) ) {
-			mk_fs_makeDirs( mk_prj_getOutPath( proj ) );
-			mk_sl_makeUnique( proj->libs );
-			mk_prj_calcLibFlags( proj );
+			tool = mk_bld_getCompiler( ( proj->config & kMkProjCfg_UsesCxx_Bit ) != 0 );
 
-			lnk = tool;
-			if( mk_prj_getType( proj ) == kMkProjTy_StaticLib ) {
-				lnk = "ar"; /* FIXME: Allow configuration of this. */
+			/* make the object directories */
+			mk_prjfs_makeObjDirs( proj );
+
+			/* the link step waits on the project's compiles; the libraries it
+			   links against are added once it knows them (see mk_bld__link_f) */
+			mk_bld_getBinName( proj, bin, sizeof( bin ) );
+			n = mk_prj_numSourceFiles( proj );
 
-				/* We need to delete static libraries first, due to `ar` not fully recreating the library. */
-				mk_fs_remove( bin );
+			flags = kMkBldNo_Target_Bit;
+			if( !n || ( mk__g_flags & kMkFlag_NoLink_Bit ) ) {
+				flags |= kMkBldNo_Phony_Bit;
 			}
 
-			if( mk_com_shellf( "%s %s", lnk, mk_bld_getLFlags( proj, bin, objs ) ) ) {
-				mk_sl_delete( objs );
-				return 0;
+			linkstep          = mk_bld__newStep( proj, tool, (const char *)0, bin );
+			linkstep->objs    = mk_sl_new();
+			linkstep->changed = mk_sl_new();
+			linknode       = mk_bldctx_addNode( ctx, bin, flags, n > 0 ? &mk_bld__link_f : (mk_build_func_t)0, (void *)linkstep );
+			mk_bldno_setTraceKind( linknode, mk_prj_getType( proj ) == kMkProjTy_StaticLib ? kMkTrace_Archive : kMkTrace_Link );
+			mk_bldno_setCost( linknode, mk_bld__estimateLink( proj, bin, n ) );
+
+			/* run through each source file */
+			for( i = 0; i < n; i++ ) {
+				src = mk_prj_sourceFileAt( proj, i );
+				mk_bld_getObjName( proj, obj, sizeof( obj ), &src[cwd_l + 1] );
+				mk_sl_pushBack( linkstep->objs, obj );
+
+				mk_stats_beginPhase( &timer );
+				cmd = mk_com_strdup( mk_com_va( "%s %s", tool, mk_bld_getCFlags( proj, obj, &src[cwd_l + 1] ) ) );
+				mk_stats_endPhase( kMkStats_Flags, &timer );
+
+				mk_stats_beginPhase( &timer );
+				stale = mk_bld_shouldCompile( obj, cmd );
+				mk_stats_endPhase( kMkStats_UpToDate, &timer );
+
+				if( stale ) {
+					compstep           = mk_bld__newStep( proj, tool, cmd, &src[cwd_l + 1] );
+					compstep->linkstep = linkstep;
+
+					node = mk_bldctx_addNode( ctx, obj, 0, &mk_bld__compile_f, (void *)compstep );
+					mk_bldno_setTraceKind( node, kMkTrace_Compile );
+					mk_bldno_setCost( node, mk_bld__estimateCompile( obj, src ) );
+					mk_bldno_addInput( linknode, node );
+
+					linkstep->numbuilds++;
+				}
+				cmd = (char *)mk_com_memory( (void *)cmd, 0 );
 			}
 
-			/* dependent projects need to be rebuilt */
-			mk_bld_relinkDeps( proj );
-		} else if( ~mk__g_flags & kMkFlag_FullClean_Bit ) {
-			mk_prj_calcDeps( proj );
+			if( prntnode != (MkBuildNode)0 ) {
+				mk_bldno_addInput( prntnode, linknode );
+			}
 		}
 	}
 
+	proj->bldnode = linknode;
+
+	/* add the child projects */
+	mk_bld_sortProjects( proj );
+	for( chld = mk_prj_head( proj ); chld; chld = mk_prj_next( chld ) ) {
+		mk_bld__addProject_r( ctx, chld, linknode != (MkBuildNode)0 ? linknode : prntnode );
+	}
+}
+
+/* run the unit tests of, and clean up after, the projects that were built */
+static void mk_bld__finishProject_r( MkProject proj ) {
+	const MkBuildStep *step;
+	MkProject chld;
+	size_t i, n;
+	char dep[PATH_MAX];
+
+	for( chld = mk_prj_head( proj ); chld; chld = mk_prj_next( chld ) ) {
+		mk_bld__finishProject_r( chld );
+	}
+
+	if( !proj->bldnode || !( mk_bldno_getFlags( proj->bldnode ) & kMkBldNo_Built_Bit ) ) {
+		return;
+	}
+
+	step = (const MkBuildStep *)mk_bldno_getUserData( proj->bldnode );
+
 	/* unit testing */
 	if( mk__g_flags & kMkFlag_Test_Bit ) {
 		n = mk_prj_numTestSourceFiles( proj );
@@ -1539,28 +3199,155 @@ int mk_bld_makeProject( MkProject proj ) {
 		}
 	}
 
+	/* benchmarking */
+	if( mk__g_flags & kMkFlag_Bench_Bit ) {
+		n = mk_prj_numBenchSourceFiles( proj );
+		for( i = 0; i < n; i++ ) {
+			mk_bld_benchmark( proj, mk_prj_benchSourceFileAt( proj, i ) );
+		}
+	}
+
 	/* clean (removes temporaries) -- only if not rebuilding */
 	if( mk__g_flags & kMkFlag_LightClean_Bit ) {
-		n = mk_sl_getSize( objs );
+		n = mk_sl_getSize( step->objs );
 		for( i = 0; i < n; i++ ) {
-			mk_com_substExt( obj, sizeof( obj ), mk_sl_at( objs, i ), ".d" );
-			mk_fs_remove( mk_sl_at( objs, i ) ); /* object (.o) */
-			mk_fs_remove( obj ); /* dependency (.d) */
+			mk_com_substExt( dep, sizeof( dep ), mk_sl_at( step->objs, i ), ".d" );
+			mk_fs_remove( mk_sl_at( step->objs, i ) ); /* object (.o) */
+			mk_fs_remove( dep ); /* dependency (.d) */
 		}
 
 		if( mk__g_flags & kMkFlag_NoLink_Bit ) {
-			mk_fs_remove( bin );
+			mk_fs_remove( step->name );
 		}
 	}
+}
 
-	mk_sl_delete( objs );
+/* remember what made a static library, so the next build can update it */
+static void mk_bld__recordArchive( MkBuildNode node, const MkBuildStep *step ) {
+	const char *bin;
+	size_t i, n;
+	MkDep d;
 
-	return 1;
+	bin = mk_bldno_getFilename( node );
+
+	if( ~mk_bldno_getFlags( node ) & kMkBldNo_Built_Bit ) {
+		mk_bdb_removeObject( bin );
+		return;
+	}
+	if( !step->archived ) {
+		return;
+	}
+
+	d = mk_dep_new( bin );
+	n = mk_sl_getSize( step->objs );
+	for( i = 0; i < n; i++ ) {
+		mk_dep_push( d, mk_sl_at( step->objs, i ) );
+	}
+
+	mk_bdb_setObject( bin, step->cmdHash, d, 0 );
+	mk_dep_delete( d );
+}
+
+/* update the build state of every object a build graph tried to compile */
+static void mk_bld__recordObjects( MkBuildContext ctx ) {
+	const MkBuildStep *step;
+	MkBuildNode node;
+	const char *obj;
+	mk_uint32_t i;
+	MkDep d;
+	char dep[PATH_MAX];
+
+	for( i = 0; i < mk_bldctx_numNodes( ctx ); i++ ) {
+		node = mk_bldctx_nodeAt( ctx, i );
+		obj  = mk_bldno_getFilename( node );
+		step = (const MkBuildStep *)mk_bldno_getUserData( node );
+
+		if( step != (const MkBuildStep *)0 && step->duration != 0 ) {
+			mk_bld__recordDuration( obj, step->duration );
+		}
+
+		if( mk_bldno_getFlags( node ) & kMkBldNo_Target_Bit ) {
+			if( step != (const MkBuildStep *)0 && mk_prj_getType( step->proj ) == kMkProjTy_StaticLib ) {
+				mk_bld__recordArchive( node, step );
+			}
+			continue;
+		}
+
+		if( ~mk_bldno_getFlags( node ) & kMkBldNo_Built_Bit ) {
+			mk_bdb_removeObject( obj );
+			continue;
+		}
+
+		/* the link step usually read the new dependencies already */
+		if( !( d = mk_dep_find( obj ) ) ) {
+			mk_com_substExt( dep, sizeof( dep ), obj, ".d" );
+			if( mk_mfdep_load( dep ) ) {
+				d = mk_dep_find( obj );
+			}
+		}
+
+		if( !d ) {
+			mk_bdb_removeObject( obj );
+			continue;
+		}
+
+		mk_bdb_setObject( obj, mk_com_hashStr64( MK_HASH64_INIT, step->cmd ), d, step->started );
+		mk_oc_store( step->cacheKey, obj, d, step->output, ( time_t )( step->started/1000000000ULL ) );
+	}
+
+	mk_oc_flush();
+
+	if( !mk_bdb_save() ) {
+		mk_dbg_outf( "failed to save the build state\n" );
+	}
+}
+
+/* release a build graph along with the steps attached to its nodes */
+static void mk_bld__deleteGraph( MkBuildContext ctx ) {
+	MkBuildStep *step;
+	MkBuildNode node;
+	mk_uint32_t i;
+
+	for( i = 0; i < mk_bldctx_numNodes( ctx ); i++ ) {
+		node = mk_bldctx_nodeAt( ctx, i );
+		step = (MkBuildStep *)mk_bldno_getUserData( node );
+
+		if( step != (MkBuildStep *)0 && ( mk_bldno_getFlags( node ) & kMkBldNo_Target_Bit ) ) {
+			step->proj->bldnode = (MkBuildNode)0;
+			mk_sl_delete( step->objs );
+			mk_sl_delete( step->changed );
+		}
+
+		mk_bld__deleteStep( step );
+	}
+
+	mk_bldctx_delete( ctx );
+}
+
+/* build a project and its children */
+int mk_bld_makeProject( MkProject proj ) {
+	MkBuildContext ctx;
+	int r;
+
+	MK_ASSERT( proj != (MkProject)0 );
+
+	ctx = mk_bldctx_new();
+	mk_bld__addProject_r( ctx, proj, (MkBuildNode)0 );
+
+	r = mk_bldctx_run( ctx, mk__g_numJobs );
+	mk_bld__recordObjects( ctx );
+	mk_bld__finishProject_r( proj );
+
+	mk_bld__deleteGraph( ctx );
+	return r;
 }
 
 /* build all the projects */
 int mk_bld_makeAllProjects( void ) {
+	MkBuildContext ctx;
 	MkProject proj;
+	mk_uint64_t start;
+	int r;
 
 	if( mk__g_flags & kMkFlag_FullClean_Bit ) {
 		mk_fs_remove( mk_opt_getObjdirBase() );
@@ -1570,13 +3357,78 @@ int mk_bld_makeAllProjects( void ) {
 
 	mk_git_generateInfo();
 
+	/* only once, even if --watch builds again */
+	if( mk__g_seedDir != (const char *)0 ) {
+		mk_seed_objdir( mk__g_seedDir, mk__g_seedMethods );
+		mk__g_seedDir = (const char *)0;
+	}
+
+	/* one graph for every project, so no project's compiles wait on another's;
+	   finding what's out of date happens along the way */
+	start = mk_com_getTimeNs();
+	ctx = mk_bldctx_new();
 	for( proj = mk_prj_rootHead(); proj; proj = mk_prj_next( proj ) ) {
-		if( !mk_bld_makeProject( proj ) ) {
-			return 0;
-		}
+		mk_bld__addProject_r( ctx, proj, (MkBuildNode)0 );
 	}
+	mk_trace_add( mk_trace_getBuffer( 0 ), kMkTrace_DepScan, "check dependencies", start, mk_com_getTimeNs(), kMkTrace_NoStatus, (const char *)0 );
 
-	mk_bld_runTests();
+	r = mk_bldctx_run( ctx, mk__g_numJobs );
+	mk_bld__recordObjects( ctx );
+	for( proj = mk_prj_rootHead(); proj; proj = mk_prj_next( proj ) ) {
+		mk_bld__finishProject_r( proj );
+	}
 
-	return 1;
+	mk_bld__deleteGraph( ctx );
+
+	if( r ) {
+		mk_bld_runTests();
+		r = mk_bld_runBenchmarks();
+	}
+
+	(void)mk_trace_write();
+	(void)mk_stats_report();
+	return r;
+}
+
+static void mk_bld__resetProject_r( MkProject proj ) {
+	MkProject chld;
+
+	proj->config &= ~kMkProjCfg_NeedRelink_Bit;
+
+	for( chld = mk_prj_head( proj ); chld; chld = mk_prj_next( chld ) ) {
+		mk_bld__resetProject_r( chld );
+	}
+}
+
+/*
+================
+mk_bld_resetBuildState
+
+forget what the last build found out, keeping the projects, so that another
+build can be run in the same process (e.g., by `mk --watch`). Files that have
+changed since must have been passed to mk_fs_invalidate().
+================
+*/
+void mk_bld_resetBuildState( void ) {
+	MkProject proj;
+
+	for( proj = mk_prj_rootHead(); proj; proj = mk_prj_next( proj ) ) {
+		mk_bld__resetProject_r( proj );
+	}
+
+	mk_sl_clear( mk__g_unitTestCompiles );
+	mk_sl_clear( mk__g_unitTestRuns );
+	mk_sl_clear( mk__g_unitTestNames );
+	mk_sl_clear( mk__g_unitTestLibs );
+	mk_sl_clear( mk__g_unitTestObjs );
+	mk_sl_clear( mk__g_unitTestLinks );
+
+	mk_sl_clear( mk__g_benchCompiles );
+	mk_sl_clear( mk__g_benchRuns );
+	mk_sl_clear( mk__g_benchNames );
+	mk_sl_clear( mk__g_benchLibs );
+
+	/* dependency lists are reread from the build state or the .d files */
+	mk_dep_deleteAll();
+	mk_bdb_forgetStats();
 }
@@ -40,12 +40,15 @@
 void mk_bld_initUnitTestArrays( void );
 void mk_bld_unitTest( MkProject proj, const char *src );
 void mk_bld_runTests( void );
+void mk_bld_benchmark( MkProject proj, const char *src );
+int  mk_bld_runBenchmarks( void );
 
 int mk_bld_findSourceLibs( MkStrList dst, int sys, const char *obj, const char *dep );
-int mk_bld_shouldCompile( const char *obj );
+int mk_bld_shouldCompile( const char *obj, const char *cmd );
 int mk_bld_shouldLink( const char *bin, int numbuilds );
 
 const char *mk_bld_getCompiler( int iscxx );
+const char *mk_bld_getArchiver( void );
 void        mk_bld_getCFlags_warnings( char *flags, size_t nflags );
 int         mk_bld_getCFlags_standard( char *flags, size_t nflags, const char *filename );
 void        mk_bld_getCFlags_config( char *flags, size_t nflags, int projarch );
@@ -72,3 +75,4 @@ void mk_bld_sortProjects( struct MkProject_s *proj );
 void mk_bld_relinkDeps( MkProject proj );
 int  mk_bld_makeProject( MkProject proj );
 int  mk_bld_makeAllProjects( void );
+void mk_bld_resetBuildState( void );
@@ -16,14 +16,27 @@
 
 #include "mk-basic-assert.h"
 #include "mk-basic-common.h"
+#include "mk-basic-logging.h"
+#include "mk-basic-stringBuilder.h"
+#include "mk-basic-stringList.h"
 #include "mk-build-project.h"
 
+#include <limits.h>
 #include <stddef.h>
 #include <string.h>
 
+#define MK_LIB__WORD_BITS ( sizeof( bitfield_t )*CHAR_BIT )
+
 struct MkLib_s *mk__g_lib_head = (struct MkLib_s *)0;
 struct MkLib_s *mk__g_lib_tail = (struct MkLib_s *)0;
 
+/* number of library indices handed out so far */
+static size_t mk__g_lib_numIndices = 0;
+
+/* bumped whenever any project's library list changes (starts nonzero so new
+   libraries' sets begin out of date) */
+static size_t mk__g_lib_depsGeneration = 1;
+
 /* create a new library */
 MkLib mk_lib_new( void ) {
 	size_t i;
@@ -40,6 +53,15 @@ MkLib mk_lib_new( void ) {
 
 	lib->config = 0;
 
+	lib->index           = mk__g_lib_numIndices++;
+	lib->deps            = (bitfield_t *)0;
+	lib->numDepWords     = 0;
+	lib->depsGeneration  = 0;
+	lib->visitGeneration = 0;
+	lib->visitIndex      = 0;
+	lib->lowLink         = 0;
+	lib->onStack         = 0;
+
 	lib->next = (struct MkLib_s *)0;
 	if( ( lib->prev = mk__g_lib_tail ) != (struct MkLib_s *)0 ) {
 		mk__g_lib_tail->next = lib;
@@ -64,6 +86,10 @@ void mk_lib_delete( MkLib lib ) {
 	for( i = 0; i < sizeof( lib->flags ) / sizeof( lib->flags[0] ); i++ ) {
 		lib->flags[i] = (char *)mk_com_memory( (void *)lib->flags[i], 0 );
 	}
+	lib->deps = (bitfield_t *)mk_com_memory( (void *)lib->deps, 0 );
+
+	/* other libraries' sets may go through this one */
+	++mk__g_lib_depsGeneration;
 
 	if( lib->prev ) {
 		lib->prev->next = lib->next;
@@ -94,6 +120,9 @@ void mk_lib_setName( MkLib lib, const char *name ) {
 
 	lib->name_n = name != (const char *)0 ? strlen( name ) : 0;
 	lib->name   = mk_com_dup( lib->name, name );
+
+	/* project library lists may refer to this name */
+	++mk__g_lib_depsGeneration;
 }
 
 /* set the flags of a library */
@@ -181,6 +210,259 @@ MkLib mk_lib_lookup( const char *name ) {
 	return lib;
 }
 
+/*
+ *	Transitive dependencies
+ *
+ *	A library depends on the libraries listed by its project, and on everything
+ *	those depend on. These sets are computed together for each strongly
+ *	connected component of the dependency graph (Tarjan's algorithm), so the
+ *	members of a cycle all share one set, and each set is built once until a
+ *	project's library list changes.
+ */
+
+typedef struct MkLibVisit_s {
+	size_t counter;
+
+	MkLib *stack;
+	size_t stackSize;
+	size_t stackCapacity;
+} MkLibVisit;
+
+/* mark the dependency sets out of date; call when a project's libraries change */
+void mk_lib_invalidateDeps( void ) {
+	++mk__g_lib_depsGeneration;
+}
+
+/* retrieve the library for entry `i` of a library's project's list, if any */
+static MkLib mk_lib__directDep( MkLib lib, size_t i ) {
+	const char *name;
+	MkLib dep;
+
+	if( !( name = mk_sl_at( lib->proj->libs, i ) ) ) {
+		return (MkLib)0;
+	}
+
+	if( !( dep = mk_lib_find( name ) ) || dep == lib ) {
+		return (MkLib)0;
+	}
+
+	return dep;
+}
+
+/* add a library and its dependency set to a set */
+static void mk_lib__mergeDeps( bitfield_t *dst, MkLib dep, int withDepsOf ) {
+	size_t i;
+
+	dst[dep->index / MK_LIB__WORD_BITS] |= ( bitfield_t )1 << ( dep->index % MK_LIB__WORD_BITS );
+
+	if( withDepsOf ) {
+		for( i = 0; i < dep->numDepWords; ++i ) {
+			dst[i] |= dep->deps[i];
+		}
+	}
+}
+
+/* report a dependency cycle, once per library involved */
+static void mk_lib__reportCycle( MkLib *members, size_t n ) {
+	MkStringBuilder sb;
+	char *msg;
+	size_t i;
+	int isNew;
+
+	isNew = 0;
+	for( i = 0; i < n; ++i ) {
+		if( ~members[i]->config & kMkLib_CycleReported_Bit ) {
+			members[i]->config |= kMkLib_CycleReported_Bit;
+			isNew = 1;
+		}
+	}
+	if( !isNew ) {
+		return;
+	}
+
+	mk_sb_init( &sb, 0 );
+	mk_sb_pushStr( &sb, "libraries depend on each other:" );
+	for( i = 0; i < n; ++i ) {
+		mk_sb_pushStr( &sb, i ? ", \"" : " \"" );
+		mk_sb_pushStr( &sb, members[i]->name ? members[i]->name : "(unnamed)" );
+		mk_sb_pushChar( &sb, '\"' );
+	}
+
+	msg = mk_sb_done( &sb );
+	mk_log_errorMsg( msg );
+	msg = (char *)mk_com_memory( (void *)msg, 0 );
+}
+
+/* find the strongly connected component `lib` is in, and give every member
+   the dependency set of the whole component */
+static void mk_lib__calcDeps_r( MkLibVisit *visit, MkLib lib ) {
+	bitfield_t *deps;
+	size_t numWords, first, i, j, n;
+	MkLib dep;
+
+	lib->visitGeneration = mk__g_lib_depsGeneration;
+	lib->visitIndex      = visit->counter;
+	lib->lowLink         = visit->counter;
+	++visit->counter;
+
+	if( visit->stackSize == visit->stackCapacity ) {
+		visit->stackCapacity = visit->stackCapacity ? visit->stackCapacity*2 : 32;
+		visit->stack         = (MkLib *)mk_com_memory( (void *)visit->stack, sizeof( MkLib )*visit->stackCapacity );
+	}
+	visit->stack[visit->stackSize++] = lib;
+	lib->onStack = 1;
+
+	n = lib->proj ? mk_sl_getSize( lib->proj->libs ) : 0;
+	for( i = 0; i < n; ++i ) {
+		if( !( dep = mk_lib__directDep( lib, i ) ) ) {
+			continue;
+		}
+
+		if( dep->depsGeneration == mk__g_lib_depsGeneration ) {
+			continue; /* component already done */
+		}
+
+		if( dep->visitGeneration != mk__g_lib_depsGeneration ) {
+			mk_lib__calcDeps_r( visit, dep );
+			if( dep->lowLink < lib->lowLink ) {
+				lib->lowLink = dep->lowLink;
+			}
+		} else if( dep->onStack && dep->visitIndex < lib->lowLink ) {
+			lib->lowLink = dep->visitIndex;
+		}
+	}
+
+	if( lib->lowLink != lib->visitIndex ) {
+		return;
+	}
+
+	/* `lib` is the root of a component, which is on the stack above it */
+	for( first = visit->stackSize; visit->stack[--first] != lib; ) {
+	}
+
+	numWords = ( mk__g_lib_numIndices + MK_LIB__WORD_BITS - 1 ) / MK_LIB__WORD_BITS;
+	deps     = (bitfield_t *)mk_com_memory( (void *)0, sizeof( bitfield_t )*numWords );
+	memset( (void *)deps, 0, sizeof( bitfield_t )*numWords );
+
+	for( j = first; j < visit->stackSize; ++j ) {
+		n = visit->stack[j]->proj ? mk_sl_getSize( visit->stack[j]->proj->libs ) : 0;
+		for( i = 0; i < n; ++i ) {
+			if( ( dep = mk_lib__directDep( visit->stack[j], i ) ) != (MkLib)0 ) {
+				/* members of this component don't have their sets yet */
+				mk_lib__mergeDeps( deps, dep, dep->depsGeneration == mk__g_lib_depsGeneration );
+			}
+		}
+	}
+
+	for( j = first; j < visit->stackSize; ++j ) {
+		dep = visit->stack[j];
+
+		dep->onStack        = 0;
+		dep->depsGeneration = mk__g_lib_depsGeneration;
+		dep->numDepWords    = numWords;
+		dep->deps           = (bitfield_t *)mk_com_memory( (void *)dep->deps, sizeof( bitfield_t )*numWords );
+		memcpy( (void *)dep->deps, (const void *)deps, sizeof( bitfield_t )*numWords );
+	}
+
+	if( visit->stackSize - first > 1 ) {
+		mk_lib__reportCycle( &visit->stack[first], visit->stackSize - first );
+	}
+
+	visit->stackSize = first;
+	deps = (bitfield_t *)mk_com_memory( (void *)deps, 0 );
+}
+
+/* make sure a library's dependency set is up to date */
+static void mk_lib__updateDeps( MkLib lib ) {
+	MkLibVisit visit;
+
+	if( lib->depsGeneration == mk__g_lib_depsGeneration ) {
+		return;
+	}
+
+	visit.counter       = 0;
+	visit.stack         = (MkLib *)0;
+	visit.stackSize     = 0;
+	visit.stackCapacity = 0;
+
+	mk_lib__calcDeps_r( &visit, lib );
+
+	visit.stack = (MkLib *)mk_com_memory( (void *)visit.stack, 0 );
+}
+
+/* determine whether a library depends upon another, directly or not */
+int mk_lib_dependsOn( MkLib lib, MkLib deplib ) {
+	MK_ASSERT( lib != (MkLib)0 );
+	MK_ASSERT( deplib != (MkLib)0 );
+
+	mk_lib__updateDeps( lib );
+
+	if( deplib->index / MK_LIB__WORD_BITS >= lib->numDepWords ) {
+		return 0;
+	}
+
+	return ( lib->deps[deplib->index / MK_LIB__WORD_BITS] >> ( deplib->index % MK_LIB__WORD_BITS ) ) & 1 ? 1 : 0;
+}
+
+/*
+================
+mk_lib_sortByDeps
+
+order libraries for the linker: each library comes before the libraries it
+depends on. Libraries that don't depend on each other (or that depend on each
+other both ways) keep their relative order, so the result only depends on the
+order they were given in.
+================
+*/
+void mk_lib_sortByDeps( MkLib *libs, size_t n ) {
+	MkLib *sorted;
+	size_t *numBefore;
+	size_t i, j, k;
+
+	MK_ASSERT( libs != (MkLib *)0 || n == 0 );
+
+	if( n < 2 ) {
+		return;
+	}
+
+	sorted    = (MkLib *)mk_com_memory( (void *)0, sizeof( MkLib )*n );
+	numBefore = (size_t *)mk_com_memory( (void *)0, sizeof( size_t )*n );
+
+	/* count the libraries that have to be placed before each one */
+	for( i = 0; i < n; ++i ) {
+		numBefore[i] = 0;
+		for( j = 0; j < n; ++j ) {
+			if( i != j && mk_lib_dependsOn( libs[j], libs[i] ) && !mk_lib_dependsOn( libs[i], libs[j] ) ) {
+				++numBefore[i];
+			}
+		}
+	}
+
+	/* repeatedly take the first library that's free to go */
+	for( k = 0; k < n; ++k ) {
+		for( i = 0; i < n; ++i ) {
+			if( libs[i] != (MkLib)0 && numBefore[i] == 0 ) {
+				break;
+			}
+		}
+		MK_ASSERT( i < n ); /* edges only run between components, so no cycles */
+
+		sorted[k] = libs[i];
+		libs[i]   = (MkLib)0;
+
+		for( j = 0; j < n; ++j ) {
+			if( libs[j] != (MkLib)0 && mk_lib_dependsOn( sorted[k], libs[j] ) && !mk_lib_dependsOn( libs[j], sorted[k] ) ) {
+				--numBefore[j];
+			}
+		}
+	}
+
+	memcpy( (void *)libs, (const void *)sorted, sizeof( MkLib )*n );
+
+	numBefore = (size_t *)mk_com_memory( (void *)numBefore, 0 );
+	sorted    = (MkLib *)mk_com_memory( (void *)sorted, 0 );
+}
+
 /* mark all libraries as "not processed" */
 void mk_lib_clearAllProcessed( void ) {
 	MkLib lib;
@@ -31,7 +31,8 @@ struct MkProject_s;
 typedef struct MkLib_s *MkLib;
 
 enum {
-	kMkLib_Processed_Bit = 0x01 /* indicates a library has been "processed" */
+	kMkLib_Processed_Bit     = 0x01, /* indicates a library has been "processed" */
+	kMkLib_CycleReported_Bit = 0x02  /* a dependency cycle through this library was reported */
 };
 
 struct MkLib_s {
@@ -43,6 +44,20 @@ struct MkLib_s {
 
 	bitfield_t config;
 
+	/* this library's bit in other libraries' dependency sets */
+	size_t index;
+
+	/* every library this one depends on, directly or not, as a bitset over
+	   library indices; valid while `depsGeneration` is current */
+	bitfield_t *deps;
+	size_t numDepWords;
+	size_t depsGeneration;
+
+	/* state for finding strongly connected components of the dependency graph */
+	size_t visitGeneration;
+	size_t visitIndex, lowLink;
+	int onStack;
+
 	struct MkLib_s *prev, *next;
 };
 
@@ -62,6 +77,10 @@ MkLib mk_lib_tail( void );
 MkLib mk_lib_find( const char *name );
 MkLib mk_lib_lookup( const char *name );
 
+void mk_lib_invalidateDeps( void );
+int  mk_lib_dependsOn( MkLib lib, MkLib deplib );
+void mk_lib_sortByDeps( MkLib *libs, size_t n );
+
 void mk_lib_clearAllProcessed( void );
 void mk_lib_clearProcessed( MkLib lib );
 void mk_lib_setProcessed( MkLib lib );
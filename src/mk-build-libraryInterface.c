@@ -0,0 +1,321 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "mk-build-libraryInterface.h"
+
+#include "mk-basic-assert.h"
+#include "mk-basic-common.h"
+#include "mk-basic-stats.h"
+#include "mk-basic-types.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* the parts of the ELF format needed here (see elf(5)) */
+#define MK_ELF_CLASS32       1
+#define MK_ELF_CLASS64       2
+#define MK_ELF_DATA2LSB      1
+#define MK_ELF_DATA2MSB      2
+#define MK_ELF_SHT_DYNAMIC   6
+#define MK_ELF_SHT_DYNSYM    11
+#define MK_ELF_SHT_VERDEF    0x6FFFFFFDUL
+#define MK_ELF_SHT_VERSYM    0x6FFFFFFFUL
+#define MK_ELF_DT_NULL       0
+#define MK_ELF_DT_SONAME     14
+#define MK_ELF_STB_GLOBAL    1
+#define MK_ELF_STB_WEAK      2
+#define MK_ELF_STB_UNIQUE    10
+#define MK_ELF_STT_OBJECT    1
+#define MK_ELF_STT_TLS       6
+#define MK_ELF_STV_HIDDEN    2
+#define MK_ELF_STV_INTERNAL  1
+
+typedef struct MkLibIfFile_s {
+	const unsigned char *data;
+	size_t               size;
+	int                  is64;
+	int                  bigEndian;
+} MkLibIfFile;
+
+typedef struct MkLibIfSection_s {
+	mk_uint64_t type;
+	mk_uint64_t offset;
+	mk_uint64_t size;
+	mk_uint64_t link;
+	mk_uint64_t entsize;
+} MkLibIfSection;
+
+/* read an unsigned integer of `n` bytes at `off`; returns 0 if that's past
+   the end of the file */
+static int mk_libif__read( const MkLibIfFile *f, mk_uint64_t off, unsigned n, mk_uint64_t *dst ) {
+	mk_uint64_t v;
+	unsigned i;
+
+	if( off > f->size || n > f->size - off ) {
+		return 0;
+	}
+
+	v = 0;
+	for( i = 0; i < n; ++i ) {
+		if( f->bigEndian ) {
+			v = ( v << 8 ) | f->data[ off + i ];
+		} else {
+			v |= ( mk_uint64_t )f->data[ off + i ] << ( 8*i );
+		}
+	}
+
+	*dst = v;
+	return 1;
+}
+
+/* read a word: 8 bytes in 64-bit files, 4 in 32-bit */
+static int mk_libif__readWord( const MkLibIfFile *f, mk_uint64_t off, mk_uint64_t *dst ) {
+	return mk_libif__read( f, off, f->is64 ? 8 : 4, dst );
+}
+
+static int mk_libif__section( const MkLibIfFile *f, mk_uint64_t shoff, mk_uint64_t shentsize, mk_uint64_t i, MkLibIfSection *sec ) {
+	mk_uint64_t p;
+
+	p = shoff + i*shentsize;
+	if( f->is64 ) {
+		return mk_libif__read( f, p + 4, 4, &sec->type ) &&
+		       mk_libif__read( f, p + 24, 8, &sec->offset ) &&
+		       mk_libif__read( f, p + 32, 8, &sec->size ) &&
+		       mk_libif__read( f, p + 40, 4, &sec->link ) &&
+		       mk_libif__read( f, p + 56, 8, &sec->entsize );
+	}
+
+	return mk_libif__read( f, p + 4, 4, &sec->type ) &&
+	       mk_libif__read( f, p + 16, 4, &sec->offset ) &&
+	       mk_libif__read( f, p + 20, 4, &sec->size ) &&
+	       mk_libif__read( f, p + 24, 4, &sec->link ) &&
+	       mk_libif__read( f, p + 36, 4, &sec->entsize );
+}
+
+/* hash a string from a string table, which must be terminated within it */
+static int mk_libif__hashString( const MkLibIfFile *f, const MkLibIfSection *strtab, mk_uint64_t index, mk_uint64_t *hash ) {
+	const unsigned char *s, *e;
+
+	if( index >= strtab->size || strtab->offset > f->size || strtab->size > f->size - strtab->offset ) {
+		return 0;
+	}
+
+	s = &f->data[ strtab->offset + index ];
+	e = (const unsigned char *)memchr( (const void *)s, '\0', ( size_t )( strtab->size - index ) );
+	if( !e ) {
+		return 0;
+	}
+
+	*hash = mk_com_hash64( *hash, (const void *)s, ( size_t )( e - s ) + 1 );
+	return 1;
+}
+
+/*
+================
+mk_libif__hashElf
+
+fingerprint the interface of an ELF shared library held in memory. Symbols
+are combined in a way that doesn't depend on their order in the table.
+================
+*/
+static int mk_libif__hashElf( const MkLibIfFile *f, mk_uint64_t *dst ) {
+	MkLibIfSection sec, dynsym, dynstr, versym, verdef, dynamic;
+	mk_uint64_t shoff, shentsize, shnum;
+	mk_uint64_t i, n, p, v, name, info, other, shndx, size, ver, tag;
+	mk_uint64_t hash, symbols, symHash;
+	unsigned bind, type;
+
+	if( !mk_libif__readWord( f, f->is64 ? 40 : 32, &shoff ) ||
+	    !mk_libif__read( f, f->is64 ? 58 : 46, 2, &shentsize ) ||
+	    !mk_libif__read( f, f->is64 ? 60 : 48, 2, &shnum ) ) {
+		return 0;
+	}
+
+	memset( (void *)&dynsym, 0, sizeof( dynsym ) );
+	memset( (void *)&versym, 0, sizeof( versym ) );
+	memset( (void *)&verdef, 0, sizeof( verdef ) );
+	memset( (void *)&dynamic, 0, sizeof( dynamic ) );
+
+	for( i = 0; i < shnum; ++i ) {
+		if( !mk_libif__section( f, shoff, shentsize, i, &sec ) ) {
+			return 0;
+		}
+
+		if( sec.type == MK_ELF_SHT_DYNSYM ) {
+			dynsym = sec;
+		} else if( sec.type == MK_ELF_SHT_VERSYM ) {
+			versym = sec;
+		} else if( sec.type == MK_ELF_SHT_VERDEF ) {
+			verdef = sec;
+		} else if( sec.type == MK_ELF_SHT_DYNAMIC ) {
+			dynamic = sec;
+		}
+	}
+
+	/* no dynamic symbols: not a shared library */
+	if( !dynsym.size || dynsym.entsize < ( f->is64 ? 24U : 16U ) ||
+	    !mk_libif__section( f, shoff, shentsize, dynsym.link, &dynstr ) ) {
+		return 0;
+	}
+
+	hash = MK_HASH64_INIT;
+
+	/* the soname */
+	n = dynamic.entsize ? dynamic.size/dynamic.entsize : 0;
+	for( i = 0; i < n; ++i ) {
+		p = dynamic.offset + i*dynamic.entsize;
+		if( !mk_libif__readWord( f, p, &tag ) || !mk_libif__readWord( f, p + ( f->is64 ? 8 : 4 ), &v ) ) {
+			return 0;
+		}
+
+		if( tag == MK_ELF_DT_NULL ) {
+			break;
+		}
+		if( tag == MK_ELF_DT_SONAME && !mk_libif__hashString( f, &dynstr, v, &hash ) ) {
+			return 0;
+		}
+	}
+
+	/* the symbol versions defined */
+	p = verdef.offset;
+	for( i = 0; verdef.size != 0 && i < 65536; ++i ) {
+		mk_uint64_t aux, next;
+
+		if( !mk_libif__read( f, p + 4, 2, &ver ) ||
+		    !mk_libif__read( f, p + 12, 4, &aux ) ||
+		    !mk_libif__read( f, p + 16, 4, &next ) ||
+		    !mk_libif__read( f, p + aux, 4, &name ) ) {
+			return 0;
+		}
+
+		hash = mk_com_hash64( hash, (const void *)&ver, sizeof( ver ) );
+		if( !mk_libif__hashString( f, &dynstr, name, &hash ) ) {
+			return 0;
+		}
+
+		if( !next ) {
+			break;
+		}
+		p += next;
+	}
+
+	/* the symbols defined and visible */
+	symbols = 0;
+	n       = dynsym.size/dynsym.entsize;
+	for( i = 1; i < n; ++i ) {
+		p = dynsym.offset + i*dynsym.entsize;
+		if( f->is64 ) {
+			if( !mk_libif__read( f, p, 4, &name ) ||
+			    !mk_libif__read( f, p + 4, 1, &info ) ||
+			    !mk_libif__read( f, p + 5, 1, &other ) ||
+			    !mk_libif__read( f, p + 6, 2, &shndx ) ||
+			    !mk_libif__read( f, p + 16, 8, &size ) ) {
+				return 0;
+			}
+		} else {
+			if( !mk_libif__read( f, p, 4, &name ) ||
+			    !mk_libif__read( f, p + 8, 4, &size ) ||
+			    !mk_libif__read( f, p + 12, 1, &info ) ||
+			    !mk_libif__read( f, p + 13, 1, &other ) ||
+			    !mk_libif__read( f, p + 14, 2, &shndx ) ) {
+				return 0;
+			}
+		}
+
+		bind = ( unsigned )( info >> 4 );
+		type = ( unsigned )( info & 0xF );
+		other &= 0x3;
+
+		if( !shndx ) {
+			continue; /* undefined; imported */
+		}
+		if( bind != MK_ELF_STB_GLOBAL && bind != MK_ELF_STB_WEAK && bind != MK_ELF_STB_UNIQUE ) {
+			continue;
+		}
+		if( other == MK_ELF_STV_HIDDEN || other == MK_ELF_STV_INTERNAL ) {
+			continue;
+		}
+
+		ver = 0;
+		if( versym.size != 0 && !mk_libif__read( f, versym.offset + i*2, 2, &ver ) ) {
+			return 0;
+		}
+
+		/* where a symbol is doesn't matter; how big a variable is does */
+		if( type != MK_ELF_STT_OBJECT && type != MK_ELF_STT_TLS ) {
+			size = 0;
+		}
+
+		symHash = MK_HASH64_INIT;
+		if( !mk_libif__hashString( f, &dynstr, name, &symHash ) ) {
+			return 0;
+		}
+		symHash = mk_com_hash64( symHash, (const void *)&info, sizeof( info ) );
+		symHash = mk_com_hash64( symHash, (const void *)&other, sizeof( other ) );
+		symHash = mk_com_hash64( symHash, (const void *)&ver, sizeof( ver ) );
+		symHash = mk_com_hash64( symHash, (const void *)&size, sizeof( size ) );
+
+		symbols += symHash;
+	}
+
+	*dst = mk_com_hash64( hash, (const void *)&symbols, sizeof( symbols ) );
+	return 1;
+}
+
+/* fingerprint the interface of a shared library; returns 0 if the file can't
+   be read or isn't in a format understood here */
+int mk_libif_hash( const char *path, mk_uint64_t *dst ) {
+	MkLibIfFile f;
+	unsigned char *data;
+	FILE *fp;
+	long n;
+	int ok;
+
+	MK_ASSERT( path != (const char *)0 );
+	MK_ASSERT( dst != (mk_uint64_t *)0 );
+
+	if( !( fp = fopen( path, "rb" ) ) ) {
+		return 0;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
+
+	data = (unsigned char *)0;
+	n    = 0;
+	if( fseek( fp, 0, SEEK_END ) == 0 && ( n = ftell( fp ) ) >= 64 && fseek( fp, 0, SEEK_SET ) == 0 ) {
+		data = (unsigned char *)mk_com_memory( (void *)0, ( size_t )n );
+		if( fread( (void *)data, ( size_t )n, 1, fp ) != 1 ) {
+			data = (unsigned char *)mk_com_memory( (void *)data, 0 );
+		}
+	}
+	fclose( fp );
+
+	if( !data ) {
+		return 0;
+	}
+
+	ok = 0;
+	if( memcmp( (const void *)data, (const void *)"\177ELF", 4 ) == 0 &&
+	    ( data[4] == MK_ELF_CLASS32 || data[4] == MK_ELF_CLASS64 ) &&
+	    ( data[5] == MK_ELF_DATA2LSB || data[5] == MK_ELF_DATA2MSB ) ) {
+		f.data      = data;
+		f.size      = ( size_t )n;
+		f.is64      = +( data[4] == MK_ELF_CLASS64 );
+		f.bigEndian = +( data[5] == MK_ELF_DATA2MSB );
+
+		ok = mk_libif__hashElf( &f, dst );
+	}
+
+	data = (unsigned char *)mk_com_memory( (void *)data, 0 );
+	return ok;
+}
@@ -0,0 +1,34 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+ *	========================================================================
+ *	SHARED LIBRARY INTERFACE
+ *	========================================================================
+ *	Fingerprints what a shared library exports: its soname, the symbol
+ *	versions it defines, and the name, kind, binding, visibility, version,
+ *	and (for data) size of each symbol in its dynamic symbol table. This is
+ *	all that programs linked against the library depend on, so when a
+ *	relinked library's fingerprint is the same as before, they needn't be
+ *	relinked too -- the same idea as LLVM's interface stubs.
+ *
+ *	Only ELF is understood; for anything else mk_libif_hash() fails and the
+ *	caller has to assume the interface changed.
+ */
+
+#include "mk-basic-common.h"
+
+int mk_libif_hash( const char *path, mk_uint64_t *dst );
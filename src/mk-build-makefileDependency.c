@@ -18,6 +18,7 @@
 #include "mk-basic-common.h"
 #include "mk-basic-fileSystem.h"
 #include "mk-basic-sourceBuffer.h"
+#include "mk-basic-stats.h"
 #include "mk-build-dependency.h"
 
 #include <stddef.h>
@@ -128,6 +129,7 @@ static int mk_mfdep__lex( MkBuffer buf, char *dst, size_t dstn, char *cur, char
 int mk_mfdep_load( const char *filename ) {
 	MkBuffer buf;
 	MkDep dep;
+	MkStatsTimer timer;
 	char lexan[PATH_MAX], ident[PATH_MAX], cur, look;
 	int tok;
 
@@ -136,11 +138,17 @@ int mk_mfdep_load( const char *filename ) {
 	cur      = 0;
 	look     = 0;
 
+	mk_stats_beginPhase( &timer );
+
 	buf = mk_buf_loadFile( filename );
 	if( !buf ) {
+		mk_stats_endPhase( kMkStats_DepParse, &timer );
 		return 0;
 	}
 
+	mk_stats_count( kMkStats_DepFiles, 1 );
+	mk_stats_count( kMkStats_DepBytes, mk_buf_getLength( buf ) );
+
 	mk_mfdep__read( buf, &cur, &look );
 
 	dep = (MkDep)0;
@@ -172,5 +180,7 @@ int mk_mfdep_load( const char *filename ) {
 	} while( tok != kMkMfDepTok_EOF );
 
 	mk_buf_delete( buf );
+
+	mk_stats_endPhase( kMkStats_DepParse, &timer );
 	return 1;
 }
@@ -16,11 +16,15 @@
 
 #include "mk-basic-assert.h"
 #include "mk-basic-common.h"
-#include "mk-basic-memory.h"
 #include "mk-basic-fileSystem.h"
+#include "mk-basic-logging.h"
+#include "mk-basic-memory.h"
 #include "mk-basic-stringList.h"
+#include "mk-build-trace.h"
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 
 /*
@@ -51,7 +55,6 @@ static unsigned int align_up( unsigned int x, unsigned int a ) {
 	return x + ( a - x%a )%a;
 }
 
-MK_UNUSED
 static void ap_zero( allocPage_t *ap ) {
 	ap->next  = (allocPage_t*)0;
 	ap->index = 0;
@@ -62,24 +65,25 @@ static allocPage_t *ap_new( allocPage_t *ap ) {
 	page = (allocPage_t*)mk_mem_alloc( sizeof(*page) );
 	MK_ASSERT( page != (allocPage_t*)0 );
 
-	memset( (void*)&ap->buf[0], 0, LINEAR_ALLOC_BUF_MAX );
+	memset( (void*)&page->buf[0], 0, LINEAR_ALLOC_BUF_MAX );
 
 	page->next  = ap;
 	page->index = 0;
 
 	return page;
 }
-MK_UNUSED
-static allocPage_t *ap_delete_r( allocPage_t *ap ) {
-	if( ap != (allocPage_t *)0 ) {
-		ap_delete_r( ap->next );
-		ap->next = (allocPage_t *)0;
+/* free every page up to (but not including) `base`, which is not owned */
+static allocPage_t *ap_delete( allocPage_t *ap, allocPage_t *base ) {
+	allocPage_t *next;
+
+	while( ap != (allocPage_t *)0 && ap != base ) {
+		next = ap->next;
+		mk_mem_dealloc( (void*)ap );
+		ap = next;
 	}
 
-	mk_mem_dealloc( (void*)ap );
-	return (allocPage_t *)0;
+	return base;
 }
-MK_UNUSED
 static void *ap_alloc( allocPage_t **apbase, size_t n ) {
 	allocPage_t *ap;
 	void *p;
@@ -136,7 +140,6 @@ static void na_init( nodeArray_t *na ) {
 	na->nodes = (MkBuildNode *)0;
 }
 
-MK_UNUSED
 static void na_fini( nodeArray_t *na ) {
 	na->nodes = (MkBuildNode *)mk_com_memory( (void *)na->nodes, 0 );
 	na->num   = 0;
@@ -165,7 +168,6 @@ static void na_resize( nodeArray_t *na, mk_uint32_t n ) {
 	}
 }
 
-MK_UNUSED
 static MkBuildNode na_pushBack( nodeArray_t *na, MkBuildNode node ) {
 	mk_uint32_t i;
 
@@ -189,6 +191,8 @@ struct MkBuildNode_s {
 
 	struct {
 		mk_uint32_t inputsRemaining;
+		mk_uint32_t visitMark;
+		int         running;
 	} async;
 
 	nodeArray_t inputs;
@@ -200,44 +204,40 @@ struct MkBuildNode_s {
 	mk_build_func_t     pfn_build;
 	mk_checkDeps_func_t pfn_checkDeps;
 	void *              userData;
-};
-
-static mk_uint32_t bldno_countInputs_r( MkBuildNode bldno, mk_uint32_t n ) {
-	mk_uint32_t i;
-
-	for( i = 0; i < bldno->inputs.num; ++i ) {
-		n += bldno_countInputs_r( bldno->inputs.nodes[ i ], n );
-	}
 
-	n += bldno->inputs.num;
+	MkTraceKind_t traceKind;
+	int           exitStatus;
 
-	return n;
-}
-static mk_uint32_t bldno_countInputs( MkBuildNode bldno ) {
-	return bldno_countInputs_r( bldno, 0 );
-}
+	/* estimated time to build this node alone, and along the longest path
+	   from it to a target (see bldctx_init_calcPriorities) */
+	mk_uint32_t cost;
+	mk_uint64_t priority;
+	mk_uint32_t index;
+};
 
-MK_UNUSED
 static void bldno_resetSync( MkBuildNode bldno ) {
 	bldno->async.inputsRemaining = bldno->inputs.num;
+	bldno->async.visitMark       = 0;
+	bldno->async.running         = 0;
+	bldno->flags &= ~( kMkBldNo_Processed_Bits | kMkBldNo_Unbuildable_Bit );
 }
-MK_UNUSED
 static int bldno_isReady( MkBuildNode bldno ) {
 	return +( bldno->async.inputsRemaining == 0 );
 }
 
 static void bldctx_queue( MkBuildContext, MkBuildNode );
 
+/* NOTE: The following functions must be called with the ready queue locked. */
 static void bldno_syncCompletion( MkBuildNode bldno ) {
 	MkBuildNode node;
 	mk_uint32_t i;
 
-	bldno->flags |= kMkBldNo_Built_Bit;
-
 	for( i = 0; i < bldno->outputs.num; ++i ) {
 		node = bldno->outputs.nodes[ i ];
 
-		if( mk_async_atomicDec_post( &node->async.inputsRemaining ) == 0 ) {
+		MK_ASSERT( node->async.inputsRemaining > 0 );
+		/* a running node requeues itself when its build function defers */
+		if( --node->async.inputsRemaining == 0 && !node->async.running ) {
 			bldctx_queue( node->ctx, node );
 		}
 	}
@@ -246,18 +246,59 @@ static void bldno_syncFailure_r( MkBuildNode bldno ) {
 	MkBuildNode node;
 	mk_uint32_t i;
 
-	if( ( bldno->flags & kMkBldNo_Unbuildable_Bit ) != 0 ) {
-		bldno->flags |= kMkBldNo_Failed_Bit;
-	}
-
 	for( i = 0; i < bldno->outputs.num; ++i ) {
 		node = bldno->outputs.nodes[ i ];
 
+		if( ( node->flags & kMkBldNo_Unbuildable_Bit ) != 0 ) {
+			continue;
+		}
+
 		node->flags |= kMkBldNo_Unbuildable_Bit;
 		bldno_syncFailure_r( node );
 	}
 }
 
+const char *mk_bldno_getFilename( MkBuildNode node ) {
+	MK_ASSERT( node != (MkBuildNode)0 );
+	return node->filename;
+}
+mk_uint32_t mk_bldno_getFlags( MkBuildNode node ) {
+	MK_ASSERT( node != (MkBuildNode)0 );
+	return node->flags;
+}
+void *mk_bldno_getUserData( MkBuildNode node ) {
+	MK_ASSERT( node != (MkBuildNode)0 );
+	return node->userData;
+}
+
+/* what kind of job the node is, as far as --trace is concerned */
+void mk_bldno_setTraceKind( MkBuildNode node, MkTraceKind_t kind ) {
+	MK_ASSERT( node != (MkBuildNode)0 );
+	node->traceKind = kind;
+}
+/* set how long the node is expected to take to build, in any consistent unit
+   (the engine uses milliseconds); nodes on the longest paths are run first */
+void mk_bldno_setCost( MkBuildNode node, mk_uint32_t cost ) {
+	MK_ASSERT( node != (MkBuildNode)0 );
+	node->cost = cost;
+}
+/* let --trace know the exit status of the program a build function ran */
+void mk_bldno_setExitStatus( MkBuildNode node, int status ) {
+	MK_ASSERT( node != (MkBuildNode)0 );
+	node->exitStatus = status;
+}
+
+/* make `input` a prerequisite of `node` */
+void mk_bldno_addInput( MkBuildNode node, MkBuildNode input ) {
+	MK_ASSERT( node != (MkBuildNode)0 );
+	MK_ASSERT( input != (MkBuildNode)0 );
+	MK_ASSERT( node != input );
+	MK_ASSERT( node->ctx == input->ctx );
+
+	na_pushBack( &node->inputs, input );
+	na_pushBack( &input->outputs, node );
+}
+
 
 /*
 
@@ -266,19 +307,27 @@ static void bldno_syncFailure_r( MkBuildNode bldno ) {
 */
 
 struct MkBuildContext_s {
+	nodeArray_t nodes;
 	nodeArray_t targets;
 
 	struct {
+		/* binary max-heap of the nodes ready to build, by priority */
 		nodeArray_t array;
 
 		mk_uint32_t count;
-		mk_uint32_t index;
+		mk_uint32_t remaining;
+		mk_uint32_t visitMark;
 
+		mk_mutex_t     lock;
 		mk_semaphore_t waiter;
+		unsigned int   numWorkers;
 		volatile int   cancel;
 	} readyQueue;
 
-	/* FIXME: Add `trace` fields here */
+	struct {
+		MkTraceBuf * bufs;       /* one per worker; null unless tracing */
+		unsigned int numStarted; /* workers that have taken their buffer */
+	} trace;
 
 	struct {
 		allocPage_t *head;
@@ -287,51 +336,120 @@ struct MkBuildContext_s {
 	} memory;
 };
 
-static void bldctx_init_queue( MkBuildContext ctx, MkBuildNode node ) {
-	mk_uint32_t n;
+MkBuildContext mk_bldctx_new( void ) {
+	MkBuildContext ctx;
+
+	ctx = (MkBuildContext)mk_mem_alloc( sizeof( *ctx ) );
 
-	n = ctx->readyQueue.count;
-	MK_ASSERT( n < ctx->readyQueue.array.num );
+	na_init( &ctx->nodes );
+	na_init( &ctx->targets );
+	na_init( &ctx->readyQueue.array );
 
-	ctx->readyQueue.array.nodes[ n ]  = node;
-	ctx->readyQueue.count            += 1;
+	ap_zero( &ctx->memory.base );
+	ctx->memory.head = &ctx->memory.base;
 
-	node->ctx = ctx;
+	return ctx;
 }
-static void bldctx_init_queueIfReady_r( MkBuildContext ctx, MkBuildNode node ) {
+MkBuildContext mk_bldctx_delete( MkBuildContext ctx ) {
 	mk_uint32_t i;
 
-	if( node->inputs.num == 0 ) {
-		bldctx_init_queue( ctx, node );
-		return;
+	if( !ctx ) {
+		return (MkBuildContext)0;
 	}
 
-	for( i = 0; i < node->inputs.num; ++i ) {
-		bldctx_init_queueIfReady_r( ctx, node->inputs.nodes[ i ] );
+	for( i = 0; i < ctx->nodes.num; ++i ) {
+		na_fini( &ctx->nodes.nodes[ i ]->inputs );
+		na_fini( &ctx->nodes.nodes[ i ]->outputs );
 	}
+
+	na_fini( &ctx->readyQueue.array );
+	na_fini( &ctx->targets );
+	na_fini( &ctx->nodes );
+
+	ctx->memory.head = ap_delete( ctx->memory.head, &ctx->memory.base );
+
+	mk_mem_dealloc( (void *)ctx );
+	return (MkBuildContext)0;
 }
-MK_UNUSED
-static void bldctx_init_allocReadyQueue( MkBuildContext ctx ) {
-	mk_uint32_t i, n;
 
-	n = 0;
-	for( i = 0; i < ctx->targets.num; ++i ) {
-		n += bldno_countInputs( ctx->targets.nodes[ i ] );
+/* add a node to the graph; the filename is copied */
+MkBuildNode mk_bldctx_addNode( MkBuildContext ctx, const char *filename, mk_uint32_t flags, mk_build_func_t pfn_build, void *userData ) {
+	MkBuildNode node;
+	size_t n;
+
+	MK_ASSERT( ctx != (MkBuildContext)0 );
+	MK_ASSERT( filename != (const char *)0 );
+
+	node = (MkBuildNode)ap_alloc( &ctx->memory.head, sizeof( *node ) );
+	memset( (void *)node, 0, sizeof( *node ) );
+
+	n = strlen( filename ) + 1;
+	node->filename = (char *)ap_alloc( &ctx->memory.head, n );
+	memcpy( (void *)node->filename, (const void *)filename, n );
+
+	node->ctx       = ctx;
+	node->flags     = flags & ~( kMkBldNo_Processed_Bits | kMkBldNo_Unbuildable_Bit );
+	node->pfn_build = pfn_build;
+	node->userData  = userData;
+	node->traceKind = kMkTrace_Compile;
+	node->cost      = 1;
+	node->index     = ctx->nodes.num;
+
+	na_init( &node->inputs );
+	na_init( &node->outputs );
+
+	na_pushBack( &ctx->nodes, node );
+	if( flags & kMkBldNo_Target_Bit ) {
+		na_pushBack( &ctx->targets, node );
 	}
 
-	na_init( &ctx->readyQueue.array );
-	na_resize( &ctx->readyQueue.array, n );
+	return node;
+}
+mk_uint32_t mk_bldctx_numNodes( MkBuildContext ctx ) {
+	MK_ASSERT( ctx != (MkBuildContext)0 );
+	return ctx->nodes.num;
+}
+MkBuildNode mk_bldctx_nodeAt( MkBuildContext ctx, mk_uint32_t index ) {
+	MK_ASSERT( ctx != (MkBuildContext)0 );
+	MK_ASSERT( index < ctx->nodes.num );
+	return ctx->nodes.nodes[ index ];
+}
 
-	ctx->readyQueue.count = 0;
-	ctx->readyQueue.index = 0;
+static void bldctx_init_allocReadyQueue( MkBuildContext ctx ) {
+	/* every node is queued at least once per run; grows on deferrals */
+	na_fini( &ctx->readyQueue.array );
+	na_resize( &ctx->readyQueue.array, ctx->nodes.num );
+
+	ctx->readyQueue.count     = 0;
+	ctx->readyQueue.remaining = ctx->nodes.num;
+	ctx->readyQueue.visitMark = 0;
+	ctx->readyQueue.cancel    = 0;
 }
-MK_UNUSED
 static void bldctx_init_fillReadyQueue( MkBuildContext ctx ) {
+	MkBuildNode node;
 	mk_uint32_t i;
 
-	for( i = 0; i < ctx->targets.num; ++i ) {
-		bldctx_init_queueIfReady_r( ctx, ctx->targets.nodes[ i ] );
+	for( i = 0; i < ctx->nodes.num; ++i ) {
+		node = ctx->nodes.nodes[ i ];
+
+		bldno_resetSync( node );
+		if( bldno_isReady( node ) ) {
+			bldctx_queue( ctx, node );
+		}
+	}
+}
+static mk_uint32_t bldctx_nextVisitMark( MkBuildContext ctx ) {
+	mk_uint32_t i;
+
+	/* on wrap-around stale marks could match, so clear them all */
+	if( ++ctx->readyQueue.visitMark == 0 ) {
+		for( i = 0; i < ctx->nodes.num; ++i ) {
+			ctx->nodes.nodes[ i ]->async.visitMark = 0;
+		}
+		ctx->readyQueue.visitMark = 1;
 	}
+
+	return ctx->readyQueue.visitMark;
 }
 static int bldctx_didAllTargetsFail( MkBuildContext ctx ) {
 	mk_uint32_t i;
@@ -347,45 +465,188 @@ static int bldctx_didAllTargetsFail( MkBuildContext ctx ) {
 
 	return 1;
 }
-enum { NUM_WORKER_THREAD_SEMAPHORE_NOTIFICATIONS = 128UL };
 static void bldctx_cancel( MkBuildContext ctx ) {
-	mk_uint32_t n;
+	unsigned int n;
 
 	ctx->readyQueue.cancel = 1;
 
-	// let every worker know about the cancellation
-	for( n = NUM_WORKER_THREAD_SEMAPHORE_NOTIFICATIONS; n > 0; --n ) {
+	/* let every worker know about the cancellation */
+	for( n = ctx->readyQueue.numWorkers; n > 0; --n ) {
 		(void)mk_async_semRaise( &ctx->readyQueue.waiter );
 	}
 }
 
+/*
+================
+bldctx_init_calcPriorities
+
+find, for each node, the total cost of the longest path from it to a target.
+Running the nodes on the longest paths first keeps a long job that would be
+started last from leaving the rest of the build waiting on one thread.
+
+Late inputs (see mk_bldno_addLateInput) aren't known yet, so the nodes they
+turn out to be aren't prioritized for the nodes that end up waiting on them.
+================
+*/
+static mk_uint64_t bldno_calcPriority_r( MkBuildNode node, mk_uint32_t mark ) {
+	mk_uint64_t p, longest;
+	mk_uint32_t i;
+
+	if( node->async.visitMark == mark ) {
+		return node->priority;
+	}
+	node->async.visitMark = mark;
+
+	longest = 0;
+	for( i = 0; i < node->outputs.num; ++i ) {
+		p = bldno_calcPriority_r( node->outputs.nodes[ i ], mark );
+		if( longest < p ) {
+			longest = p;
+		}
+	}
+
+	node->priority = ( mk_uint64_t )node->cost + longest;
+	return node->priority;
+}
+static void bldctx_init_calcPriorities( MkBuildContext ctx ) {
+	mk_uint32_t i, mark;
+
+	for( i = 0; i < ctx->nodes.num; ++i ) {
+		ctx->nodes.nodes[ i ]->async.visitMark = 0;
+	}
+
+	mark = bldctx_nextVisitMark( ctx );
+	for( i = 0; i < ctx->nodes.num; ++i ) {
+		(void)bldno_calcPriority_r( ctx->nodes.nodes[ i ], mark );
+	}
+}
+
+/* whether `a` should be built before `b`; ties go to the node added first */
+static int bldno_runsBefore( MkBuildNode a, MkBuildNode b ) {
+	if( a->priority != b->priority ) {
+		return +( a->priority > b->priority );
+	}
+
+	return +( a->index < b->index );
+}
+
+/* NOTE: must be called with the ready queue locked */
 static void bldctx_queue( MkBuildContext ctx, MkBuildNode node ) {
+	MkBuildNode *heap;
+	mk_uint32_t i, parent;
+
 	MK_ASSERT( ctx != (MkBuildContext)0 );
 	MK_ASSERT( node != (MkBuildNode)0 );
 
-	for(;;) {
-		if( ctx->readyQueue.count >= ctx->readyQueue.array.num ) {
+	/* deferred nodes are queued more than once */
+	if( ctx->readyQueue.count == ctx->readyQueue.array.num ) {
+		na_resize( &ctx->readyQueue.array, ctx->readyQueue.count + 1 );
+	}
+
+	heap = ctx->readyQueue.array.nodes;
+	for( i = ctx->readyQueue.count++; i > 0; i = parent ) {
+		parent = ( i - 1 )/2;
+		if( !bldno_runsBefore( node, heap[ parent ] ) ) {
 			break;
 		}
 
-		if( mk_async_atomicCmpSetPtr_post( &ctx->readyQueue.array.nodes[ ctx->readyQueue.count ], (void*)node, NULL ) == (void*)node ) {
-			(void)mk_async_atomicInc_pre( &ctx->readyQueue.count );
-			mk_async_semRaise( &ctx->readyQueue.waiter );
-			return;
+		heap[ i ] = heap[ parent ];
+	}
+	heap[ i ] = node;
+
+	(void)mk_async_semRaise( &ctx->readyQueue.waiter );
+}
+/* take the most important node off the ready queue (which must be locked) */
+static MkBuildNode bldctx_dequeue( MkBuildContext ctx ) {
+	MkBuildNode *heap;
+	MkBuildNode node, last;
+	mk_uint32_t i, child, n;
+
+	MK_ASSERT_MSG( ctx->readyQueue.count > 0, "Job queue is out of sync with its semaphore" );
+
+	heap = ctx->readyQueue.array.nodes;
+	node = heap[ 0 ];
+	n    = --ctx->readyQueue.count;
+	last = heap[ n ];
+
+	for( i = 0; ( child = i*2 + 1 ) < n; i = child ) {
+		if( child + 1 < n && bldno_runsBefore( heap[ child + 1 ], heap[ child ] ) ) {
+			++child;
 		}
+		if( !bldno_runsBefore( heap[ child ], last ) ) {
+			break;
+		}
+
+		heap[ i ] = heap[ child ];
 	}
+	heap[ i ] = last;
 
-	bldctx_cancel( ctx );
-	MK_ASSERT_MSG( 0, "Failed to push job to queue" );
+	return node;
+}
+
+/* whether `node` is reachable from `from` by following inputs */
+static int bldno_dependsOn_r( MkBuildNode from, MkBuildNode node, mk_uint32_t mark ) {
+	mk_uint32_t i;
+
+	if( from == node ) {
+		return 1;
+	}
+	if( from->async.visitMark == mark ) {
+		return 0;
+	}
+	from->async.visitMark = mark;
+
+	for( i = 0; i < from->inputs.num; ++i ) {
+		if( bldno_dependsOn_r( from->inputs.nodes[ i ], node, mark ) ) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ *	make `input` a prerequisite of `node` while `node` is building; only
+ *	valid from within node's build function
+ *
+ *	returns 1 if node must wait for input (return kMkBuild_Deferred), 0 if
+ *	input is already built or would form a cycle, or -1 if input failed
+ */
+int mk_bldno_addLateInput( MkBuildNode node, MkBuildNode input ) {
+	MkBuildContext ctx;
+	int r;
+
+	MK_ASSERT( node != (MkBuildNode)0 );
+	MK_ASSERT( input != (MkBuildNode)0 );
+	MK_ASSERT( node->ctx == input->ctx );
+	MK_ASSERT( node->async.running != 0 );
+
+	ctx = node->ctx;
+
+	mk_async_mtxLock( &ctx->readyQueue.lock );
+	if( input == node || ( input->flags & kMkBldNo_Built_Bit ) != 0 ) {
+		r = 0;
+	} else if( ( input->flags & kMkBldNo_Canceled_Bits ) != 0 ) {
+		r = -1;
+	} else if( bldno_dependsOn_r( input, node, bldctx_nextVisitMark( ctx ) ) ) {
+		r = 0;
+	} else {
+		mk_bldno_addInput( node, input );
+		++node->async.inputsRemaining;
+		r = 1;
+	}
+	mk_async_mtxUnlock( &ctx->readyQueue.lock );
+
+	return r;
 }
 
-MK_UNUSED
 static int build_thread_f( mk_thread_t *thread, void *userdata ) {
 	MkBuildContext ctx;
 	MkBuildNode node;
-	mk_uint32_t index;
 	MkStrList inputFiles, outputFiles;
-	int i, n;
+	MkTraceBuf trace;
+	mk_uint64_t start;
+	mk_uint32_t i, n;
 	int r;
 	int canceled;
 
@@ -395,27 +656,33 @@ static int build_thread_f( mk_thread_t *thread, void *userdata ) {
 	inputFiles  = mk_sl_new();
 	outputFiles = mk_sl_new();
 
+	trace = (MkTraceBuf)0;
+	if( ctx->trace.bufs != (MkTraceBuf *)0 ) {
+		mk_async_mtxLock( &ctx->readyQueue.lock );
+		MK_ASSERT( ctx->trace.numStarted < ctx->readyQueue.numWorkers );
+		trace = ctx->trace.bufs[ ctx->trace.numStarted++ ];
+		mk_async_mtxUnlock( &ctx->readyQueue.lock );
+	}
+
 	canceled = 0;
 	for(;;) {
 		if( !mk_async_semWait( &ctx->readyQueue.waiter ) ) {
 			break;
 		}
 
+		mk_async_mtxLock( &ctx->readyQueue.lock );
 		if( ctx->readyQueue.cancel != 0 ) {
-			canceled = 1;
+			mk_async_mtxUnlock( &ctx->readyQueue.lock );
 			break;
 		}
 
-		/* Note, the index should not be out of sync with the count due to the
-		`  semaphore being signalled after each enqueue. */
-		index = mk_async_atomicInc_pre( &ctx->readyQueue.index );
-		MK_ASSERT_MSG( index < ctx->readyQueue.count, "Index is out of sync with job queue" );
+		/* Note, the queue can't be empty here due to the semaphore being
+		`  signalled after each enqueue. */
+		node = bldctx_dequeue( ctx );
+		node->async.running = 1;
 
-		if( !( node = (MkBuildNode)mk_async_atomicSetPtr_pre( &ctx->readyQueue.array.nodes[ index ], NULL ) ) ) {
-			continue;
-		}
-
-		/* generate the input and output file arrays */
+		/* generate the input and output file arrays (other nodes may add
+		`  late inputs, and thus outputs, concurrently) */
 		mk_sl_clear( inputFiles );
 		n = node->inputs.num;
 		for( i = 0; i < n; ++i ) {
@@ -427,34 +694,72 @@ static int build_thread_f( mk_thread_t *thread, void *userdata ) {
 		for( i = 0; i < n; ++i ) {
 			mk_sl_pushBack( outputFiles, node->outputs.nodes[i]->filename );
 		}
+		mk_async_mtxUnlock( &ctx->readyQueue.lock );
+
+		r = 0;
+		if( ( node->flags & kMkBldNo_Unbuildable_Bit ) == 0 ) {
+			/* invoke the build step */
+			r = 1;
+			if( node->pfn_build != NULL ) {
+				start = trace != (MkTraceBuf)0 ? mk_com_getTimeNs() : 0;
+				node->exitStatus = kMkTrace_NoStatus;
+
+				r =
+					node->pfn_build(
+						node, node->userData,
+						inputFiles,
+						outputFiles
+					);
+
+				/* an archive or link step that ran nothing (it was up to date, or
+				`  put off until its late inputs are built) isn't worth an event */
+				if( trace != (MkTraceBuf)0 && !( r != 0 && node->exitStatus == kMkTrace_NoStatus &&
+				    ( node->traceKind == kMkTrace_Archive || node->traceKind == kMkTrace_Link ) ) ) {
+					mk_trace_add( trace, node->traceKind, node->filename, start, mk_com_getTimeNs(), node->exitStatus,
+					    r == kMkBuild_Deferred ? "deferred" : r != 0 ? "built" : "failed" );
+				}
+			}
 
-		/* invoke the build step */
-		r = 1;
-		if( node->pfn_build != NULL ) {
-			r =
-				node->pfn_build(
-					node, node->userData,
-					inputFiles,
-					outputFiles
-				);
+			if( r != 0 && r != kMkBuild_Deferred && ( node->flags & kMkBldNo_Phony_Bit ) == 0 ) {
+				mk_fs_invalidate( node->filename );
+				if( !mk_fs_isFile( node->filename ) ) {
+					mk_log_error( node->filename, 0, NULL, "File not generated after otherwise successful build step invocation." );
+					r = 0;
+				}
+			}
 		}
 
-		if( r != 0 && ( node->flags & kMkBldNo_Phony_Bit ) == 0 ) {
-			if( !mk_fs_isFile( node->filename ) ) {
-				mk_log_error( node->filename, 0, NULL, "File not generated after otherwise successful build step invocation." );
-				r = 0;
+		mk_async_mtxLock( &ctx->readyQueue.lock );
+		node->async.running = 0;
+		if( r == kMkBuild_Deferred ) {
+			/* the late inputs may have finished while the build function ran */
+			if( bldno_isReady( node ) ) {
+				bldctx_queue( ctx, node );
 			}
+			mk_async_mtxUnlock( &ctx->readyQueue.lock );
+			continue;
 		}
 
 		if( r != 0 ) {
-			bldno_syncCompletion( node );
+			node->flags |= kMkBldNo_Built_Bit;
 		} else {
-			bldno_syncFailure_r( node );
-			if( bldctx_didAllTargetsFail( ctx ) ) {
-				bldctx_cancel( ctx );
-				canceled = 1;
-				break;
+			if( ( node->flags & kMkBldNo_Unbuildable_Bit ) == 0 ) {
+				node->flags |= kMkBldNo_Failed_Bit;
 			}
+			bldno_syncFailure_r( node );
+		}
+		bldno_syncCompletion( node );
+
+		if( --ctx->readyQueue.remaining == 0 ) {
+			bldctx_cancel( ctx );
+		} else if( r == 0 && bldctx_didAllTargetsFail( ctx ) ) {
+			bldctx_cancel( ctx );
+			canceled = 1;
+		}
+		mk_async_mtxUnlock( &ctx->readyQueue.lock );
+
+		if( canceled ) {
+			break;
 		}
 	}
 
@@ -463,3 +768,78 @@ static int build_thread_f( mk_thread_t *thread, void *userdata ) {
 
 	return canceled == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+
+/* process every node in the graph; returns 1 if all of them were built */
+int mk_bldctx_run( MkBuildContext ctx, unsigned int numThreads ) {
+	mk_thread_t *threads;
+	mk_uint32_t i;
+	int r;
+
+	MK_ASSERT( ctx != (MkBuildContext)0 );
+
+	if( !ctx->nodes.num ) {
+		return 1;
+	}
+
+	if( numThreads < 1 ) {
+		numThreads = 1;
+	}
+	if( numThreads > ctx->nodes.num ) {
+		numThreads = ctx->nodes.num;
+	}
+
+	mk_async_mtxInit( &ctx->readyQueue.lock );
+	mk_async_semInit( &ctx->readyQueue.waiter, 0 );
+	ctx->readyQueue.numWorkers = numThreads;
+
+	/* worker N records into trace buffer N + 1; 0 is the main thread's */
+	ctx->trace.bufs       = (MkTraceBuf *)0;
+	ctx->trace.numStarted = 0;
+	if( mk_trace_isEnabled() ) {
+		ctx->trace.bufs = (MkTraceBuf *)mk_mem_alloc( sizeof( *ctx->trace.bufs )*numThreads );
+		for( i = 0; i < numThreads; ++i ) {
+			ctx->trace.bufs[ i ] = mk_trace_getBuffer( i + 1 );
+		}
+	}
+
+	bldctx_init_allocReadyQueue( ctx );
+	bldctx_init_calcPriorities( ctx );
+	mk_async_mtxLock( &ctx->readyQueue.lock );
+	bldctx_init_fillReadyQueue( ctx );
+	mk_async_mtxUnlock( &ctx->readyQueue.lock );
+
+	if( numThreads == 1 ) {
+		(void)build_thread_f( (mk_thread_t *)0, (void *)ctx );
+	} else {
+		threads = (mk_thread_t *)mk_mem_alloc( sizeof( *threads )*numThreads );
+
+		for( i = 0; i < numThreads; ++i ) {
+			if( !mk_async_threadInit( &threads[ i ], "mk-worker", &build_thread_f, (void *)ctx ) ) {
+				mk_log_fatalError( "Failed to create build worker thread" );
+			}
+		}
+		for( i = 0; i < numThreads; ++i ) {
+			mk_async_threadJoin( &threads[ i ] );
+		}
+
+		mk_mem_dealloc( (void *)threads );
+	}
+
+	mk_async_semFini( &ctx->readyQueue.waiter );
+	mk_async_mtxFini( &ctx->readyQueue.lock );
+
+	if( ctx->trace.bufs != (MkTraceBuf *)0 ) {
+		mk_mem_dealloc( (void *)ctx->trace.bufs );
+		ctx->trace.bufs = (MkTraceBuf *)0;
+	}
+
+	r = 1;
+	for( i = 0; i < ctx->nodes.num; ++i ) {
+		if( ( ctx->nodes.nodes[ i ]->flags & kMkBldNo_Built_Bit ) == 0 ) {
+			r = 0;
+			break;
+		}
+	}
+
+	return r;
+}
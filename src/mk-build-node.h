@@ -73,6 +73,7 @@
  */
 
 #include "mk-basic-async.h"
+#include "mk-build-trace.h"
 
 struct MkStrList_s;
 
@@ -93,3 +94,46 @@ enum {
 	kMkBldNo_Processed_Bits  = kMkBldNo_Built_Bit  | kMkBldNo_Failed_Bit,
 	kMkBldNo_Canceled_Bits   = kMkBldNo_Failed_Bit | kMkBldNo_Unbuildable_Bit
 };
+
+enum {
+	/* build function result: the node gained inputs and must be invoked again */
+	kMkBuild_Deferred = -1
+};
+
+/*
+ *	Build API
+ *	---------
+ *	Create a context, add nodes to it with mk_bldctx_addNode(), connect them
+ *	with mk_bldno_addInput(), then process the whole graph with
+ *	mk_bldctx_run(). Build functions return nonzero on success and are invoked
+ *	from worker threads, so they must not touch unsynchronized global state.
+ *
+ *	Inputs that are only known once a node is about to build (e.g., the
+ *	libraries a link step discovers from its objects' dependency files) can
+ *	be added from within the build function with mk_bldno_addLateInput(). If
+ *	any of those inputs still needs building, the build function returns
+ *	kMkBuild_Deferred and is invoked again once they have finished.
+ *
+ *	Ready nodes are run longest path first: each node's estimated cost (set
+ *	with mk_bldno_setCost()) is added up along the paths from it to the
+ *	targets, and the node with the costliest path is the next to build.
+ */
+
+MkBuildContext mk_bldctx_new( void );
+MkBuildContext mk_bldctx_delete( MkBuildContext ctx );
+
+MkBuildNode mk_bldctx_addNode( MkBuildContext ctx, const char *filename, mk_uint32_t flags, mk_build_func_t pfn_build, void *userData );
+void        mk_bldno_addInput( MkBuildNode node, MkBuildNode input );
+int         mk_bldno_addLateInput( MkBuildNode node, MkBuildNode input );
+
+mk_uint32_t mk_bldctx_numNodes( MkBuildContext ctx );
+MkBuildNode mk_bldctx_nodeAt( MkBuildContext ctx, mk_uint32_t index );
+int         mk_bldctx_run( MkBuildContext ctx, unsigned int numThreads );
+
+const char *mk_bldno_getFilename( MkBuildNode node );
+mk_uint32_t mk_bldno_getFlags( MkBuildNode node );
+void *      mk_bldno_getUserData( MkBuildNode node );
+
+void mk_bldno_setCost( MkBuildNode node, mk_uint32_t cost );
+void mk_bldno_setTraceKind( MkBuildNode node, MkTraceKind_t kind );
+void mk_bldno_setExitStatus( MkBuildNode node, int status );
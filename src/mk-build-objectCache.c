@@ -0,0 +1,798 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "mk-build-objectCache.h"
+
+#include "mk-basic-assert.h"
+#include "mk-basic-async.h"
+#include "mk-basic-common.h"
+#include "mk-basic-debug.h"
+#include "mk-basic-fileSystem.h"
+#include "mk-basic-options.h"
+#include "mk-basic-stats.h"
+#include "mk-basic-types.h"
+#include "mk-build-dependency.h"
+#include "mk-defs-config.h"
+#include "mk-defs-platform.h"
+#include "mk-system-output.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if MK_WINDOWS_ENABLED
+#	include <process.h>
+#	include <sys/utime.h>
+#	define MK_OC__PATHLIST_SEP ';'
+#else
+#	include <unistd.h>
+#	include <utime.h>
+#	define MK_OC__PATHLIST_SEP ':'
+#endif
+
+/*
+ *	Within the cache directory (<global version dir>/cache/):
+ *
+ *		xx/<key>.m           manifest of a compile
+ *		xx/<key>.o, .d, .txt result: object, dependency file, compiler output
+ *		stats                counters and the total size (as text)
+ *
+ *	where "xx<key>" is a key in hexadecimal. A compile's key covers the
+ *	compiler, the command line, the directory, and the source's contents. Its
+ *	manifest lists the results it has produced (newest first), each with the
+ *	dependencies that compile read and the hashes of their contents:
+ *
+ *		u32 magic, version, numResults
+ *		numResults x { u64 result; u32 numDeps; numDeps x { u32 length; char path[length]; u64 hash; } }
+ *
+ *	A result's key is the compile's key combined with those hashes. Files are
+ *	written under a temporary name and renamed into place, so other runs never
+ *	see them half-written. Hits refresh the modification times of the files
+ *	used, which is what eviction goes by.
+ */
+#define MK_OC__MAGIC       0x4D434F4DUL /* "MOCM" */
+#define MK_OC__VERSION     1
+#define MK_OC__MAX_RESULTS 8
+#define MK_OC__MAX_TOOLS   8
+
+static struct {
+	mk_mutex_t lock;
+
+	/* identities of the compilers found so far */
+	char        tools[ MK_OC__MAX_TOOLS ][ 64 ];
+	mk_uint64_t toolIds[ MK_OC__MAX_TOOLS ];
+	size_t      numTools;
+
+	/* this run's counters, until they're added to the stats file */
+	mk_uint64_t hits, misses, stores, bytesStored;
+} mk__g_oc = { MK_MUTEX_INITIALIZER };
+
+typedef struct {
+	mk_uint64_t hits, misses, stores, size;
+} MkOcStats;
+
+typedef struct {
+	char * path;
+	time_t mtime;
+	mk_uint64_t size;
+} MkOcFile;
+
+static void mk_oc__getDir( char *dst, size_t dstn ) {
+	snprintf( dst, dstn, "%scache/", mk_opt_getGlobalVersionDir() );
+}
+
+/* find the path of a file for a key; `ext` includes the '.' */
+static void mk_oc__getPath( char *dst, size_t dstn, mk_uint64_t key, const char *ext ) {
+	char hex[ 17 ];
+
+	snprintf( hex, sizeof( hex ), "%016llx", (unsigned long long)key );
+	snprintf( dst, dstn, "%scache/%.2s/%s%s", mk_opt_getGlobalVersionDir(), hex, &hex[2], ext );
+}
+
+/* find the name to write a file under before it's renamed into place */
+static int mk_oc__getTempPath( char *dst, size_t dstn, const char *path ) {
+	int n;
+
+	n = snprintf( dst, dstn, "%s.%ld.tmp", path, (long)getpid() );
+	return +( n > 0 && ( size_t )n < dstn );
+}
+
+/* read a whole file, adding a terminating '\0'; returns null on failure */
+static unsigned char *mk_oc__readFile( const char *path, size_t *dstSize ) {
+	unsigned char *data;
+	FILE *fp;
+	long n;
+
+	if( !( fp = fopen( path, "rb" ) ) ) {
+		return (unsigned char *)0;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
+
+	data = (unsigned char *)0;
+	if( fseek( fp, 0, SEEK_END ) == 0 && ( n = ftell( fp ) ) >= 0 && fseek( fp, 0, SEEK_SET ) == 0 ) {
+		data = (unsigned char *)mk_com_memory( (void *)0, ( size_t )n + 1 );
+		if( n > 0 && fread( (void *)data, ( size_t )n, 1, fp ) != 1 ) {
+			data = (unsigned char *)mk_com_memory( (void *)data, 0 );
+		} else {
+			data[ n ]  = '\0';
+			*dstSize = ( size_t )n;
+		}
+	}
+
+	fclose( fp );
+	return data;
+}
+
+/* replace a file with a copy of another, without ever leaving it partial */
+static int mk_oc__install( const char *src, const char *dst ) {
+	char tmp[PATH_MAX];
+
+	if( !mk_oc__getTempPath( tmp, sizeof( tmp ), dst ) || !mk_fs_copyFile( src, tmp ) ) {
+		return 0;
+	}
+
+#if MK_WINDOWS_ENABLED
+	remove( dst );
+#endif
+	if( rename( tmp, dst ) != 0 ) {
+		remove( tmp );
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ *	compiler identity
+ */
+
+static mk_uint64_t mk_oc__hashTool( const char *path, const MkStat_t *s ) {
+	mk_uint64_t hash, x;
+
+	hash = mk_com_hashStr64( MK_HASH64_INIT, path );
+
+	x    = ( mk_uint64_t )s->st_size;
+	hash = mk_com_hash64( hash, (const void *)&x, sizeof( x ) );
+	x    = ( mk_uint64_t )s->st_mtime;
+	hash = mk_com_hash64( hash, (const void *)&x, sizeof( x ) );
+
+	return hash;
+}
+
+/* identify a compiler by where it's found along with its size and time, so an
+   upgraded compiler doesn't reuse its predecessor's objects; 0 if not found */
+static mk_uint64_t mk_oc__getCompilerId( const char *tool ) {
+	const char *paths, *p, *e;
+	mk_uint64_t id;
+	MkStat_t s;
+	size_t i, n;
+	char buf[PATH_MAX];
+
+	mk_async_mtxLock( &mk__g_oc.lock );
+	for( i = 0; i < mk__g_oc.numTools; ++i ) {
+		if( !strcmp( mk__g_oc.tools[ i ], tool ) ) {
+			id = mk__g_oc.toolIds[ i ];
+			mk_async_mtxUnlock( &mk__g_oc.lock );
+			return id;
+		}
+	}
+	mk_async_mtxUnlock( &mk__g_oc.lock );
+
+	id = 0;
+	if( strchr( tool, '/' ) != (const char *)0 ) {
+		mk_stats_count( kMkStats_StatCalls, 1 );
+		if( stat( tool, &s ) == 0 ) {
+			id = mk_oc__hashTool( tool, &s );
+		}
+	} else if( ( paths = getenv( "PATH" ) ) != (const char *)0 ) {
+		for( p = paths; *p != '\0'; p = *e != '\0' ? e + 1 : e ) {
+			if( !( e = strchr( p, MK_OC__PATHLIST_SEP ) ) ) {
+				e = strchr( p, '\0' );
+			}
+
+			n = ( size_t )( e - p );
+			if( !n || n + 1 + mk_com_strlen( tool ) >= sizeof( buf ) ) {
+				continue;
+			}
+
+			memcpy( (void *)buf, (const void *)p, n );
+			buf[ n ] = '/';
+			mk_com_strcpy( &buf[ n + 1 ], sizeof( buf ) - ( n + 1 ), tool );
+
+			mk_stats_count( kMkStats_StatCalls, 1 );
+			if( stat( buf, &s ) == 0 && ( s.st_mode & S_IFREG ) ) {
+				id = mk_oc__hashTool( buf, &s );
+				break;
+			}
+		}
+	}
+
+	mk_async_mtxLock( &mk__g_oc.lock );
+	if( mk__g_oc.numTools < MK_OC__MAX_TOOLS && mk_com_strlen( tool ) < sizeof( mk__g_oc.tools[ 0 ] ) ) {
+		mk_com_strcpy( mk__g_oc.tools[ mk__g_oc.numTools ], sizeof( mk__g_oc.tools[ 0 ] ), tool );
+		mk__g_oc.toolIds[ mk__g_oc.numTools ] = id;
+		++mk__g_oc.numTools;
+	}
+	mk_async_mtxUnlock( &mk__g_oc.lock );
+
+	return id;
+}
+
+/*
+ *	manifests
+ */
+
+typedef struct {
+	const unsigned char *p;
+	const unsigned char *e;
+} MkOcReader;
+
+static int mk_oc__read( MkOcReader *r, void *dst, size_t n ) {
+	if( ( size_t )( r->e - r->p ) < n ) {
+		return 0;
+	}
+
+	memcpy( dst, (const void *)r->p, n );
+	r->p += n;
+
+	return 1;
+}
+
+/* skip over a manifest's header; returns the number of results or -1 */
+static long mk_oc__readHeader( MkOcReader *r ) {
+	mk_uint32_t header[ 3 ];
+
+	if( !mk_oc__read( r, (void *)header, sizeof( header ) ) ) {
+		return -1;
+	}
+	if( header[0] != MK_OC__MAGIC || header[1] != MK_OC__VERSION || header[2] > MK_OC__MAX_RESULTS ) {
+		return -1;
+	}
+
+	return (long)header[2];
+}
+
+/* read one result of a manifest; `*matches` is set if the files it depended
+   on still have the same contents. Returns 0 if the manifest is damaged. */
+static int mk_oc__readResult( MkOcReader *r, mk_uint64_t *result, int *matches ) {
+	mk_uint64_t hash, current;
+	mk_uint32_t i, numDeps, len;
+	char path[PATH_MAX];
+
+	if( !mk_oc__read( r, (void *)result, sizeof( *result ) ) || !mk_oc__read( r, (void *)&numDeps, sizeof( numDeps ) ) ) {
+		return 0;
+	}
+
+	*matches = 1;
+	for( i = 0; i < numDeps; ++i ) {
+		if( !mk_oc__read( r, (void *)&len, sizeof( len ) ) || !len || len >= sizeof( path ) ||
+		    !mk_oc__read( r, (void *)path, len ) || !mk_oc__read( r, (void *)&hash, sizeof( hash ) ) ) {
+			return 0;
+		}
+		path[ len ] = '\0';
+
+		if( *matches && ( !mk_fs_hashFile( path, &current ) || current != hash ) ) {
+			*matches = 0;
+		}
+	}
+
+	return 1;
+}
+
+static int mk_oc__write( FILE *fp, const void *p, size_t n ) {
+	return +( fwrite( p, n, 1, fp ) == 1 );
+}
+
+/*
+================
+mk_oc_lookup
+
+look for the result of a compile in the cache. On a hit, `obj` and its ".d"
+file are replaced by the cached ones, `*output` receives what the compiler
+printed (or null; free it with mk_com_memory()), and 1 is returned.
+
+`*key` is set to the key to pass to mk_oc_store() once the file has been
+compiled, or 0 if the compile can't be cached.
+================
+*/
+int mk_oc_lookup( const char *tool, const char *cmd, const char *src, const char *obj, mk_uint64_t *key, char **output ) {
+	unsigned char *data;
+	mk_uint64_t toolId, srcHash, hash, result;
+	MkOcReader r;
+	size_t size;
+	long i, n;
+	int matches, hit;
+	char path[PATH_MAX], dep[PATH_MAX], cwd[PATH_MAX];
+
+	MK_ASSERT( tool != (const char *)0 );
+	MK_ASSERT( cmd != (const char *)0 );
+	MK_ASSERT( src != (const char *)0 );
+	MK_ASSERT( obj != (const char *)0 );
+	MK_ASSERT( key != (mk_uint64_t *)0 );
+	MK_ASSERT( output != (char **)0 );
+
+	*key    = 0;
+	*output = (char *)0;
+
+	if( !( toolId = mk_oc__getCompilerId( tool ) ) || !mk_fs_hashFile( src, &srcHash ) ) {
+		mk_async_mtxLock( &mk__g_oc.lock );
+		++mk__g_oc.misses;
+		mk_async_mtxUnlock( &mk__g_oc.lock );
+		return 0;
+	}
+
+	mk_fs_getCWD( cwd, sizeof( cwd ) );
+
+	hash = mk_com_hash64( MK_HASH64_INIT, (const void *)&toolId, sizeof( toolId ) );
+	hash = mk_com_hashStr64( hash, cwd );
+	hash = mk_com_hashStr64( hash, cmd );
+	hash = mk_com_hash64( hash, (const void *)&srcHash, sizeof( srcHash ) );
+	*key = hash ? hash : 1;
+
+	/* find a result whose dependencies haven't changed */
+	hit = 0;
+	mk_oc__getPath( path, sizeof( path ), *key, ".m" );
+	if( ( data = mk_oc__readFile( path, &size ) ) != (unsigned char *)0 ) {
+		r.p = data;
+		r.e = data + size;
+
+		n = mk_oc__readHeader( &r );
+		for( i = 0; i < n; ++i ) {
+			if( !mk_oc__readResult( &r, &result, &matches ) ) {
+				break;
+			}
+			if( matches ) {
+				hit = 1;
+				break;
+			}
+		}
+
+		data = (unsigned char *)mk_com_memory( (void *)data, 0 );
+	}
+
+	if( hit ) {
+		(void)utime( path, (const struct utimbuf *)0 );
+
+		mk_com_substExt( dep, sizeof( dep ), obj, ".d" );
+
+		mk_oc__getPath( path, sizeof( path ), result, ".o" );
+		hit = mk_fs_copyFile( path, obj );
+		(void)utime( path, (const struct utimbuf *)0 );
+
+		mk_oc__getPath( path, sizeof( path ), result, ".d" );
+		hit = hit && mk_fs_copyFile( path, dep );
+		(void)utime( path, (const struct utimbuf *)0 );
+
+		mk_oc__getPath( path, sizeof( path ), result, ".txt" );
+		if( hit ) {
+			*output = (char *)mk_oc__readFile( path, &size );
+		}
+	}
+
+	mk_async_mtxLock( &mk__g_oc.lock );
+	if( hit ) {
+		++mk__g_oc.hits;
+	} else {
+		++mk__g_oc.misses;
+	}
+	mk_async_mtxUnlock( &mk__g_oc.lock );
+
+	return hit;
+}
+
+/*
+================
+mk_oc_store
+
+add the result of a compile to the cache. `key` is from mk_oc_lookup(), `deps`
+is what the object depends on, `output` is what the compiler printed, and
+`started` is when the compile began: if any of the dependencies was modified
+since, what was compiled may not match what's there now, so nothing is stored.
+================
+*/
+void mk_oc_store( mk_uint64_t key, const char *obj, MkDep deps, const char *output, time_t started ) {
+	unsigned char *data;
+	mk_uint64_t *hashes;
+	mk_uint64_t result, old;
+	mk_uint32_t header[ 3 ], numDeps, len;
+	const char *name;
+	MkOcReader r;
+	MkStat_t s;
+	size_t i, n, size;
+	long j, numOld;
+	FILE *fp;
+	int ok, matches;
+	const unsigned char *start;
+	char path[PATH_MAX], tmp[PATH_MAX], dep[PATH_MAX];
+
+	MK_ASSERT( obj != (const char *)0 );
+	MK_ASSERT( deps != (MkDep)0 );
+
+	if( !key ) {
+		return;
+	}
+
+	/* hash the dependencies as they are now */
+	n      = mk_dep_getSize( deps );
+	hashes = (mk_uint64_t *)mk_com_memory( (void *)0, sizeof( *hashes )*( n + 1 ) );
+	result = key;
+	for( i = 0; i < n; ++i ) {
+		name = mk_dep_at( deps, i );
+
+		mk_fs_invalidate( name );
+		if( !mk_fs_stat( name, &s ) || s.st_mtime >= started || !mk_fs_hashFile( name, &hashes[ i ] ) ) {
+			hashes = (mk_uint64_t *)mk_com_memory( (void *)hashes, 0 );
+			return;
+		}
+
+		result = mk_com_hashStr64( result, name );
+		result = mk_com_hash64( result, (const void *)&hashes[ i ], sizeof( hashes[ i ] ) );
+	}
+
+	/* the result */
+	mk_oc__getPath( path, sizeof( path ), result, ".o" );
+	(void)mk_com_extractDir( tmp, sizeof( tmp ), path );
+	mk_fs_makeDirs( tmp );
+
+	mk_com_substExt( dep, sizeof( dep ), obj, ".d" );
+	ok = mk_oc__install( obj, path );
+	if( ok && stat( path, &s ) == 0 ) {
+		mk__g_oc.bytesStored += ( mk_uint64_t )s.st_size;
+	}
+
+	mk_oc__getPath( path, sizeof( path ), result, ".d" );
+	ok = ok && mk_oc__install( dep, path );
+	if( ok && stat( path, &s ) == 0 ) {
+		mk__g_oc.bytesStored += ( mk_uint64_t )s.st_size;
+	}
+
+	mk_oc__getPath( path, sizeof( path ), result, ".txt" );
+	if( ok && output != (const char *)0 && *output != '\0' ) {
+		if( mk_oc__getTempPath( tmp, sizeof( tmp ), path ) && ( fp = fopen( tmp, "wb" ) ) != (FILE *)0 ) {
+			mk_stats_count( kMkStats_FilesOpened, 1 );
+			ok = mk_oc__write( fp, (const void *)output, mk_com_strlen( output ) );
+			ok = fclose( fp ) == 0 && ok;
+#if MK_WINDOWS_ENABLED
+			remove( path );
+#endif
+			ok = ok && rename( tmp, path ) == 0;
+			if( !ok ) {
+				remove( tmp );
+			}
+		} else {
+			ok = 0;
+		}
+
+		mk__g_oc.bytesStored += mk_com_strlen( output );
+	} else {
+		remove( path );
+	}
+
+	if( !ok ) {
+		hashes = (mk_uint64_t *)mk_com_memory( (void *)hashes, 0 );
+		return;
+	}
+
+	/* the manifest: this result, then the others that are still there */
+	mk_oc__getPath( path, sizeof( path ), key, ".m" );
+	(void)mk_com_extractDir( tmp, sizeof( tmp ), path );
+	mk_fs_makeDirs( tmp );
+
+	data   = mk_oc__readFile( path, &size );
+	numOld = -1;
+	if( data != (unsigned char *)0 ) {
+		r.p = data;
+		r.e = data + size;
+
+		numOld = mk_oc__readHeader( &r );
+	}
+
+	ok = 0;
+	if( mk_oc__getTempPath( tmp, sizeof( tmp ), path ) && ( fp = fopen( tmp, "wb" ) ) != (FILE *)0 ) {
+		mk_stats_count( kMkStats_FilesOpened, 1 );
+		header[0] = MK_OC__MAGIC;
+		header[1] = MK_OC__VERSION;
+		header[2] = 1;
+		numDeps   = (mk_uint32_t)n;
+		ok = mk_oc__write( fp, (const void *)header, sizeof( header ) ) &&
+		     mk_oc__write( fp, (const void *)&result, sizeof( result ) ) &&
+		     mk_oc__write( fp, (const void *)&numDeps, sizeof( numDeps ) );
+
+		for( i = 0; ok && i < n; ++i ) {
+			name = mk_dep_at( deps, i );
+			len  = (mk_uint32_t)mk_com_strlen( name );
+
+			ok = mk_oc__write( fp, (const void *)&len, sizeof( len ) ) && mk_oc__write( fp, (const void *)name, len ) &&
+			     mk_oc__write( fp, (const void *)&hashes[ i ], sizeof( hashes[ i ] ) );
+		}
+
+		/* the older results are copied as they are; only the count changes */
+		for( j = 0; ok && j < numOld && header[2] < MK_OC__MAX_RESULTS; ++j ) {
+			start = r.p;
+			if( !mk_oc__readResult( &r, &old, &matches ) ) {
+				break;
+			}
+
+			if( old != result ) {
+				ok = mk_oc__write( fp, (const void *)start, ( size_t )( r.p - start ) );
+				++header[2];
+			}
+		}
+
+		if( ok && header[2] > 1 ) {
+			ok = fseek( fp, sizeof( mk_uint32_t )*2, SEEK_SET ) == 0 && mk_oc__write( fp, (const void *)&header[2], sizeof( header[2] ) );
+		}
+
+		ok = fclose( fp ) == 0 && ok;
+#if MK_WINDOWS_ENABLED
+		if( ok ) {
+			remove( path );
+		}
+#endif
+		ok = ok && rename( tmp, path ) == 0;
+		if( !ok ) {
+			remove( tmp );
+		}
+	}
+
+	data   = (unsigned char *)mk_com_memory( (void *)data, 0 );
+	hashes = (mk_uint64_t *)mk_com_memory( (void *)hashes, 0 );
+
+	if( ok ) {
+		++mk__g_oc.stores;
+	}
+}
+
+/*
+ *	statistics and eviction
+ */
+
+static void mk_oc__readStats( MkOcStats *stats ) {
+	unsigned long long x;
+	FILE *fp;
+	char path[PATH_MAX], line[ 128 ], name[ 32 ];
+
+	memset( (void *)stats, 0, sizeof( *stats ) );
+
+	mk_oc__getDir( path, sizeof( path ) );
+	mk_com_strcat( path, sizeof( path ), "stats" );
+	if( !( fp = fopen( path, "r" ) ) ) {
+		return;
+	}
+
+	while( fgets( line, sizeof( line ), fp ) != (char *)0 ) {
+		if( sscanf( line, "%31s %llu", name, &x ) != 2 ) {
+			continue;
+		}
+
+		if( !strcmp( name, "hits" ) ) {
+			stats->hits = ( mk_uint64_t )x;
+		} else if( !strcmp( name, "misses" ) ) {
+			stats->misses = ( mk_uint64_t )x;
+		} else if( !strcmp( name, "stores" ) ) {
+			stats->stores = ( mk_uint64_t )x;
+		} else if( !strcmp( name, "size" ) ) {
+			stats->size = ( mk_uint64_t )x;
+		}
+	}
+
+	fclose( fp );
+}
+static void mk_oc__writeStats( const MkOcStats *stats ) {
+	FILE *fp;
+	int ok;
+	char path[PATH_MAX], tmp[PATH_MAX];
+
+	mk_oc__getDir( path, sizeof( path ) );
+	mk_fs_makeDirs( path );
+	mk_com_strcat( path, sizeof( path ), "stats" );
+
+	if( !mk_oc__getTempPath( tmp, sizeof( tmp ), path ) || !( fp = fopen( tmp, "w" ) ) ) {
+		return;
+	}
+
+	ok = fprintf( fp, "hits %llu\nmisses %llu\nstores %llu\nsize %llu\n",
+	    (unsigned long long)stats->hits, (unsigned long long)stats->misses,
+	    (unsigned long long)stats->stores, (unsigned long long)stats->size ) > 0;
+	ok = fclose( fp ) == 0 && ok;
+
+#if MK_WINDOWS_ENABLED
+	if( ok ) {
+		remove( path );
+	}
+#endif
+	if( !ok || rename( tmp, path ) != 0 ) {
+		remove( tmp );
+	}
+}
+
+/* the size limit, in bytes */
+static mk_uint64_t mk_oc__getLimit( void ) {
+	unsigned long long mb;
+	char buf[ 64 ];
+
+	mb = MK_OBJCACHE_MAX_MB;
+	if( mk_com_getenv( buf, sizeof( buf ), "MK_CACHE_MAX_MB" ) != (const char *)0 && buf[0] != '\0' ) {
+		mb = strtoull( buf, (char **)0, 10 );
+	}
+
+	return ( mk_uint64_t )mb*1024*1024;
+}
+
+/* count every file in the cache (except the stats), listing them in `*files`
+   if that's given; returns their total size */
+static mk_uint64_t mk_oc__scan( MkOcFile **files, size_t *numFiles ) {
+	struct dirent *dp, *fdp;
+	mk_uint64_t total;
+	MkStat_t s;
+	size_t maxFiles;
+	DIR *d, *fd;
+	char root[PATH_MAX], sub[PATH_MAX], path[PATH_MAX];
+
+	total     = 0;
+	maxFiles  = 0;
+	*numFiles = 0;
+	if( files != (MkOcFile **)0 ) {
+		*files = (MkOcFile *)0;
+	}
+
+	mk_oc__getDir( root, sizeof( root ) );
+	if( stat( root, &s ) != 0 || !( d = mk_fs_openDir( root ) ) ) {
+		return 0;
+	}
+
+	errno = 0;
+	while( ( dp = mk_fs_readDir( d ) ) != (struct dirent *)0 ) {
+		if( mk_com_strlen( dp->d_name ) != 2 ) {
+			continue;
+		}
+
+		if( snprintf( sub, sizeof( sub ), "%s%s/", root, dp->d_name ) >= (int)sizeof( sub ) || !( fd = mk_fs_openDir( sub ) ) ) {
+			errno = 0;
+			continue;
+		}
+
+		while( ( fdp = mk_fs_readDir( fd ) ) != (struct dirent *)0 ) {
+			if( snprintf( path, sizeof( path ), "%s%s", sub, fdp->d_name ) >= (int)sizeof( path ) ||
+			    stat( path, &s ) != 0 || !( s.st_mode & S_IFREG ) ) {
+				errno = 0;
+				continue;
+			}
+
+			total += ( mk_uint64_t )s.st_size;
+			if( !files ) {
+				++*numFiles;
+				continue;
+			}
+
+			if( *numFiles == maxFiles ) {
+				maxFiles = maxFiles ? maxFiles*2 : 256;
+				*files   = (MkOcFile *)mk_com_memory( (void *)*files, sizeof( MkOcFile )*maxFiles );
+			}
+
+			( *files )[ *numFiles ].path  = mk_com_strdup( path );
+			( *files )[ *numFiles ].mtime = s.st_mtime;
+			( *files )[ *numFiles ].size  = ( mk_uint64_t )s.st_size;
+			++*numFiles;
+		}
+
+		mk_fs_closeDir( fd );
+		errno = 0;
+	}
+
+	mk_fs_closeDir( d );
+	errno = 0;
+
+	return total;
+}
+
+static int mk_oc__cmpFileAge( const void *a, const void *b ) {
+	const MkOcFile *x, *y;
+
+	x = (const MkOcFile *)a;
+	y = (const MkOcFile *)b;
+
+	return x->mtime < y->mtime ? -1 : x->mtime > y->mtime ? +1 : 0;
+}
+
+/* remove the least recently used files until the cache is well under its
+   limit (so this doesn't happen on every run); returns the new size */
+static mk_uint64_t mk_oc__trim( mk_uint64_t limit ) {
+	MkOcFile *files;
+	mk_uint64_t total;
+	size_t i, numFiles, removed;
+
+	total = mk_oc__scan( &files, &numFiles );
+	qsort( (void *)files, numFiles, sizeof( *files ), &mk_oc__cmpFileAge );
+
+	removed = 0;
+	for( i = 0; i < numFiles; ++i ) {
+		if( total > limit - limit/5 && remove( files[ i ].path ) == 0 ) {
+			total -= files[ i ].size;
+			++removed;
+		}
+
+		files[ i ].path = (char *)mk_com_memory( (void *)files[ i ].path, 0 );
+	}
+
+	files = (MkOcFile *)mk_com_memory( (void *)files, 0 );
+
+	mk_dbg_outf( "object cache: removed %u files to stay under the size limit\n", (unsigned)removed );
+	return total;
+}
+
+/* add this run's counters to the stats file, trimming the cache if it grew too
+   big */
+void mk_oc_flush( void ) {
+	MkOcStats stats;
+	mk_uint64_t limit;
+	size_t numFiles;
+
+	if( !mk__g_oc.hits && !mk__g_oc.misses && !mk__g_oc.stores ) {
+		return;
+	}
+
+	mk_oc__readStats( &stats );
+	stats.hits   += mk__g_oc.hits;
+	stats.misses += mk__g_oc.misses;
+	stats.stores += mk__g_oc.stores;
+	stats.size   += mk__g_oc.bytesStored;
+
+	mk__g_oc.hits        = 0;
+	mk__g_oc.misses      = 0;
+	mk__g_oc.stores      = 0;
+	mk__g_oc.bytesStored = 0;
+
+	/* the size counted so far only grows (replaced files are counted twice),
+	   so check it before going to the trouble of measuring */
+	limit = mk_oc__getLimit();
+	if( stats.size > limit ) {
+		stats.size = mk_oc__scan( (MkOcFile **)0, &numFiles );
+		if( stats.size > limit ) {
+			stats.size = mk_oc__trim( limit );
+		}
+	}
+
+	mk_oc__writeStats( &stats );
+}
+
+/* print the statistics of the cache (`mk --cache-stats`) */
+void mk_oc_printStats( void ) {
+	MkOcStats stats;
+	mk_uint64_t size, lookups;
+	size_t numFiles;
+	char dir[PATH_MAX];
+
+	mk_oc__readStats( &stats );
+
+	numFiles = 0;
+	size     = mk_oc__scan( (MkOcFile **)0, &numFiles );
+	lookups  = stats.hits + stats.misses;
+
+	mk_oc__getDir( dir, sizeof( dir ) );
+
+	printf( "cache directory   %s\n", dir );
+	printf( "hits              %llu", (unsigned long long)stats.hits );
+	if( lookups > 0 ) {
+		printf( " (%.1f%%)", 100.0*(double)stats.hits/(double)lookups );
+	}
+	printf( "\n" );
+	printf( "misses            %llu\n", (unsigned long long)stats.misses );
+	printf( "objects stored    %llu\n", (unsigned long long)stats.stores );
+	printf( "files             %lu\n", (unsigned long)numFiles );
+	printf( "size              %.1f MiB (limit %.1f MiB)\n", (double)size/( 1024.0*1024.0 ),
+	    (double)mk_oc__getLimit()/( 1024.0*1024.0 ) );
+}
@@ -0,0 +1,44 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+ *	========================================================================
+ *	OBJECT CACHE
+ *	========================================================================
+ *	A per-user cache of compiled objects (enabled with `--cache`), kept
+ *	under the global mk directory and shared by every project and checkout
+ *	directory built there. A compile is looked up by the compiler, its full
+ *	command line, the directory it runs in, and the contents of the source
+ *	and of every file the compile read the last time; on a hit, the object,
+ *	its dependency file, and the compiler's output are copied back instead
+ *	of running the compiler.
+ *
+ *	The cache is trimmed to MK_OBJCACHE_MAX_MB (or $MK_CACHE_MAX_MB) by
+ *	removing what was used least recently.
+ *
+ *	mk_oc_lookup() is safe to call from build worker threads; everything else
+ *	is for the main thread.
+ */
+
+#include "mk-basic-common.h"
+#include "mk-build-dependency.h"
+
+#include <time.h>
+
+int  mk_oc_lookup( const char *tool, const char *cmd, const char *src, const char *obj, mk_uint64_t *key, char **output );
+void mk_oc_store( mk_uint64_t key, const char *obj, MkDep deps, const char *output, time_t started );
+void mk_oc_flush( void );
+void mk_oc_printStats( void );
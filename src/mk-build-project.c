@@ -19,6 +19,7 @@
 #include "mk-basic-debug.h"
 #include "mk-basic-logging.h"
 #include "mk-basic-options.h"
+#include "mk-basic-stats.h"
 #include "mk-basic-stringList.h"
 #include "mk-basic-types.h"
 #include "mk-build-engine.h"
@@ -54,7 +55,8 @@ MkProject mk_prj_new( MkProject prnt ) {
 	proj->specialdirs = mk_sl_new();
 	proj->libs        = mk_sl_new();
 
-	proj->testsources = mk_sl_new();
+	proj->testsources  = mk_sl_new();
+	proj->benchsources = mk_sl_new();
 
 	proj->srcdirs = mk_sl_new();
 
@@ -68,6 +70,8 @@ MkProject mk_prj_new( MkProject prnt ) {
 
 	proj->lib = (MkLib)0;
 
+	proj->bldnode = (struct MkBuildNode_s *)0;
+
 	proj->prnt   = prnt;
 	proj->p_head = prnt ? &prnt->head : &mk__g_proj_head;
 	proj->p_tail = prnt ? &prnt->tail : &mk__g_proj_tail;
@@ -109,6 +113,7 @@ void mk_prj_delete( MkProject proj ) {
 	mk_sl_delete( proj->libs );
 
 	mk_sl_delete( proj->testsources );
+	mk_sl_delete( proj->benchsources );
 
 	mk_sl_delete( proj->srcdirs );
 
@@ -335,6 +340,7 @@ void mk_prj_addLib( MkProject proj, const char *libname ) {
 	MK_ASSERT( libname != (const char *)0 );
 
 	mk_sl_pushBack( proj->libs, libname );
+	mk_lib_invalidateDeps();
 }
 
 /* retrieve the number of libraries in a project */
@@ -495,6 +501,34 @@ const char *mk_prj_testSourceFileAt( MkProject proj, size_t i ) {
 	return mk_sl_at( proj->testsources, i );
 }
 
+/* add a benchmark source file to a project */
+void mk_prj_addBenchSourceFile( MkProject proj, const char *src ) {
+	MK_ASSERT( proj != (MkProject)0 );
+	MK_ASSERT( src != (const char *)0 );
+
+	MK_ASSERT( proj->benchsources != (MkStrList)0 );
+
+	mk_sl_pushBack( proj->benchsources, src );
+}
+
+/* retrieve the number of benchmark source files within a project */
+size_t mk_prj_numBenchSourceFiles( MkProject proj ) {
+	MK_ASSERT( proj != (MkProject)0 );
+
+	MK_ASSERT( proj->benchsources != (MkStrList)0 );
+
+	return mk_sl_getSize( proj->benchsources );
+}
+
+/* retrieve a benchmark source file of a project */
+const char *mk_prj_benchSourceFileAt( MkProject proj, size_t i ) {
+	MK_ASSERT( proj != (MkProject)0 );
+
+	MK_ASSERT( proj->benchsources != (MkStrList)0 );
+
+	return mk_sl_at( proj->benchsources, i );
+}
+
 /* add a "special directory" to a project */
 void mk_prj_addSpecialDir( MkProject proj, const char *dir ) {
 	MK_ASSERT( proj != (MkProject)0 );
@@ -570,6 +604,11 @@ void mk_prj_printAll( MkProject proj, const char *margin ) {
 		for( i = 0; i < n; i++ ) {
 			printf( "%s # %s\n", margin, mk_prj_testSourceFileAt( proj, i ) );
 		}
+
+		n = mk_prj_numBenchSourceFiles( proj );
+		for( i = 0; i < n; i++ ) {
+			printf( "%s ~ %s\n", margin, mk_prj_benchSourceFileAt( proj, i ) );
+		}
 	}
 
 	mk_com_strcpy( marginbuf, sizeof( marginbuf ), margin );
@@ -621,6 +660,7 @@ static void mk_prj__expandLibDeps_r( MkProject proj ) {
 		}
 
 		mk_sl_makeUnique( proj->libs );
+		mk_lib_invalidateDeps();
 	} while( mk_sl_getSize( proj->libs ) != n ); /* mk_sl_makeUnique can alter count */
 }
 static void mk_prj__saveLibDeps( MkProject proj ) {
@@ -676,6 +716,7 @@ static void mk_prj__loadLibDeps( MkProject proj ) {
 #endif
 		return;
 	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
 
 	if( !fread( &buf[0], 8, 1, fp ) ) {
 		fclose( fp );
@@ -752,6 +793,7 @@ static void mk_prj__loadLibDeps( MkProject proj ) {
 #endif
 
 	mk_sl_makeUnique( proj->libs );
+	mk_lib_invalidateDeps();
 
 #if MK_DEBUG_LIBDEPS_ENABLED
 	mk_dbg_enter( "libdeps-project(\"%s\")", proj->name );
@@ -98,6 +98,7 @@ struct MkProject_s {
 	MkStrList libs;
 
 	MkStrList testsources;
+	MkStrList benchsources;
 
 	MkStrList srcdirs; /* needed for determining object paths */
 
@@ -111,6 +112,9 @@ struct MkProject_s {
 
 	MkLib lib;
 
+	/* the project's node in the build graph, while one is being processed */
+	struct MkBuildNode_s *bldnode;
+
 	struct MkProject_s *prnt, **p_head, **p_tail;
 	struct MkProject_s *head, *tail;
 	struct MkProject_s *prev, *next;
@@ -163,6 +167,9 @@ const char *mk_prj_sourceFileAt( MkProject proj, size_t i );
 void        mk_prj_addTestSourceFile( MkProject proj, const char *src );
 size_t      mk_prj_numTestSourceFiles( MkProject proj );
 const char *mk_prj_testSourceFileAt( MkProject proj, size_t i );
+void        mk_prj_addBenchSourceFile( MkProject proj, const char *src );
+size_t      mk_prj_numBenchSourceFiles( MkProject proj );
+const char *mk_prj_benchSourceFileAt( MkProject proj, size_t i );
 
 void        mk_prj_addSpecialDir( MkProject proj, const char *dir );
 size_t      mk_prj_numSpecialDirs( MkProject proj );
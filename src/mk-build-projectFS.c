@@ -20,6 +20,7 @@
 #include "mk-basic-fileSystem.h"
 #include "mk-basic-logging.h"
 #include "mk-basic-options.h"
+#include "mk-basic-stats.h"
 #include "mk-basic-stringList.h"
 #include "mk-basic-types.h"
 #include "mk-build-autolib.h"
@@ -35,6 +36,19 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+/* files listing extra libraries for the projects in a directory */
+static const char *const mk_prjfs__libsFiles[] = {
+	".libs", ".user.libs",
+	".mk-libs", ".user.mk-libs",
+	"mk-libs.txt", "mk-libs.user.txt"
+};
+/* files listing extra directories, in the current directory */
+static const char *const mk_prjfs__workspaceFiles[] = {
+	".workspace", ".user.workspace",
+	".mk-workspace", ".user.mk-workspace",
+	"mk-workspace.txt", "mk-workspace.user.txt"
+};
+
 /* determine if the directory name specified is special */
 int mk_prjfs_isSpecialDir( MkProject proj, const char *name ) {
 	static const char *const specialdirs[] = {
@@ -221,13 +235,29 @@ int mk_prjfs_isTestDir( MkProject proj, const char *name ) {
 	return 0;
 }
 
+/* determine if the directory is a benchmark directory */
+int mk_prjfs_isBenchDir( MkProject proj, const char *name ) {
+	(void)proj;
+
+	if( !strcmp( name, "bench" ) || !strcmp( name, "benches" ) || !strcmp( name, "benchmarks" ) ) {
+		return 1;
+	}
+
+	return 0;
+}
+
 /* determine whether a directory owns a project indicator file or not */
 int mk_prjfs_isDirOwner( const char *path ) {
-	MkStat_t s;
+	const MkFsDirList *list;
 	size_t i;
 
+	if( !( list = mk_fs_listDir( path ) ) ) {
+		errno = 0;
+		return 0;
+	}
+
 	for( i = 0; i < sizeof( mk__g_ifiles ) / sizeof( mk__g_ifiles[0] ); i++ ) {
-		if( stat( mk_com_va( "%s%s", path, mk__g_ifiles[i] ), &s ) != -1 ) {
+		if( mk_fs_findDirEntry( list, mk__g_ifiles[i].name ) != (const MkFsDirEntry *)0 ) {
 			return 1;
 		}
 	}
@@ -297,66 +327,127 @@ static int isExtensionCPP( const char *ext ) {
 static int isExtensionCFamily( const char *ext ) {
 	return isExtensionC( ext ) || isExtensionCPP( ext );
 }
+static int isExtensionHeader( const char *ext ) {
+	static const char *const exts[] = {
+		".h", ".H",
+		".hh", ".HH",
+		".hpp", ".HPP",
+		".hxx", ".HXX",
+		".h++", ".H++",
+		".inl", ".INL"
+	};
+	size_t i;
 
-static struct dirent *readDirQuietly( DIR *d ) {
-	errno = 0;
-	return mk_fs_readDir( d );
+	for( i = 0; i < sizeof( exts ) / sizeof( exts[0] ); ++i ) {
+		if( strcmp( ext, exts[i] ) == 0 ) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* determine whether a file describes projects (indicator files, ".libs", the
+   workspace and autolink configuration) */
+int mk_prjfs_isProjectFile( const char *name ) {
+	size_t i;
+
+	MK_ASSERT( name != (const char *)0 );
+
+	for( i = 0; i < sizeof( mk__g_ifiles ) / sizeof( mk__g_ifiles[0] ); i++ ) {
+		if( !strcmp( name, mk__g_ifiles[i].name ) ) {
+			return 1;
+		}
+	}
+	for( i = 0; i < sizeof( mk_prjfs__libsFiles ) / sizeof( mk_prjfs__libsFiles[0] ); i++ ) {
+		if( !strcmp( name, mk_prjfs__libsFiles[i] ) ) {
+			return 1;
+		}
+	}
+	for( i = 0; i < sizeof( mk_prjfs__workspaceFiles ) / sizeof( mk_prjfs__workspaceFiles[0] ); i++ ) {
+		if( !strcmp( name, mk_prjfs__workspaceFiles[i] ) ) {
+			return 1;
+		}
+	}
+
+	return +( strcmp( name, "mk-autolinks.txt" ) == 0 );
+}
+
+/* determine whether an entry of a directory can change which projects, source
+   files, or autolinked headers are found; anything else (editor backups, swap
+   files, ...) may come and go freely */
+int mk_prjfs_affectsDiscovery( const char *name, MkFsEntryType type ) {
+	const char *ext;
+
+	MK_ASSERT( name != (const char *)0 );
+
+	if( type == kMkFsEntry_Dir ) {
+		return 1;
+	}
+
+	if( ( ext = getFileExtension( name ) ) != (const char *)0 ) {
+		if( isExtensionCFamily( ext ) || isExtensionHeader( ext ) ) {
+			return 1;
+		}
+	}
+
+	return mk_prjfs_isProjectFile( name );
 }
 
 /* enumerate all source files in a directory */
 static void mk_prj__enumSourceFilesImpl( MkProject proj, const char *srcdir ) {
-	struct dirent *dp;
+	const MkFsDirList *list;
+	const MkFsDirEntry *dp;
+	size_t i;
 	char path[PATH_MAX], *p;
-	DIR *d;
 	int r;
 
 	MK_ASSERT( proj != (MkProject)0 );
 	MK_ASSERT( srcdir != (const char *)0 );
 
-	if( !( d = mk_fs_openDir( srcdir ) ) ) {
-		mk_log_error( srcdir, 0, 0, "mk_fs_openDir() call in mk_prjfs_enumSourceFiles() failed" );
+	if( !( list = mk_fs_listDir( srcdir ) ) ) {
+		mk_log_error( srcdir, 0, 0, "mk_fs_listDir() call in mk_prjfs_enumSourceFiles() failed" );
 		return;
 	}
 
-	while( ( dp = readDirQuietly( d ) ) != (struct dirent *)0 ) {
+	for( i = 0; i < list->numEntries; ++i ) {
+		dp = &list->entries[ i ];
+
 		mk_com_strcpy( path, sizeof( path ), srcdir );
-		mk_com_strcat( path, sizeof( path ), dp->d_name );
+		mk_com_strcat( path, sizeof( path ), dp->name );
 
-		if( ( p = (char *)getFileExtension( dp->d_name ) ) != (char *)0 ) {
+		if( ( p = (char *)getFileExtension( dp->name ) ) != (char *)0 ) {
 			if( isExtensionCFamily( p ) ) {
-				if( !mk_fs_isFile( path ) ) {
-					errno = 0;
-					continue;
+				if( dp->type == kMkFsEntry_File ) {
+					mk_prj_addSourceFile( proj, path );
 				}
-
-				mk_prj_addSourceFile( proj, path );
 				continue;
 			}
 		}
 
-		if( !mk_fs_isDir( path ) ) {
+		if( dp->type != kMkFsEntry_Dir ) {
 			continue;
 		}
 
 		/* the following tests all require an ending '/' */
 		mk_com_strcat( path, sizeof( path ), "/" );
 
-		r = mk_prjfs_isSpecialDir( proj, dp->d_name ); /*can now return -1*/
+		r = mk_prjfs_isSpecialDir( proj, dp->name ); /*can now return -1*/
 		if( r != 0 ) {
 			if( r == 1 ) {
-				mk_prj_addSpecialDir( proj, dp->d_name );
+				mk_prj_addSpecialDir( proj, dp->name );
 				mk_prjfs_enumSourceFiles( proj, path );
 			}
 			continue;
 		}
 
-		if( mk_prjfs_isIncDir( proj, dp->d_name ) ) {
+		if( mk_prjfs_isIncDir( proj, dp->name ) ) {
 			mk_front_pushIncDir( path );
 			mk_al_managePackage_r( proj->name, proj->sys, path );
 			continue;
 		}
 
-		if( mk_prjfs_isLibDir( proj, dp->d_name ) ) {
+		if( mk_prjfs_isLibDir( proj, dp->name ) ) {
 			if( proj->config & kMkProjCfg_Package_Bit ) {
 				mk_prj_setOutPath( proj, path );
 			}
@@ -364,22 +455,21 @@ static void mk_prj__enumSourceFilesImpl( MkProject proj, const char *srcdir ) {
 			continue;
 		}
 
-		if( mk_prjfs_isTestDir( proj, dp->d_name ) ) {
+		if( mk_prjfs_isTestDir( proj, dp->name ) ) {
 			mk_prjfs_enumTestSourceFiles( proj, path );
 			continue;
 		}
 
+		if( mk_prjfs_isBenchDir( proj, dp->name ) ) {
+			mk_prjfs_enumBenchSourceFiles( proj, path );
+			continue;
+		}
+
 		if( !mk_prjfs_isDirOwner( path ) ) {
 			mk_prjfs_enumSourceFiles( proj, path );
 			continue;
 		}
 	}
-
-	mk_fs_closeDir( d );
-
-	if( errno ) {
-		mk_log_error( srcdir, 0, 0, "mk_prjfs_enumSourceFiles() failed" );
-	}
 }
 void mk_prjfs_enumSourceFiles( MkProject proj, const char *srcdir ) {
 	mk_dbg_enter( "mk_prjfs_enumSourceFiles(project:\"%s\", srcdir:\"%s\")", proj->name, srcdir );
@@ -387,60 +477,61 @@ void mk_prjfs_enumSourceFiles( MkProject proj, const char *srcdir ) {
 	mk_dbg_leave();
 }
 
-/* enumerate all unit tests in a directory */
-static void mk_prj__enumTestSourceFilesImpl( MkProject proj, const char *srcdir ) {
-	struct dirent *dp;
+/* enumerate all unit tests (or benchmarks) in a directory */
+static void mk_prj__enumTestSourceFilesImpl( MkProject proj, const char *srcdir, void( *pfn_add )( MkProject, const char * ) ) {
+	const MkFsDirList *list;
+	const MkFsDirEntry *dp;
+	size_t i;
 	char path[PATH_MAX], *p;
-	DIR *d;
 
 	MK_ASSERT( proj != (MkProject)0 );
 	MK_ASSERT( srcdir != (const char *)0 );
 
-	if( !( d = mk_fs_openDir( srcdir ) ) ) {
-		mk_log_error( srcdir, 0, 0, "mk_fs_openDir() call in mk_prjfs_enumTestSourceFiles() failed" );
+	if( !( list = mk_fs_listDir( srcdir ) ) ) {
+		mk_log_error( srcdir, 0, 0, "mk_fs_listDir() call in mk_prj__enumTestSourceFilesImpl() failed" );
 		return;
 	}
 
-	while( ( dp = readDirQuietly( d ) ) != (struct dirent *)0 ) {
+	for( i = 0; i < list->numEntries; ++i ) {
+		dp = &list->entries[ i ];
+
 		mk_com_strcpy( path, sizeof( path ), srcdir );
-		mk_com_strcat( path, sizeof( path ), dp->d_name );
+		mk_com_strcat( path, sizeof( path ), dp->name );
 
-		if( ( p = (char *)getFileExtension( dp->d_name ) ) != (char *)0 ) {
+		if( ( p = (char *)getFileExtension( dp->name ) ) != (char *)0 ) {
 			if( isExtensionCFamily( p ) ) {
-				if( !mk_fs_isFile( path ) ) {
-					errno = 0;
-					continue;
+				if( dp->type == kMkFsEntry_File ) {
+					pfn_add( proj, path );
 				}
-
-				mk_prj_addTestSourceFile( proj, path );
 				continue;
 			}
 		}
 
-		if( !mk_fs_isDir( path ) ) {
-			errno = 0;
+		if( dp->type != kMkFsEntry_Dir ) {
 			continue;
 		}
 
-		if( mk_prjfs_isSpecialDir( proj, dp->d_name ) ) {
-			mk_prj_addSpecialDir( proj, dp->d_name );
+		if( mk_prjfs_isSpecialDir( proj, dp->name ) ) {
+			mk_prj_addSpecialDir( proj, dp->name );
 			mk_com_strcat( path, sizeof( path ), "/" ); /* ending '/' is necessary */
-			mk_prjfs_enumTestSourceFiles( proj, path );
+			mk_prj__enumTestSourceFilesImpl( proj, path, pfn_add );
 		}
 	}
-
-	mk_fs_closeDir( d );
-
-	if( errno ) {
-		mk_log_error( srcdir, 0, 0, "mk_prjfs_enumTestSourceFiles() failed" );
-	}
 }
 void mk_prjfs_enumTestSourceFiles( MkProject proj, const char *srcdir ) {
 	MK_ASSERT( proj != (MkProject)0 );
 	MK_ASSERT( proj->name != (const char *)0 );
 
 	mk_dbg_enter( "mk_prjfs_enumTestSourceFiles(project:\"%s\", srcdir:\"%s\")", proj->name, srcdir );
-	mk_prj__enumTestSourceFilesImpl( proj, srcdir );
+	mk_prj__enumTestSourceFilesImpl( proj, srcdir, &mk_prj_addTestSourceFile );
+	mk_dbg_leave();
+}
+void mk_prjfs_enumBenchSourceFiles( MkProject proj, const char *srcdir ) {
+	MK_ASSERT( proj != (MkProject)0 );
+	MK_ASSERT( proj->name != (const char *)0 );
+
+	mk_dbg_enter( "mk_prjfs_enumBenchSourceFiles(project:\"%s\", srcdir:\"%s\")", proj->name, srcdir );
+	mk_prj__enumTestSourceFilesImpl( proj, srcdir, &mk_prj_addBenchSourceFile );
 	mk_dbg_leave();
 }
 
@@ -459,6 +550,7 @@ int mk_prjfs_calcName( MkProject proj, const char *path, const char *file ) {
 			mk_log_error( file, 0, 0, "fopen() call in mk_prjfs_calcName() failed" );
 			return 0;
 		}
+		mk_stats_count( kMkStats_FilesOpened, 1 );
 
 		buf[0] = 0;
 		fgets( buf, sizeof( buf ), f );
@@ -569,20 +661,23 @@ MkProject mk_prjfs_add( MkProject prnt, const char *path, const char *file, int
 
 /* find all projects within a specific packages directory */
 void mk_prjfs_findPackages( const char *pkgdir ) {
-	struct dirent *dp;
+	const MkFsDirList *list;
 	MkProject proj;
+	size_t i;
 	char path[PATH_MAX];
-	DIR *d;
 
-	/* opne the directory to find packages */
-	if( !( d = mk_fs_openDir( pkgdir ) ) ) {
+	/* list the directory to find packages */
+	if( !( list = mk_fs_listDir( pkgdir ) ) ) {
 		mk_log_fatalError( pkgdir );
 	}
 
 	/* run through each entry in the directory */
-	while( ( dp = mk_fs_readDir( d ) ) != (struct dirent *)0 ) {
+	for( i = 0; i < list->numEntries; ++i ) {
 		/* validate the directory */
-		if( !mk_fs_realPath( mk_com_va( "%s/%s/", pkgdir, dp->d_name ), path,
+		if( list->entries[ i ].type != kMkFsEntry_Dir ) {
+			continue;
+		}
+		if( !mk_fs_realPath( mk_com_va( "%s/%s/", pkgdir, list->entries[ i ].name ), path,
 		        sizeof( path ) ) ) {
 			errno = 0;
 			continue;
@@ -595,32 +690,27 @@ void mk_prjfs_findPackages( const char *pkgdir ) {
 			continue;
 		}
 	}
-
-	/* close this directory */
-	mk_fs_closeDir( d );
-
-	/* if an error occurred, display it */
-	if( errno ) {
-		mk_log_fatalError( mk_com_va( "readdir(\"%s\") failed", pkgdir ) );
-	}
 }
 
 /* find all dlls */
 void mk_prjfs_findDynamicLibs( const char *dllsdir ) {
-	struct dirent *dp;
+	const MkFsDirList *list;
 	MkProject proj;
+	size_t i;
 	char path[PATH_MAX];
-	DIR *d;
 
-	/* opne the directory to find packages */
-	if( !( d = mk_fs_openDir( dllsdir ) ) ) {
+	/* list the directory to find packages */
+	if( !( list = mk_fs_listDir( dllsdir ) ) ) {
 		mk_log_fatalError( dllsdir );
 	}
 
 	/* run through each entry in the directory */
-	while( ( dp = mk_fs_readDir( d ) ) != (struct dirent *)0 ) {
+	for( i = 0; i < list->numEntries; ++i ) {
 		/* validate the directory */
-		if( !mk_fs_realPath( mk_com_va( "%s/%s/", dllsdir, dp->d_name ), path,
+		if( list->entries[ i ].type != kMkFsEntry_Dir ) {
+			continue;
+		}
+		if( !mk_fs_realPath( mk_com_va( "%s/%s/", dllsdir, list->entries[ i ].name ), path,
 		        sizeof( path ) ) ) {
 			errno = 0;
 			continue;
@@ -633,32 +723,27 @@ void mk_prjfs_findDynamicLibs( const char *dllsdir ) {
 			continue;
 		}
 	}
-
-	/* close this directory */
-	mk_fs_closeDir( d );
-
-	/* if an error occurred, display it */
-	if( errno ) {
-		mk_log_fatalError( mk_com_va( "readdir(\"%s\") failed", dllsdir ) );
-	}
 }
 
 /* find all tools */
 void mk_prjfs_findTools( const char *tooldir ) {
-	struct dirent *dp;
+	const MkFsDirList *list;
 	MkProject proj;
+	size_t i;
 	char path[PATH_MAX];
-	DIR *d;
 
-	/* opne the directory to find packages */
-	if( !( d = mk_fs_openDir( tooldir ) ) ) {
+	/* list the directory to find packages */
+	if( !( list = mk_fs_listDir( tooldir ) ) ) {
 		mk_log_fatalError( tooldir );
 	}
 
 	/* run through each entry in the directory */
-	while( ( dp = mk_fs_readDir( d ) ) != (struct dirent *)0 ) {
+	for( i = 0; i < list->numEntries; ++i ) {
 		/* validate the directory */
-		if( !mk_fs_realPath( mk_com_va( "%s/%s/", tooldir, dp->d_name ), path,
+		if( list->entries[ i ].type != kMkFsEntry_Dir ) {
+			continue;
+		}
+		if( !mk_fs_realPath( mk_com_va( "%s/%s/", tooldir, list->entries[ i ].name ), path,
 		        sizeof( path ) ) ) {
 			errno = 0;
 			continue;
@@ -671,59 +756,52 @@ void mk_prjfs_findTools( const char *tooldir ) {
 			continue;
 		}
 	}
-
-	/* close this directory */
-	mk_fs_closeDir( d );
-
-	/* if an error occurred, display it */
-	if( errno ) {
-		mk_log_fatalError( mk_com_va( "readdir(\"%s\") failed", tooldir ) );
-	}
 }
 
 /* find all projects within a specific source directory, adding them as children
    to the 'prnt' project. */
 void mk_prjfs_findProjects( MkProject prnt, const char *srcdir ) {
-	static const char *libs[] = {
-		".libs", ".user.libs",
-		".mk-libs", ".user.mk-libs",
-		"mk-libs.txt", "mk-libs.user.txt"
-	};
 	static char buf[32768];
-	struct dirent *dp;
-	MkStat_t s;
+	const MkFsDirList *list, *sublist;
+	const MkFsDirEntry *ent;
 	MkProject proj;
-	size_t i, j;
+	size_t i, j, k;
 	FILE *f;
 	char path[PATH_MAX], file[PATH_MAX], *p;
-	DIR *d;
 
 	proj = (MkProject)0;
 
-	/* open the source directory to add projects */
-	if( !( d = mk_fs_openDir( srcdir ) ) ) {
+	/* list the source directory to add projects */
+	if( !( list = mk_fs_listDir( srcdir ) ) ) {
 		mk_log_fatalError( srcdir );
 	}
 
 	/* run through each entry in the directory */
-	while( ( dp = mk_fs_readDir( d ) ) != (struct dirent *)0 ) {
+	for( k = 0; k < list->numEntries; ++k ) {
 		/* make sure this is a directory; get the real (absolute) path */
-		if( !mk_fs_realPath( mk_com_va( "%s/%s/", srcdir, dp->d_name ), path,
+		if( list->entries[ k ].type != kMkFsEntry_Dir ) {
+			continue;
+		}
+		if( !mk_fs_realPath( mk_com_va( "%s/%s/", srcdir, list->entries[ k ].name ), path,
 		        sizeof( path ) ) ) {
 			errno = 0;
 			continue;
 		}
+		if( !( sublist = mk_fs_listDir( path ) ) ) {
+			errno = 0;
+			continue;
+		}
 
 		/* run through each indicator file test (.executable, ...) */
 		for( i = 0; i < sizeof( mk__g_ifiles ) / sizeof( mk__g_ifiles[0] ); i++ ) {
-			mk_com_strcpy( file, sizeof( file ), mk_com_va( "%s%s", path, mk__g_ifiles[i].name ) );
-
 			/* make sure this file exists */
-			if( !mk_fs_isFile( file ) ) {
-				errno = 0;
+			ent = mk_fs_findDirEntry( sublist, mk__g_ifiles[i].name );
+			if( !ent || ent->type != kMkFsEntry_File ) {
 				continue;
 			}
 
+			mk_com_strcpy( file, sizeof( file ), mk_com_va( "%s%s", path, mk__g_ifiles[i].name ) );
+
 			/* add the project file */
 			proj = mk_prjfs_add( prnt, path, file, mk__g_ifiles[i].type );
 			if( !proj ) {
@@ -731,15 +809,16 @@ void mk_prjfs_findProjects( MkProject prnt, const char *srcdir ) {
 			}
 
 			/* if this entry contains a '.libs' file, then add to the project */
-			for( j = 0; j < sizeof( libs ) / sizeof( libs[0] ); j++ ) {
-				mk_com_strcpy( file, sizeof( file ), mk_com_va( "%s/%s", srcdir, libs[j] ) );
-
-				if( stat( file, &s ) != 0 ) {
+			for( j = 0; j < sizeof( mk_prjfs__libsFiles ) / sizeof( mk_prjfs__libsFiles[0] ); j++ ) {
+				if( !mk_fs_findDirEntry( list, mk_prjfs__libsFiles[j] ) ) {
 					continue;
 				}
 
+				mk_com_strcpy( file, sizeof( file ), mk_com_va( "%s/%s", srcdir, mk_prjfs__libsFiles[j] ) );
+
 				f = fopen( file, "r" );
 				if( f ) {
+					mk_stats_count( kMkStats_FilesOpened, 1 );
 					if( fgets( buf, sizeof( buf ), f ) != (char *)0 ) {
 						p = strchr( buf, '\r' );
 						if( p ) {
@@ -767,14 +846,76 @@ void mk_prjfs_findProjects( MkProject prnt, const char *srcdir ) {
 			mk_prjfs_findProjects( proj, path );
 		}
 	}
+}
+
+/* how much of a tree the discovery walk reads ahead of the passes that add the
+   projects; see mk_prjfs__walk_f() */
+enum {
+	/* subdirectories might be projects (e.g., "src/") */
+	kMkPrjfsWalk_SrcRoot,
+	/* every subdirectory is a project (e.g., "pkg/") */
+	kMkPrjfsWalk_PkgRoot,
+	/* a project only if it has an indicator file */
+	kMkPrjfsWalk_Candidate,
+	/* everything below a project is enumerated, so read all of it */
+	kMkPrjfsWalk_Project
+};
+
+/* NOTE: runs on the walker's threads; must not touch any project state */
+static int mk_prjfs__walk_f( const char *path, const MkFsDirList *list, int state, void *userData ) {
+	size_t i;
+
+	((void)path);
+	((void)userData);
+
+	switch( state ) {
+	case kMkPrjfsWalk_SrcRoot:
+		return kMkPrjfsWalk_Candidate;
+
+	case kMkPrjfsWalk_Candidate:
+		for( i = 0; i < sizeof( mk__g_ifiles ) / sizeof( mk__g_ifiles[0] ); i++ ) {
+			if( mk_fs_findDirEntry( list, mk__g_ifiles[i].name ) != (const MkFsDirEntry *)0 ) {
+				return kMkPrjfsWalk_Project;
+			}
+		}
+		return -1;
+
+	default:
+		break;
+	}
+
+	return kMkPrjfsWalk_Project;
+}
+
+/* read the source trees on all job threads at once, so the (serial) passes
+   that add the projects find every listing they need already cached */
+static void mk_prjfs__prefetch( MkStrList srcdirs, MkStrList pkgdirs, MkStrList tooldirs, MkStrList dllsdirs ) {
+	MkStrList roots;
+	int *states;
+	size_t i, n;
 
-	/* close this directory */
-	mk_fs_closeDir( d );
+	roots  = mk_sl_new();
+	states = (int *)mk_com_memory( (void *)0, sizeof( int )*( mk_sl_getSize( srcdirs ) + mk_sl_getSize( pkgdirs ) +
+	    mk_sl_getSize( tooldirs ) + mk_sl_getSize( dllsdirs ) + 1 ) );
 
-	/* if an error occurred, display it */
-	if( errno ) {
-		mk_log_fatalError( mk_com_va( "readdir(\"%s\") failed", srcdir ) );
+#define MK__ADD_ROOTS( Dirs_, State_ )                      \
+	n = mk_sl_getSize( Dirs_ );                             \
+	for( i = 0; i < n; ++i ) {                              \
+		states[ mk_sl_getSize( roots ) ] = ( State_ );      \
+		mk_sl_pushBack( roots, mk_sl_at( ( Dirs_ ), i ) ); \
 	}
+
+	MK__ADD_ROOTS( pkgdirs, kMkPrjfsWalk_PkgRoot )
+	MK__ADD_ROOTS( dllsdirs, kMkPrjfsWalk_PkgRoot )
+	MK__ADD_ROOTS( tooldirs, kMkPrjfsWalk_PkgRoot )
+	MK__ADD_ROOTS( srcdirs, kMkPrjfsWalk_SrcRoot )
+
+#undef MK__ADD_ROOTS
+
+	mk_fs_walkDirs( roots, states, &mk_prjfs__walk_f, (void *)0, mk__g_numJobs );
+
+	states = (int *)mk_com_memory( (void *)states, 0 );
+	mk_sl_delete( roots );
 }
 
 /* find the root directories, adding projects for any of the 'srcdirs' */
@@ -803,13 +944,7 @@ void mk_prjfs_findRootDirs( MkStrList srcdirs, MkStrList incdirs, MkStrList libd
 		{ "sdk/tools", (MkStrList)4 },
 		{ "sdk/dlls", (MkStrList)5 }
 	};
-	static const char *workspaces[] = {
-		".workspace", ".user.workspace",
-		".mk-workspace", ".user.mk-workspace",
-		"mk-workspace.txt", "mk-workspace.user.txt"
-	};
 	static char buf[32768];
-	MkStat_t s;
 	MkProject proj;
 	size_t i, n;
 	FILE *f;
@@ -851,10 +986,7 @@ void mk_prjfs_findRootDirs( MkStrList srcdirs, MkStrList incdirs, MkStrList libd
 			continue;
 		}
 
-		if( stat( tests[i].name, &s ) == -1 ) {
-			continue;
-		}
-		if( ~s.st_mode & S_IFDIR ) {
+		if( !mk_fs_isDir( tests[i].name ) ) {
 			continue;
 		}
 
@@ -862,9 +994,10 @@ void mk_prjfs_findRootDirs( MkStrList srcdirs, MkStrList incdirs, MkStrList libd
 	}
 
 	/* use the .workspace file to add extra directories */
-	for( i = 0; i < sizeof( workspaces ) / sizeof( workspaces[0] ); i++ ) {
-		f = fopen( workspaces[i], "r" );
+	for( i = 0; i < sizeof( mk_prjfs__workspaceFiles ) / sizeof( mk_prjfs__workspaceFiles[0] ); i++ ) {
+		f = fopen( mk_prjfs__workspaceFiles[i], "r" );
 		if( f ) {
+			mk_stats_count( kMkStats_FilesOpened, 1 );
 			/* every line of the file specifies another directory */
 			while( fgets( buf, sizeof( buf ), f ) != (char *)0 ) {
 				p = strchr( buf, '\r' );
@@ -909,6 +1042,8 @@ void mk_prjfs_findRootDirs( MkStrList srcdirs, MkStrList incdirs, MkStrList libd
 
 	errno = 0;
 
+	mk_prjfs__prefetch( srcdirs, pkgdirs, tooldirs, dllsdirs );
+
 	/* find packages first */
 	n = mk_sl_getSize( pkgdirs );
 	for( i = 0; i < n; i++ ) {
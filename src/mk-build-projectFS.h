@@ -20,6 +20,7 @@
  *	========================================================================
  */
 
+#include "mk-basic-fileSystem.h"
 #include "mk-basic-stringList.h"
 #include "mk-build-project.h"
 
@@ -27,10 +28,14 @@ int mk_prjfs_isSpecialDir( MkProject proj, const char *name );
 int mk_prjfs_isIncDir( MkProject proj, const char *name );
 int mk_prjfs_isLibDir( MkProject proj, const char *name );
 int mk_prjfs_isTestDir( MkProject proj, const char *name );
+int mk_prjfs_isBenchDir( MkProject proj, const char *name );
 int mk_prjfs_isDirOwner( const char *path );
+int mk_prjfs_isProjectFile( const char *name );
+int mk_prjfs_affectsDiscovery( const char *name, MkFsEntryType type );
 
 void mk_prjfs_enumSourceFiles( MkProject proj, const char *srcdir );
 void mk_prjfs_enumTestSourceFiles( MkProject proj, const char *srcdir );
+void mk_prjfs_enumBenchSourceFiles( MkProject proj, const char *srcdir );
 
 int       mk_prjfs_calcName( MkProject proj, const char *path, const char *file );
 MkProject mk_prjfs_add( MkProject prnt, const char *path, const char *file, int type );
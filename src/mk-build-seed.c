@@ -0,0 +1,380 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "mk-build-seed.h"
+
+#include "mk-basic-assert.h"
+#include "mk-basic-common.h"
+#include "mk-basic-debug.h"
+#include "mk-basic-fileSystem.h"
+#include "mk-basic-logging.h"
+#include "mk-basic-stringList.h"
+#include "mk-basic-types.h"
+#include "mk-build-dependency.h"
+#include "mk-build-engine.h"
+#include "mk-build-makefileDependency.h"
+#include "mk-build-project.h"
+#include "mk-build-projectFS.h"
+#include "mk-build-stateDatabase.h"
+#include "mk-defs-config.h"
+#include "mk-defs-platform.h"
+#include "mk-system-output.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct MkSeed_s {
+	/* the other checkout (resolved, with a trailing slash) and this one */
+	char   other[PATH_MAX];
+	size_t otherLen;
+	char   cwd[PATH_MAX];
+	size_t cwdLen;
+
+	/* kMkFsTransfer_* */
+	int methods;
+
+	unsigned int numMissing;  /* objects this checkout didn't have */
+	unsigned int numObjects;  /* ... of which were seeded */
+	unsigned int numArchives;
+	unsigned int numReflinked;
+	unsigned int numLinked;
+	unsigned int numCopied;
+} MkSeed;
+
+/* join a directory (ending in a slash) and a relative path; returns 0 if the
+   result doesn't fit */
+static int mk_seed__join( char *dst, size_t dstn, const char *dir, const char *path ) {
+	int r;
+
+	r = snprintf( dst, dstn, "%s%s", dir, path );
+	return +( r >= 0 && (size_t)r < dstn );
+}
+
+static int mk_seed__isAbsolute( const char *path ) {
+#if MK_WINDOWS_ENABLED
+	if( path[0] != '\0' && path[1] == ':' ) {
+		return 1;
+	}
+#endif
+	return +( path[0] == '/' );
+}
+
+/*
+================
+mk_seed__mapPath
+
+find the other checkout's copy of a dependency listed in its dependency file
+(`there`) and the name to record for it here (`here`). Returns 1 if it's a
+file of the other checkout's own, which has to be the same in this one, 0 if
+it's from elsewhere (e.g., a system header), or -1 if a path is too long.
+================
+*/
+static int mk_seed__mapPath( const MkSeed *seed, const char *dep, char *here, size_t heren, char *there, size_t theren ) {
+	if( !mk_seed__isAbsolute( dep ) ) {
+		mk_com_strcpy( here, heren, dep );
+		return mk_seed__join( there, theren, seed->other, dep ) ? 1 : -1;
+	}
+
+	mk_com_strcpy( there, theren, dep );
+	if( !strncmp( dep, seed->other, seed->otherLen ) ) {
+		return mk_seed__join( here, heren, seed->cwd, &dep[seed->otherLen] ) ? 1 : -1;
+	}
+
+	mk_com_strcpy( here, heren, dep );
+	return 0;
+}
+
+/* write a path into a dependency file */
+static void mk_seed__writePath( FILE *fp, const char *path ) {
+	for( ; *path != '\0'; ++path ) {
+		if( *path == ' ' ) {
+			fputc( '\\', fp );
+		}
+		fputc( *path, fp );
+	}
+}
+
+/* write a dependency file the way `-MD -MP` would have */
+static int mk_seed__writeDeps( const char *path, const char *obj, MkStrList deps ) {
+	FILE *fp;
+	size_t i, n;
+	int ok;
+
+	if( !( fp = fopen( path, "wb" ) ) ) {
+		return 0;
+	}
+
+	mk_seed__writePath( fp, obj );
+	fputc( ':', fp );
+
+	n = mk_sl_getSize( deps );
+	for( i = 0; i < n; ++i ) {
+		fputs( i == 0 ? " " : " \\\n ", fp );
+		mk_seed__writePath( fp, mk_sl_at( deps, i ) );
+	}
+	fputc( '\n', fp );
+
+	/* headers get empty rules, so removing one doesn't break make */
+	for( i = 1; i < n; ++i ) {
+		fputc( '\n', fp );
+		mk_seed__writePath( fp, mk_sl_at( deps, i ) );
+		fputs( ":\n", fp );
+	}
+
+	ok = +!ferror( fp );
+	if( fclose( fp ) != 0 ) {
+		ok = 0;
+	}
+	mk_fs_invalidate( path );
+
+	return ok;
+}
+
+static void mk_seed__countTransfer( MkSeed *seed, int how ) {
+	switch( how ) {
+	case kMkFsTransfer_Reflink:
+		++seed->numReflinked;
+		break;
+	case kMkFsTransfer_HardLink:
+		++seed->numLinked;
+		break;
+	case kMkFsTransfer_Copy:
+		++seed->numCopied;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+================
+mk_seed__object
+
+take over an object (and its dependencies) from the other checkout, if it's
+still valid for this one. `newest` is updated with the modification time the
+object had there. Returns 1 if the object was seeded.
+================
+*/
+static int mk_seed__object( MkSeed *seed, const char *obj, const char *cmd, time_t *newest ) {
+	MkStat_t objStat, s;
+	MkStrList deps;
+	mk_uint64_t a, b;
+	MkDep d;
+	size_t i, n;
+	int inTree, how, ok;
+	char otherObj[PATH_MAX], otherDep[PATH_MAX], dep[PATH_MAX];
+	char here[PATH_MAX], there[PATH_MAX];
+
+	if( !mk_seed__join( otherObj, sizeof( otherObj ), seed->other, obj ) ) {
+		return 0;
+	}
+	mk_com_substExt( otherDep, sizeof( otherDep ), otherObj, ".d" );
+
+	if( !mk_fs_stat( otherObj, &objStat ) ) {
+		return 0;
+	}
+
+	/* the other checkout's dependency file names the object just like ours */
+	if( ( d = mk_dep_find( obj ) ) != (MkDep)0 ) {
+		mk_dep_delete( d );
+	}
+	if( !mk_mfdep_load( otherDep ) || !( d = mk_dep_find( obj ) ) ) {
+		return 0;
+	}
+
+	deps = mk_sl_new();
+	ok   = 1;
+
+	n = mk_dep_getSize( d );
+	for( i = 0; i < n && ok; ++i ) {
+		if( ( inTree = mk_seed__mapPath( seed, mk_dep_at( d, i ), here, sizeof( here ), there, sizeof( there ) ) ) < 0 ) {
+			ok = 0;
+		} else if( !mk_fs_stat( there, &s ) || objStat.st_mtime <= s.st_mtime ) {
+			/* stale there; it would have been rebuilt */
+			ok = 0;
+		} else if( inTree && ( !mk_fs_hashFile( here, &a ) || !mk_fs_hashFile( there, &b ) || a != b ) ) {
+			ok = 0;
+		} else {
+			mk_sl_pushBack( deps, here );
+		}
+	}
+	mk_dep_delete( d );
+
+	if( !ok || !n ) {
+		mk_sl_delete( deps );
+		return 0;
+	}
+
+	mk_com_substExt( dep, sizeof( dep ), obj, ".d" );
+	if( !( how = mk_fs_transferFile( otherObj, obj, seed->methods ) ) || !mk_seed__writeDeps( dep, obj, deps ) ) {
+		mk_dbg_outf( "failed to seed \"%s\" from \"%s\"\n", obj, otherObj );
+
+		remove( obj );
+		mk_fs_invalidate( obj );
+		mk_sl_delete( deps );
+		return 0;
+	}
+	mk_seed__countTransfer( seed, how );
+
+	/* the build state is what keeps a hard-linked object's old timestamp from
+	   looking out of date */
+	d = mk_dep_new( obj );
+	for( i = 0; i < n; ++i ) {
+		mk_dep_push( d, mk_sl_at( deps, i ) );
+	}
+	mk_bdb_setObject( obj, mk_com_hashStr64( MK_HASH64_INIT, cmd ), d, 0 );
+	mk_dep_delete( d );
+
+	mk_sl_delete( deps );
+
+	if( *newest < objStat.st_mtime ) {
+		*newest = objStat.st_mtime;
+	}
+
+	return 1;
+}
+
+/* take over a static library whose objects were all seeded, if the other
+   checkout archived them after they were last built */
+static void mk_seed__archive( MkSeed *seed, MkProject proj, time_t newest ) {
+	MkStat_t s;
+	int how;
+	char bin[PATH_MAX], otherBin[PATH_MAX], dir[PATH_MAX];
+
+	mk_bld_getBinName( proj, bin, sizeof( bin ) );
+	if( mk_fs_stat( bin, &s ) ) {
+		return;
+	}
+
+	if( !mk_seed__join( otherBin, sizeof( otherBin ), seed->other, bin ) ) {
+		return;
+	}
+	if( !mk_fs_stat( otherBin, &s ) || s.st_mtime < newest ) {
+		return;
+	}
+
+	(void)mk_com_extractDir( dir, sizeof( dir ), bin );
+	if( dir[0] != '\0' ) {
+		mk_fs_makeDirs( dir );
+	}
+
+	if( ( how = mk_fs_transferFile( otherBin, bin, seed->methods ) ) != 0 ) {
+		mk_seed__countTransfer( seed, how );
+		++seed->numArchives;
+	}
+}
+
+static void mk_seed__project_r( MkSeed *seed, MkProject proj ) {
+	const char *src, *tool;
+	MkProject chld;
+	MkStat_t s;
+	time_t newest;
+	char *cmd;
+	size_t i, n;
+	int all;
+	char obj[PATH_MAX];
+
+	if( mk_prj_isTarget( proj ) && ( n = mk_prj_numSourceFiles( proj ) ) > 0 ) {
+		tool = mk_bld_getCompiler( ( proj->config & kMkProjCfg_UsesCxx_Bit ) != 0 );
+		mk_prjfs_makeObjDirs( proj );
+
+		newest = 0;
+		all    = 1;
+		for( i = 0; i < n; ++i ) {
+			src = mk_prj_sourceFileAt( proj, i );
+			mk_bld_getObjName( proj, obj, sizeof( obj ), &src[seed->cwdLen] );
+
+			if( mk_fs_stat( obj, &s ) ) {
+				all = 0;
+				continue;
+			}
+			++seed->numMissing;
+
+			/* the same command the build would compile the object with */
+			cmd = mk_com_strdup( mk_com_va( "%s %s", tool, mk_bld_getCFlags( proj, obj, &src[seed->cwdLen] ) ) );
+			if( mk_seed__object( seed, obj, cmd, &newest ) ) {
+				++seed->numObjects;
+			} else {
+				all = 0;
+			}
+			cmd = (char *)mk_com_memory( (void *)cmd, 0 );
+		}
+
+		if( all && mk_prj_getType( proj ) == kMkProjTy_StaticLib ) {
+			mk_seed__archive( seed, proj, newest );
+		}
+	}
+
+	for( chld = mk_prj_head( proj ); chld; chld = mk_prj_next( chld ) ) {
+		mk_seed__project_r( seed, chld );
+	}
+}
+
+/*
+================
+mk_seed_objdir
+
+seed the object directory from the checkout at `other`, using any of the
+transfer `methods` given (kMkFsTransfer_*). Returns 0 if `other` can't be
+used at all; objects that can't be seeded are just left to be built.
+================
+*/
+int mk_seed_objdir( const char *other, int methods ) {
+	static MkSeed seed;
+	MkProject proj;
+	mk_uint64_t t;
+	char real[PATH_MAX];
+
+	MK_ASSERT( other != (const char *)0 );
+
+	memset( (void *)&seed, 0, sizeof( seed ) );
+	seed.methods = methods;
+
+	if( !mk_fs_realPath( other, seed.other, sizeof( seed.other ) ) || !mk_fs_isDir( seed.other ) ) {
+		mk_log_errorMsg( mk_com_va( "^F%s^&: not seeding from here", other ) );
+		return 0;
+	}
+	seed.otherLen = mk_com_strlen( seed.other );
+
+	(void)mk_fs_getCWD( seed.cwd, sizeof( seed.cwd ) );
+	seed.cwdLen = mk_com_strlen( seed.cwd );
+
+	if( !mk_fs_realPath( seed.cwd, real, sizeof( real ) ) || !strcmp( real, seed.other ) ) {
+		mk_log_errorMsg( mk_com_va( "^F%s^&: can't seed from this same checkout", other ) );
+		return 0;
+	}
+
+	t = mk_com_getTimeNs();
+
+	for( proj = mk_prj_rootHead(); proj; proj = mk_prj_next( proj ) ) {
+		mk_seed__project_r( &seed, proj );
+	}
+
+	/* what was read from the other checkout's dependency files */
+	mk_dep_deleteAll();
+
+	if( !mk_bdb_save() ) {
+		mk_dbg_outf( "failed to save the build state\n" );
+	}
+
+	t = mk_com_getTimeNs() - t;
+	mk_sys_printf( kMkSIO_Err, "seeded %u of %u object%s and %u archive%s from %s "
+		"(%u reflinked, %u hard-linked, %u copied) in %.1f ms\n",
+	    seed.numObjects, seed.numMissing, seed.numMissing == 1 ? "" : "s",
+	    seed.numArchives, seed.numArchives == 1 ? "" : "s", seed.other,
+	    seed.numReflinked, seed.numLinked, seed.numCopied, (double)t/1000000.0 );
+
+	return 1;
+}
@@ -0,0 +1,36 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+ *	========================================================================
+ *	OBJECT DIRECTORY SEEDING
+ *	========================================================================
+ *	`mk --seed-objdir=<dir>` starts a fresh checkout (or worktree) off with
+ *	the objects another one at <dir> already built. An object is taken over
+ *	only if it's missing here, it was built after every file it depends on
+ *	there, and every one of those files that belongs to the other checkout
+ *	is byte-for-byte the same here; its dependency file is written anew with
+ *	paths into the other checkout pointed at this one. A static library is
+ *	taken over too once all of its objects were.
+ *
+ *	Files are reflinked where the file system allows it, hard linked where
+ *	it doesn't, and copied as a last resort (see mk_fs_transferFile()).
+ *
+ *	The other checkout is assumed to have been built with the same options;
+ *	the command lines it used aren't recorded anywhere this could check.
+ */
+
+int mk_seed_objdir( const char *other, int methods );
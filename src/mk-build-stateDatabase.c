@@ -0,0 +1,850 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "mk-build-stateDatabase.h"
+
+#include "mk-basic-assert.h"
+#include "mk-basic-async.h"
+#include "mk-basic-common.h"
+#include "mk-basic-debug.h"
+#include "mk-basic-fileSystem.h"
+#include "mk-basic-options.h"
+#include "mk-basic-stats.h"
+#include "mk-basic-types.h"
+#include "mk-build-dependency.h"
+#include "mk-defs-config.h"
+#include "mk-defs-platform.h"
+#include "mk-frontend.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ *	File layout (native byte order; a file from another machine simply fails
+ *	the magic check and is ignored):
+ *
+ *		u32 magic, version, numPaths, numRecords, numDeps
+ *		numPaths   x { u32 length; char path[length]; stamp hashed; u64 contentHash; u32 duration; }
+ *		numRecords x { u32 obj, numDeps, flags; u64 cmdHash, depsHash; stamp obj; }
+ *		numDeps    x u32 path index (each record's list, in record order)
+ *
+ *	where a stamp is { u64 mtime (nanoseconds), size, inode; }. A path's
+ *	content hash is only valid while the file still matches `hashed` (which
+ *	is all zero if the file was never hashed). A path's duration is how many
+ *	milliseconds the file took to make last time, or 0 if that's unknown.
+ */
+#define MK_BDB_MAGIC   0x53424B4DUL /* "MKBS" */
+#define MK_BDB_VERSION 3
+
+typedef struct {
+	mk_uint64_t mtime;
+	mk_uint64_t size;
+	mk_uint64_t inode;
+} MkBdbStamp;
+
+enum {
+	kMkBdbStat_Unknown,
+	kMkBdbStat_Exists,
+	kMkBdbStat_Missing
+};
+
+typedef struct {
+	char *      name;
+	mk_uint64_t hash;
+
+	int        statState;
+	MkBdbStamp stamp;
+
+	/* for --hash-deps; see the file layout */
+	MkBdbStamp  hashStamp;
+	mk_uint64_t contentHash;
+
+	mk_uint32_t duration; /* see the file layout */
+	mk_uint32_t record;   /* record index + 1, or 0 */
+} MkBdbPath;
+
+enum {
+	/* depsHash combines the contents of the dependencies rather than their
+	   stamps */
+	kMkBdbRec_ByContent_Bit  = 0x01,
+	/* the record is of a unit test that failed when last run */
+	kMkBdbRec_TestFailed_Bit = 0x02
+};
+
+typedef struct {
+	mk_uint32_t obj;
+	mk_uint32_t firstDep;
+	mk_uint32_t numDeps;
+	mk_uint32_t flags;
+
+	mk_uint64_t cmdHash;
+	mk_uint64_t depsHash;
+	MkBdbStamp  stamp;
+} MkBdbRecord;
+
+static struct {
+	int loaded;
+	int dirty;
+
+	MkBdbPath * paths;
+	mk_uint32_t numPaths, maxPaths;
+
+	/* open addressing; each slot is a path index + 1, or 0 */
+	mk_uint32_t *slots;
+	mk_uint32_t  numSlots;
+
+	MkBdbRecord *records;
+	mk_uint32_t  numRecords, maxRecords;
+
+	mk_uint32_t *deps;
+	mk_uint32_t  numDeps, maxDeps;
+} mk__g_bdb;
+
+static const char *mk_bdb__getPath( void ) {
+	return mk_com_va( "%s/%s/%s", mk_opt_getObjdirBase(), mk_opt_getConfigName(), MK_DEFAULT_BUILDSTATE_FILENAME );
+}
+
+/* grow an array to hold at least `n` elements */
+static void *mk_bdb__reserve( void *p, mk_uint32_t *capacity, mk_uint32_t n, size_t elemSize ) {
+	mk_uint32_t c;
+
+	if( n <= *capacity ) {
+		return p;
+	}
+
+	c = *capacity ? *capacity : 64;
+	while( c < n ) {
+		c *= 2;
+	}
+
+	*capacity = c;
+	return mk_com_memory( p, c*elemSize );
+}
+
+/* rebuild the lookup table to fit the current number of paths */
+static void mk_bdb__rehash( void ) {
+	mk_uint32_t i, j, n;
+
+	n = 256;
+	while( n < mk__g_bdb.numPaths*2 ) {
+		n *= 2;
+	}
+
+	if( n == mk__g_bdb.numSlots ) {
+		return;
+	}
+
+	mk__g_bdb.slots    = (mk_uint32_t *)mk_com_memory( (void *)mk__g_bdb.slots, 0 );
+	mk__g_bdb.slots    = (mk_uint32_t *)mk_com_memory( (void *)0, n*sizeof( mk_uint32_t ) );
+	mk__g_bdb.numSlots = n;
+	memset( (void *)mk__g_bdb.slots, 0, n*sizeof( mk_uint32_t ) );
+
+	for( i = 0; i < mk__g_bdb.numPaths; ++i ) {
+		j = (mk_uint32_t)mk__g_bdb.paths[ i ].hash & ( n - 1 );
+		while( mk__g_bdb.slots[ j ] != 0 ) {
+			j = ( j + 1 ) & ( n - 1 );
+		}
+
+		mk__g_bdb.slots[ j ] = i + 1;
+	}
+}
+
+/* find a path's index; returns ~0 if it isn't known and `add` is 0 */
+static mk_uint32_t mk_bdb__intern( const char *name, size_t len, int add ) {
+	MkBdbPath *path;
+	mk_uint64_t hash;
+	mk_uint32_t i, j;
+
+	hash = mk_com_hash64( MK_HASH64_INIT, (const void *)name, len );
+
+	if( mk__g_bdb.numSlots > 0 ) {
+		for( j = (mk_uint32_t)hash & ( mk__g_bdb.numSlots - 1 ); mk__g_bdb.slots[ j ] != 0; j = ( j + 1 ) & ( mk__g_bdb.numSlots - 1 ) ) {
+			path = &mk__g_bdb.paths[ mk__g_bdb.slots[ j ] - 1 ];
+			if( path->hash == hash && !strncmp( path->name, name, len ) && path->name[ len ] == '\0' ) {
+				return mk__g_bdb.slots[ j ] - 1;
+			}
+		}
+	}
+
+	if( !add ) {
+		return ~(mk_uint32_t)0;
+	}
+
+	i = mk__g_bdb.numPaths;
+	mk__g_bdb.paths = (MkBdbPath *)mk_bdb__reserve( (void *)mk__g_bdb.paths, &mk__g_bdb.maxPaths, i + 1, sizeof( MkBdbPath ) );
+	++mk__g_bdb.numPaths;
+
+	path = &mk__g_bdb.paths[ i ];
+	memset( (void *)path, 0, sizeof( *path ) );
+
+	path->name = mk_com_dupn( (char *)0, name, len );
+	path->hash = hash;
+
+	if( mk__g_bdb.numPaths*2 > mk__g_bdb.numSlots ) {
+		mk_bdb__rehash();
+	} else {
+		for( j = (mk_uint32_t)hash & ( mk__g_bdb.numSlots - 1 ); mk__g_bdb.slots[ j ] != 0; j = ( j + 1 ) & ( mk__g_bdb.numSlots - 1 ) ) {
+		}
+		mk__g_bdb.slots[ j ] = i + 1;
+	}
+
+	return i;
+}
+
+/* stat a path, at most once per run unless `fresh` is set */
+static int mk_bdb__stat( mk_uint32_t index, int fresh ) {
+	MkBdbPath *path;
+	MkStat_t s;
+
+	path = &mk__g_bdb.paths[ index ];
+	if( path->statState != kMkBdbStat_Unknown && !fresh ) {
+		return path->statState;
+	}
+
+	if( fresh ) {
+		mk_fs_invalidate( path->name );
+	}
+	if( !mk_fs_stat( path->name, &s ) ) {
+		memset( (void *)&path->stamp, 0, sizeof( path->stamp ) );
+		path->statState = kMkBdbStat_Missing;
+		return path->statState;
+	}
+
+	path->stamp.mtime = ( mk_uint64_t )s.st_mtime*1000000000ULL;
+#if MK_HOST_OS_LINUX
+	path->stamp.mtime += ( mk_uint64_t )s.st_mtim.tv_nsec;
+#elif MK_HOST_OS_MACOSX
+	path->stamp.mtime += ( mk_uint64_t )s.st_mtimespec.tv_nsec;
+#endif
+	path->stamp.size  = ( mk_uint64_t )s.st_size;
+	path->stamp.inode = ( mk_uint64_t )s.st_ino;
+
+	path->statState = kMkBdbStat_Exists;
+	return path->statState;
+}
+
+static int mk_bdb__stampsMatch( const MkBdbStamp *a, const MkBdbStamp *b ) {
+	return +( a->mtime == b->mtime && a->size == b->size && a->inode == b->inode );
+}
+
+/*
+================
+mk_bdb_getTime
+
+retrieve the current time in the same terms as a file's stamp (nanoseconds).
+This is the precise clock: a file saved just before it was read has an older
+stamp, even in the same second (or, with a coarse file clock, the same tick).
+================
+*/
+mk_uint64_t mk_bdb_getTime( void ) {
+#if MK_HOST_OS_LINUX || MK_HOST_OS_MACOSX
+	struct timespec ts;
+
+	if( clock_gettime( CLOCK_REALTIME, &ts ) == 0 ) {
+		return ( mk_uint64_t )ts.tv_sec*1000000000ULL + ( mk_uint64_t )ts.tv_nsec;
+	}
+#endif
+
+	return ( mk_uint64_t )time( (time_t *)0 )*1000000000ULL;
+}
+
+/* whether dependencies are compared by content (--hash-deps) */
+static int mk_bdb__byContent( void ) {
+	return +( ( mk__g_flags & kMkFlag_HashDeps_Bit ) != 0 );
+}
+
+/* find the hash of a file's contents, reading the file only if its stamp
+   changed since it was last hashed; returns 0 if it can't be read */
+static int mk_bdb__hashContent( mk_uint32_t index ) {
+	MkBdbPath *path;
+
+	path = &mk__g_bdb.paths[ index ];
+	if( mk_bdb__stat( index, 0 ) != kMkBdbStat_Exists ) {
+		return 0;
+	}
+
+	if( path->hashStamp.mtime != 0 && mk_bdb__stampsMatch( &path->hashStamp, &path->stamp ) ) {
+		return 1;
+	}
+
+	if( !mk_fs_hashFile( path->name, &path->contentHash ) ) {
+		memset( (void *)&path->hashStamp, 0, sizeof( path->hashStamp ) );
+		return 0;
+	}
+
+	path->hashStamp = path->stamp;
+	mk__g_bdb.dirty = 1;
+
+	return 1;
+}
+
+/* combine what each of a record's dependencies looks like right now, either
+   by their stamps or (if `byContent` is set) by their contents */
+static mk_uint64_t mk_bdb__hashDeps( const MkBdbRecord *rec, int byContent ) {
+	const MkBdbPath *path;
+	mk_uint64_t hash;
+	mk_uint32_t i, index;
+
+	hash = MK_HASH64_INIT;
+	for( i = 0; i < rec->numDeps; ++i ) {
+		index = mk__g_bdb.deps[ rec->firstDep + i ];
+		path  = &mk__g_bdb.paths[ index ];
+
+		(void)mk_bdb__stat( index, 0 );
+		hash = mk_com_hash64( hash, (const void *)&path->statState, sizeof( path->statState ) );
+
+		if( byContent && mk_bdb__hashContent( index ) ) {
+			hash = mk_com_hash64( hash, (const void *)&path->contentHash, sizeof( path->contentHash ) );
+		} else {
+			hash = mk_com_hash64( hash, (const void *)&path->stamp, sizeof( path->stamp ) );
+		}
+	}
+
+	return hash;
+}
+
+/*
+ *	reading the file
+ */
+
+typedef struct {
+	const unsigned char *p;
+	const unsigned char *e;
+} MkBdbReader;
+
+static int mk_bdb__read( MkBdbReader *r, void *dst, size_t n ) {
+	if( ( size_t )( r->e - r->p ) < n ) {
+		return 0;
+	}
+
+	memcpy( dst, (const void *)r->p, n );
+	r->p += n;
+
+	return 1;
+}
+static int mk_bdb__readU32( MkBdbReader *r, mk_uint32_t *dst ) {
+	return mk_bdb__read( r, (void *)dst, sizeof( *dst ) );
+}
+
+static int mk_bdb__parse( MkBdbReader *r ) {
+	MkBdbRecord *rec;
+	mk_uint32_t header[ 5 ];
+	mk_uint32_t i, len, index;
+
+	for( i = 0; i < 5; ++i ) {
+		if( !mk_bdb__readU32( r, &header[ i ] ) ) {
+			return 0;
+		}
+	}
+
+	if( header[0] != MK_BDB_MAGIC || header[1] != MK_BDB_VERSION ) {
+		return 0;
+	}
+
+	for( i = 0; i < header[2]; ++i ) {
+		if( !mk_bdb__readU32( r, &len ) || !len || ( size_t )( r->e - r->p ) < len ) {
+			return 0;
+		}
+
+		if( mk_bdb__intern( (const char *)r->p, len, 1 ) != i ) {
+			return 0; /* duplicate path */
+		}
+		r->p += len;
+
+		if( !mk_bdb__read( r, (void *)&mk__g_bdb.paths[ i ].hashStamp, sizeof( mk__g_bdb.paths[ i ].hashStamp ) ) ||
+		    !mk_bdb__read( r, (void *)&mk__g_bdb.paths[ i ].contentHash, sizeof( mk__g_bdb.paths[ i ].contentHash ) ) ||
+		    !mk_bdb__readU32( r, &mk__g_bdb.paths[ i ].duration ) ) {
+			return 0;
+		}
+	}
+
+	mk__g_bdb.records = (MkBdbRecord *)mk_bdb__reserve( (void *)mk__g_bdb.records, &mk__g_bdb.maxRecords, header[3], sizeof( MkBdbRecord ) );
+	for( i = 0; i < header[3]; ++i ) {
+		rec = &mk__g_bdb.records[ i ];
+
+		if( !mk_bdb__readU32( r, &rec->obj ) || !mk_bdb__readU32( r, &rec->numDeps ) || !mk_bdb__readU32( r, &rec->flags ) ||
+		    !mk_bdb__read( r, (void *)&rec->cmdHash, sizeof( rec->cmdHash ) ) ||
+		    !mk_bdb__read( r, (void *)&rec->depsHash, sizeof( rec->depsHash ) ) ||
+		    !mk_bdb__read( r, (void *)&rec->stamp, sizeof( rec->stamp ) ) ) {
+			return 0;
+		}
+
+		if( rec->obj >= mk__g_bdb.numPaths || mk__g_bdb.paths[ rec->obj ].record != 0 ) {
+			return 0;
+		}
+
+		rec->firstDep = mk__g_bdb.numDeps;
+		mk__g_bdb.numDeps += rec->numDeps;
+		if( mk__g_bdb.numDeps < rec->numDeps || mk__g_bdb.numDeps > header[4] ) {
+			return 0;
+		}
+
+		mk__g_bdb.paths[ rec->obj ].record = i + 1;
+		mk__g_bdb.numRecords = i + 1;
+	}
+
+	if( mk__g_bdb.numDeps != header[4] ) {
+		return 0;
+	}
+
+	mk__g_bdb.deps = (mk_uint32_t *)mk_bdb__reserve( (void *)mk__g_bdb.deps, &mk__g_bdb.maxDeps, header[4], sizeof( mk_uint32_t ) );
+	for( i = 0; i < header[4]; ++i ) {
+		if( !mk_bdb__readU32( r, &index ) || index >= mk__g_bdb.numPaths ) {
+			return 0;
+		}
+
+		mk__g_bdb.deps[ i ] = index;
+	}
+
+	return +( r->p == r->e );
+}
+
+/* load the build state for the current configuration, if there is any */
+void mk_bdb_load( void ) {
+	MkBdbReader r;
+	unsigned char *data;
+	FILE *fp;
+	long n;
+
+	if( mk__g_bdb.loaded ) {
+		return;
+	}
+
+	mk__g_bdb.loaded = 1;
+	mk__g_bdb.dirty  = 0;
+
+	if( !( fp = fopen( mk_bdb__getPath(), "rb" ) ) ) {
+		return;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
+
+	data = (unsigned char *)0;
+	if( fseek( fp, 0, SEEK_END ) == 0 && ( n = ftell( fp ) ) > 0 && fseek( fp, 0, SEEK_SET ) == 0 ) {
+		data = (unsigned char *)mk_com_memory( (void *)0, ( size_t )n );
+
+		r.p = data;
+		r.e = data + n;
+		if( fread( (void *)data, ( size_t )n, 1, fp ) != 1 || !mk_bdb__parse( &r ) ) {
+			mk_dbg_outf( "build state \"%s\" is unreadable; ignoring\n", mk_bdb__getPath() );
+
+			mk_bdb_unload();
+			mk__g_bdb.loaded = 1;
+			mk__g_bdb.dirty  = 1;
+		}
+	}
+
+	data = (unsigned char *)mk_com_memory( (void *)data, 0 );
+	fclose( fp );
+}
+
+/*
+ *	writing the file
+ */
+
+static int mk_bdb__write( FILE *fp, const void *p, size_t n ) {
+	return +( fwrite( p, n, 1, fp ) == 1 );
+}
+static int mk_bdb__writeU32( FILE *fp, mk_uint32_t x ) {
+	return mk_bdb__write( fp, (const void *)&x, sizeof( x ) );
+}
+
+/* write the build state out, if anything changed; returns 0 on failure */
+int mk_bdb_save( void ) {
+	const MkBdbRecord *rec;
+	mk_uint32_t *remap;
+	mk_uint32_t numPaths, numDeps;
+	mk_uint32_t i, j;
+	const char *path;
+	char tmp[PATH_MAX];
+	FILE *fp;
+	int ok;
+
+	if( !mk__g_bdb.loaded || !mk__g_bdb.dirty ) {
+		return 1;
+	}
+
+	/* only write the paths that are still used by a record, or that remember
+	   how long something that still exists took to make */
+	remap = (mk_uint32_t *)mk_com_memory( (void *)0, ( mk__g_bdb.numPaths + 1 )*sizeof( mk_uint32_t ) );
+	for( i = 0; i < mk__g_bdb.numPaths; ++i ) {
+		remap[ i ] = ~(mk_uint32_t)0;
+		if( mk__g_bdb.paths[ i ].duration != 0 && mk_bdb__stat( i, 0 ) == kMkBdbStat_Exists ) {
+			remap[ i ] = 0;
+		}
+	}
+
+	numDeps = 0;
+	for( i = 0; i < mk__g_bdb.numRecords; ++i ) {
+		rec = &mk__g_bdb.records[ i ];
+
+		remap[ rec->obj ] = 0;
+		for( j = 0; j < rec->numDeps; ++j ) {
+			remap[ mk__g_bdb.deps[ rec->firstDep + j ] ] = 0;
+		}
+
+		numDeps += rec->numDeps;
+	}
+
+	numPaths = 0;
+	for( i = 0; i < mk__g_bdb.numPaths; ++i ) {
+		if( remap[ i ] == 0 ) {
+			remap[ i ] = numPaths++;
+		}
+	}
+
+	path = mk_bdb__getPath();
+	mk_com_strcpy( tmp, sizeof( tmp ), path );
+	mk_com_strcat( tmp, sizeof( tmp ), ".tmp" );
+
+	if( !( fp = fopen( tmp, "wb" ) ) ) {
+		mk_fs_makeDirs( mk_com_va( "%s/%s", mk_opt_getObjdirBase(), mk_opt_getConfigName() ) );
+		fp = fopen( tmp, "wb" );
+	}
+	if( !fp ) {
+		remap = (mk_uint32_t *)mk_com_memory( (void *)remap, 0 );
+		return 0;
+	}
+	mk_stats_count( kMkStats_FilesOpened, 1 );
+
+	ok = mk_bdb__writeU32( fp, MK_BDB_MAGIC ) && mk_bdb__writeU32( fp, MK_BDB_VERSION ) &&
+	     mk_bdb__writeU32( fp, numPaths ) && mk_bdb__writeU32( fp, mk__g_bdb.numRecords ) &&
+	     mk_bdb__writeU32( fp, numDeps );
+
+	for( i = 0; ok && i < mk__g_bdb.numPaths; ++i ) {
+		if( remap[ i ] == ~(mk_uint32_t)0 ) {
+			continue;
+		}
+
+		j  = (mk_uint32_t)mk_com_strlen( mk__g_bdb.paths[ i ].name );
+		ok = mk_bdb__writeU32( fp, j ) && mk_bdb__write( fp, (const void *)mk__g_bdb.paths[ i ].name, j ) &&
+		     mk_bdb__write( fp, (const void *)&mk__g_bdb.paths[ i ].hashStamp, sizeof( mk__g_bdb.paths[ i ].hashStamp ) ) &&
+		     mk_bdb__write( fp, (const void *)&mk__g_bdb.paths[ i ].contentHash, sizeof( mk__g_bdb.paths[ i ].contentHash ) ) &&
+		     mk_bdb__writeU32( fp, mk__g_bdb.paths[ i ].duration );
+	}
+
+	for( i = 0; ok && i < mk__g_bdb.numRecords; ++i ) {
+		rec = &mk__g_bdb.records[ i ];
+
+		ok = mk_bdb__writeU32( fp, remap[ rec->obj ] ) && mk_bdb__writeU32( fp, rec->numDeps ) && mk_bdb__writeU32( fp, rec->flags ) &&
+		     mk_bdb__write( fp, (const void *)&rec->cmdHash, sizeof( rec->cmdHash ) ) &&
+		     mk_bdb__write( fp, (const void *)&rec->depsHash, sizeof( rec->depsHash ) ) &&
+		     mk_bdb__write( fp, (const void *)&rec->stamp, sizeof( rec->stamp ) );
+	}
+
+	for( i = 0; ok && i < mk__g_bdb.numRecords; ++i ) {
+		rec = &mk__g_bdb.records[ i ];
+
+		for( j = 0; ok && j < rec->numDeps; ++j ) {
+			ok = mk_bdb__writeU32( fp, remap[ mk__g_bdb.deps[ rec->firstDep + j ] ] );
+		}
+	}
+
+	remap = (mk_uint32_t *)mk_com_memory( (void *)remap, 0 );
+
+	if( fclose( fp ) != 0 ) {
+		ok = 0;
+	}
+
+#if MK_WINDOWS_ENABLED
+	if( ok ) {
+		remove( path );
+	}
+#endif
+	if( !ok || rename( tmp, path ) != 0 ) {
+		remove( tmp );
+		return 0;
+	}
+
+	mk__g_bdb.dirty = 0;
+	return 1;
+}
+
+/* release everything held in memory (does not save) */
+void mk_bdb_unload( void ) {
+	mk_uint32_t i;
+
+	for( i = 0; i < mk__g_bdb.numPaths; ++i ) {
+		mk__g_bdb.paths[ i ].name = (char *)mk_com_memory( (void *)mk__g_bdb.paths[ i ].name, 0 );
+	}
+
+	mk__g_bdb.paths   = (MkBdbPath *)mk_com_memory( (void *)mk__g_bdb.paths, 0 );
+	mk__g_bdb.slots   = (mk_uint32_t *)mk_com_memory( (void *)mk__g_bdb.slots, 0 );
+	mk__g_bdb.records = (MkBdbRecord *)mk_com_memory( (void *)mk__g_bdb.records, 0 );
+	mk__g_bdb.deps    = (mk_uint32_t *)mk_com_memory( (void *)mk__g_bdb.deps, 0 );
+
+	memset( (void *)&mk__g_bdb, 0, sizeof( mk__g_bdb ) );
+}
+
+/*
+ *	queries
+ */
+
+static MkBdbRecord *mk_bdb__findRecord( const char *obj ) {
+	mk_uint32_t index;
+
+	mk_bdb_load();
+
+	index = mk_bdb__intern( obj, mk_com_strlen( obj ), 0 );
+	if( index == ~(mk_uint32_t)0 || !mk__g_bdb.paths[ index ].record ) {
+		return (MkBdbRecord *)0;
+	}
+
+	return &mk__g_bdb.records[ mk__g_bdb.paths[ index ].record - 1 ];
+}
+
+/* determine whether an object (along with its dependency file) is up to date,
+   and was built by the command hashing to `cmdHash` */
+MkBdbStatus_t mk_bdb_checkObject( const char *obj, const char *dep, mk_uint64_t cmdHash ) {
+	MkBdbRecord *rec;
+	mk_uint32_t index;
+	int byContent;
+
+	MK_ASSERT( obj != (const char *)0 );
+	MK_ASSERT( dep != (const char *)0 );
+
+	/* with no record, whatever compiled it may have had other flags */
+	if( !( rec = mk_bdb__findRecord( obj ) ) ) {
+		mk_dbg_outf( "\"%s\": no record of how it was compiled\n", obj );
+		return kMkBdb_OutOfDate;
+	}
+
+	/* different flags, defines, compiler, configuration, ... */
+	if( rec->cmdHash != cmdHash ) {
+		mk_dbg_outf( "\"%s\": compile command changed\n", obj );
+		return kMkBdb_OutOfDate;
+	}
+
+	if( mk_bdb__stat( rec->obj, 0 ) != kMkBdbStat_Exists ) {
+		return kMkBdb_OutOfDate;
+	}
+	if( !mk_bdb__stampsMatch( &mk__g_bdb.paths[ rec->obj ].stamp, &rec->stamp ) ) {
+		return kMkBdb_Unknown; /* changed behind our back */
+	}
+
+	index = mk_bdb__intern( dep, mk_com_strlen( dep ), 1 );
+	if( mk_bdb__stat( index, 0 ) != kMkBdbStat_Exists ) {
+		return kMkBdb_OutOfDate;
+	}
+
+	if( mk_bdb__hashDeps( rec, ( rec->flags & kMkBdbRec_ByContent_Bit ) != 0 ) != rec->depsHash ) {
+		return kMkBdb_OutOfDate;
+	}
+
+	/* switching --hash-deps on or off needn't rebuild what's up to date */
+	byContent = mk_bdb__byContent();
+	if( byContent != ( ( rec->flags & kMkBdbRec_ByContent_Bit ) != 0 ) ) {
+		rec->flags   ^= kMkBdbRec_ByContent_Bit;
+		rec->depsHash = mk_bdb__hashDeps( rec, byContent );
+
+		mk__g_bdb.dirty = 1;
+	}
+
+	return kMkBdb_UpToDate;
+}
+
+/* remember the state of an object that was just built (or checked); if it was
+   built, `started` is mk_bdb_getTime() from when that began, otherwise 0 */
+void mk_bdb_setObject( const char *obj, mk_uint64_t cmdHash, MkDep deps, mk_uint64_t started ) {
+	MkBdbRecord *rec;
+	mk_uint32_t index, dep;
+	size_t i, n;
+	int stale;
+
+	MK_ASSERT( obj != (const char *)0 );
+	MK_ASSERT( deps != (MkDep)0 );
+
+	mk_bdb_load();
+
+	index = mk_bdb__intern( obj, mk_com_strlen( obj ), 1 );
+	if( mk_bdb__stat( index, 1 ) != kMkBdbStat_Exists ) {
+		mk_bdb_removeObject( obj );
+		return;
+	}
+
+	if( !mk__g_bdb.paths[ index ].record ) {
+		mk__g_bdb.records = (MkBdbRecord *)mk_bdb__reserve( (void *)mk__g_bdb.records, &mk__g_bdb.maxRecords, mk__g_bdb.numRecords + 1, sizeof( MkBdbRecord ) );
+		mk__g_bdb.paths[ index ].record = ++mk__g_bdb.numRecords;
+	}
+
+	/* old dependency lists are left behind until the next save */
+	n = mk_dep_getSize( deps );
+	mk__g_bdb.deps = (mk_uint32_t *)mk_bdb__reserve( (void *)mk__g_bdb.deps, &mk__g_bdb.maxDeps, mk__g_bdb.numDeps + (mk_uint32_t)n, sizeof( mk_uint32_t ) );
+
+	rec = &mk__g_bdb.records[ mk__g_bdb.paths[ index ].record - 1 ];
+	rec->obj      = index;
+	rec->firstDep = mk__g_bdb.numDeps;
+	rec->numDeps  = (mk_uint32_t)n;
+	rec->flags    = mk_bdb__byContent() ? kMkBdbRec_ByContent_Bit : 0;
+	rec->cmdHash  = cmdHash;
+	rec->stamp    = mk__g_bdb.paths[ index ].stamp;
+
+	stale = 0;
+	for( i = 0; i < n; ++i ) {
+		dep = mk_bdb__intern( mk_dep_at( deps, i ), mk_com_strlen( mk_dep_at( deps, i ) ), 1 );
+		mk__g_bdb.deps[ mk__g_bdb.numDeps++ ] = dep;
+
+		/* modified since the compile began, so maybe not what was compiled */
+		if( started != 0 && mk_bdb__stat( dep, 1 ) == kMkBdbStat_Exists && mk__g_bdb.paths[ dep ].stamp.mtime >= started ) {
+			mk_dbg_outf( "\"%s\" changed while \"%s\" was compiled\n", mk_dep_at( deps, i ), obj );
+			stale = 1;
+		}
+	}
+
+	/* a stale record's stamps must never vouch for the object */
+	rec->depsHash = mk_bdb__hashDeps( rec, ( rec->flags & kMkBdbRec_ByContent_Bit ) != 0 );
+	if( stale ) {
+		rec->depsHash = ~rec->depsHash;
+	}
+
+	mk__g_bdb.dirty = 1;
+}
+
+/* determine whether a file is still exactly what the command hashing to
+   `cmdHash` made when it was recorded with mk_bdb_setObject() (whether or not
+   its dependencies have changed since) */
+MkBdbStatus_t mk_bdb_checkOutput( const char *file, mk_uint64_t cmdHash ) {
+	const MkBdbRecord *rec;
+
+	MK_ASSERT( file != (const char *)0 );
+
+	if( !( rec = mk_bdb__findRecord( file ) ) ) {
+		return kMkBdb_Unknown;
+	}
+
+	if( rec->cmdHash != cmdHash || mk_bdb__stat( rec->obj, 1 ) != kMkBdbStat_Exists ) {
+		return kMkBdb_OutOfDate;
+	}
+	if( !mk_bdb__stampsMatch( &mk__g_bdb.paths[ rec->obj ].stamp, &rec->stamp ) ) {
+		return kMkBdb_OutOfDate;
+	}
+
+	return kMkBdb_UpToDate;
+}
+
+/* forget about an object */
+void mk_bdb_removeObject( const char *obj ) {
+	MkBdbRecord *rec;
+	mk_uint32_t index;
+
+	if( !( rec = mk_bdb__findRecord( obj ) ) ) {
+		return;
+	}
+
+	index = rec->obj;
+
+	/* move the last record into the removed one's place */
+	*rec = mk__g_bdb.records[ --mk__g_bdb.numRecords ];
+	mk__g_bdb.paths[ rec->obj ].record = mk__g_bdb.paths[ index ].record;
+	mk__g_bdb.paths[ index ].record    = 0;
+
+	mk__g_bdb.dirty = 1;
+}
+
+/* retrieve how many milliseconds a file took to make the last time it was
+   made, or 0 if that isn't known */
+mk_uint32_t mk_bdb_getDuration( const char *file ) {
+	mk_uint32_t index;
+
+	MK_ASSERT( file != (const char *)0 );
+
+	mk_bdb_load();
+
+	index = mk_bdb__intern( file, mk_com_strlen( file ), 0 );
+	if( index == ~(mk_uint32_t)0 ) {
+		return 0;
+	}
+
+	return mk__g_bdb.paths[ index ].duration;
+}
+/* remember how many milliseconds a file took to make */
+void mk_bdb_setDuration( const char *file, mk_uint32_t ms ) {
+	mk_uint32_t index;
+
+	MK_ASSERT( file != (const char *)0 );
+
+	mk_bdb_load();
+
+	index = mk_bdb__intern( file, mk_com_strlen( file ), 1 );
+	if( ms < 1 ) {
+		ms = 1;
+	}
+
+	if( mk__g_bdb.paths[ index ].duration != ms ) {
+		mk__g_bdb.paths[ index ].duration = ms;
+		mk__g_bdb.dirty = 1;
+	}
+}
+
+/* determine whether a unit test is up to date, as with mk_bdb_checkObject();
+   if it is, `*passed` is set to whether it passed when last run */
+MkBdbStatus_t mk_bdb_checkTest( const char *test, const char *dep, mk_uint64_t cmdHash, int *passed ) {
+	MkBdbStatus_t status;
+
+	MK_ASSERT( passed != (int *)0 );
+
+	if( ( status = mk_bdb_checkObject( test, dep, cmdHash ) ) == kMkBdb_UpToDate ) {
+		*passed = +( ( mk_bdb__findRecord( test )->flags & kMkBdbRec_TestFailed_Bit ) == 0 );
+	}
+
+	return status;
+}
+/* remember the state of a unit test that was just run, and how it went */
+void mk_bdb_setTest( const char *test, mk_uint64_t cmdHash, MkDep deps, int passed ) {
+	MkBdbRecord *rec;
+
+	mk_bdb_setObject( test, cmdHash, deps, 0 );
+	if( !passed && ( rec = mk_bdb__findRecord( test ) ) != (MkBdbRecord *)0 ) {
+		rec->flags |= kMkBdbRec_TestFailed_Bit;
+	}
+}
+
+/* have the next checks look at every file again (through the stat cache, so
+   only files invalidated since are actually stat()ed); for running another
+   build in the same process */
+void mk_bdb_forgetStats( void ) {
+	mk_uint32_t i;
+
+	for( i = 0; i < mk__g_bdb.numPaths; ++i ) {
+		mk__g_bdb.paths[ i ].statState = kMkBdbStat_Unknown;
+	}
+}
+
+/* create the dependency list of an object from its record, if that's still
+   accurate -- which spares reading the object's dependency file */
+MkDep mk_bdb_loadDeps( const char *obj ) {
+	const MkBdbRecord *rec;
+	MkDep dep;
+	mk_uint32_t i;
+
+	MK_ASSERT( obj != (const char *)0 );
+
+	if( !( rec = mk_bdb__findRecord( obj ) ) ) {
+		return (MkDep)0;
+	}
+
+	/* the object may have been rebuilt during this run */
+	if( mk_bdb__stat( rec->obj, 1 ) != kMkBdbStat_Exists || !mk_bdb__stampsMatch( &mk__g_bdb.paths[ rec->obj ].stamp, &rec->stamp ) ) {
+		return (MkDep)0;
+	}
+
+	dep = mk_dep_new( obj );
+	for( i = 0; i < rec->numDeps; ++i ) {
+		mk_dep_push( dep, mk__g_bdb.paths[ mk__g_bdb.deps[ rec->firstDep + i ] ].name );
+	}
+
+	return dep;
+}
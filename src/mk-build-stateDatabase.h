@@ -0,0 +1,81 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+ *	========================================================================
+ *	BUILD STATE DATABASE
+ *	========================================================================
+ *	Remembers, per object file, the hash of the command that compiled it,
+ *	the files it depends on, and what the object and those files looked
+ *	like (mtime/size/inode) when it was last built. This is kept in a
+ *	compact binary file within the object directory, so checking whether
+ *	an object is up to date takes neither a read of its dependency (.d)
+ *	file nor more than one stat() per unique file for the whole run.
+ *
+ *	An object whose compile command (compiler and flags) differs from the
+ *	one it was built with is out of date, so changing the configuration,
+ *	defines, or include directories rebuilds just what they affect. An
+ *	object without a record at all is out of date too, as nothing says what
+ *	compiled it; only one changed behind mk's back falls back to comparing
+ *	mtimes.
+ *
+ *	A dependency modified after its object's compile began may or may not be
+ *	what was compiled, so such an object is recorded as out of date.
+ *
+ *	How long each object and project output took to make is remembered too,
+ *	so the next build can start the longest jobs first.
+ *
+ *	Unit tests are recorded like objects, with the binary they link against
+ *	among their dependencies, along with whether they passed; a test whose
+ *	record is up to date needn't be built or run again.
+ *
+ *	With --hash-deps, dependencies are compared by a hash of their contents
+ *	instead, so a file that was touched but not changed doesn't force a
+ *	rebuild. A file is only read to be hashed again once its stamp changes.
+ *
+ *	Nothing here is thread-safe (but for mk_bdb_getTime()); use from the
+ *	main thread or with the engine's build lock held.
+ */
+
+#include "mk-basic-async.h"
+#include "mk-basic-common.h"
+#include "mk-build-dependency.h"
+
+typedef enum {
+	/* the object changed since it was recorded (but by the same command);
+	   fall back to reading the dependency file */
+	kMkBdb_Unknown    = -1,
+	kMkBdb_OutOfDate  = 0,
+	kMkBdb_UpToDate   = 1
+} MkBdbStatus_t;
+
+void mk_bdb_load( void );
+int  mk_bdb_save( void );
+void mk_bdb_unload( void );
+
+MkBdbStatus_t mk_bdb_checkObject( const char *obj, const char *dep, mk_uint64_t cmdHash );
+void          mk_bdb_setObject( const char *obj, mk_uint64_t cmdHash, MkDep deps, mk_uint64_t started );
+void          mk_bdb_removeObject( const char *obj );
+MkBdbStatus_t mk_bdb_checkOutput( const char *file, mk_uint64_t cmdHash );
+MkDep         mk_bdb_loadDeps( const char *obj );
+void          mk_bdb_forgetStats( void );
+
+MkBdbStatus_t mk_bdb_checkTest( const char *test, const char *dep, mk_uint64_t cmdHash, int *passed );
+void          mk_bdb_setTest( const char *test, mk_uint64_t cmdHash, MkDep deps, int passed );
+
+mk_uint64_t mk_bdb_getTime( void );
+mk_uint32_t mk_bdb_getDuration( const char *file );
+void        mk_bdb_setDuration( const char *file, mk_uint32_t ms );
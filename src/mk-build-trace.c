@@ -0,0 +1,266 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "mk-build-trace.h"
+
+#include "mk-basic-assert.h"
+#include "mk-basic-common.h"
+#include "mk-basic-logging.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct MkTraceEvent_s {
+	mk_uint64_t   start;
+	mk_uint64_t   end;
+	size_t        name;   /* offset into the buffer's names */
+	const char *  result; /* static string */
+	int           status;
+	MkTraceKind_t kind;
+} MkTraceEvent;
+
+struct MkTraceBuf_s {
+	unsigned int tid;
+
+	MkTraceEvent *events;
+	size_t        numEvents;
+	size_t        maxEvents;
+
+	char * names;
+	size_t namesLen;
+	size_t namesMax;
+};
+
+static const char *const mk_trace__g_kindNames[ kMkTrace_NumKinds ] = {
+	"discover",
+	"depscan",
+	"compile",
+	"archive",
+	"link",
+	"test",
+	"bench"
+};
+
+static char *       mk_trace__g_filename = (char *)0;
+static mk_uint64_t  mk_trace__g_epoch    = 0;
+static MkTraceBuf * mk_trace__g_bufs     = (MkTraceBuf *)0;
+static unsigned int mk_trace__g_numBufs  = 0;
+
+/* start recording; the trace is written to `filename` by mk_trace_write() */
+void mk_trace_start( const char *filename ) {
+	MK_ASSERT( filename != (const char *)0 );
+
+	mk_trace__g_filename = mk_com_dup( mk_trace__g_filename, filename );
+	mk_trace__g_epoch    = mk_com_getTimeNs();
+}
+int mk_trace_isEnabled( void ) {
+	return +( mk_trace__g_filename != (char *)0 );
+}
+
+/*
+================
+mk_trace_getBuffer
+
+retrieve the buffer thread `tid` records into (0 being the main thread), or
+null if nothing is being traced. Must be called from the main thread.
+================
+*/
+MkTraceBuf mk_trace_getBuffer( unsigned int tid ) {
+	MkTraceBuf buf;
+	unsigned int i;
+
+	if( !mk_trace__g_filename ) {
+		return (MkTraceBuf)0;
+	}
+
+	if( tid >= mk_trace__g_numBufs ) {
+		mk_trace__g_bufs = (MkTraceBuf *)mk_com_memory( (void *)mk_trace__g_bufs, sizeof( *mk_trace__g_bufs )*( tid + 1 ) );
+		for( i = mk_trace__g_numBufs; i <= tid; ++i ) {
+			mk_trace__g_bufs[ i ] = (MkTraceBuf)0;
+		}
+		mk_trace__g_numBufs = tid + 1;
+	}
+
+	if( !( buf = mk_trace__g_bufs[ tid ] ) ) {
+		buf = (MkTraceBuf)mk_com_memory( (void *)0, sizeof( *buf ) );
+		memset( (void *)buf, 0, sizeof( *buf ) );
+
+		buf->tid = tid;
+		mk_trace__g_bufs[ tid ] = buf;
+	}
+
+	return buf;
+}
+
+/*
+================
+mk_trace_add
+
+record a job that ran from `start` to `end` (as per mk_com_getTimeNs()) in
+the buffer of the calling thread. `status` is the exit status of the program
+the job ran, if any, and `result` briefly says how the job went.
+================
+*/
+void mk_trace_add( MkTraceBuf buf, MkTraceKind_t kind, const char *name, mk_uint64_t start, mk_uint64_t end, int status, const char *result ) {
+	MkTraceEvent *ev;
+	size_t n;
+
+	if( !buf ) {
+		return;
+	}
+
+	MK_ASSERT( (unsigned int)kind < kMkTrace_NumKinds );
+	MK_ASSERT( name != (const char *)0 );
+
+	if( buf->numEvents == buf->maxEvents ) {
+		buf->maxEvents = buf->maxEvents ? buf->maxEvents*2 : 256;
+		buf->events = (MkTraceEvent *)mk_com_memory( (void *)buf->events, sizeof( *buf->events )*buf->maxEvents );
+	}
+
+	n = strlen( name ) + 1;
+	if( buf->namesLen + n > buf->namesMax ) {
+		while( buf->namesLen + n > buf->namesMax ) {
+			buf->namesMax = buf->namesMax ? buf->namesMax*2 : 16384;
+		}
+		buf->names = (char *)mk_com_memory( (void *)buf->names, buf->namesMax );
+	}
+
+	ev = &buf->events[ buf->numEvents++ ];
+	ev->start  = start;
+	ev->end    = end > start ? end : start;
+	ev->name   = buf->namesLen;
+	ev->result = result;
+	ev->status = status;
+	ev->kind   = kind;
+
+	memcpy( (void *)&buf->names[ buf->namesLen ], (const void *)name, n );
+	buf->namesLen += n;
+}
+
+static void mk_trace__writeStr( FILE *fp, const char *s ) {
+	fputc( '\"', fp );
+	for(; *s != '\0'; ++s ) {
+		if( *s == '\"' || *s == '\\' ) {
+			fputc( '\\', fp );
+			fputc( *s, fp );
+		} else if( (unsigned char)*s < 0x20 ) {
+			fprintf( fp, "\\u%.4x", (unsigned int)(unsigned char)*s );
+		} else {
+			fputc( *s, fp );
+		}
+	}
+	fputc( '\"', fp );
+}
+/* write a time in microseconds since the trace started */
+static void mk_trace__writeTime( FILE *fp, mk_uint64_t ns ) {
+	fprintf( fp, "%llu.%.3u", (unsigned long long)( ns/1000 ), (unsigned int)( ns%1000 ) );
+}
+
+/*
+================
+mk_trace_write
+
+write everything recorded so far to the trace file, then forget it (so that
+each build of `mk --watch` leaves just its own trace behind). Returns 0 if the
+file couldn't be written. Must not be called while worker threads are running.
+================
+*/
+int mk_trace_write( void ) {
+	const MkTraceEvent *ev;
+	MkTraceBuf buf;
+	unsigned int i;
+	size_t j;
+	FILE *fp;
+	int first;
+	int r;
+
+	if( !mk_trace__g_filename ) {
+		return 1;
+	}
+
+	if( !( fp = fopen( mk_trace__g_filename, "w" ) ) ) {
+		mk_log_error( mk_trace__g_filename, 0, (const char *)0, "failed to write the trace" );
+		return 0;
+	}
+
+	fputs( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fp );
+	fputs( "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"mk\"}}", fp );
+
+	for( i = 0; i < mk_trace__g_numBufs; ++i ) {
+		if( !( buf = mk_trace__g_bufs[ i ] ) ) {
+			continue;
+		}
+
+		fprintf( fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", buf->tid );
+		mk_trace__writeStr( fp, buf->tid == 0 ? "main" : mk_com_va( "worker %u", buf->tid ) );
+		fprintf( fp, "}}" );
+
+		for( j = 0; j < buf->numEvents; ++j ) {
+			ev = &buf->events[ j ];
+
+			fputs( ",\n{\"name\":", fp );
+			mk_trace__writeStr( fp, &buf->names[ ev->name ] );
+			fprintf( fp, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":", mk_trace__g_kindNames[ ev->kind ], buf->tid );
+			mk_trace__writeTime( fp, ev->start - mk_trace__g_epoch );
+			fputs( ",\"dur\":", fp );
+			mk_trace__writeTime( fp, ev->end - ev->start );
+			fputs( ",\"args\":{", fp );
+
+			first = 1;
+			if( ev->status != kMkTrace_NoStatus ) {
+				fprintf( fp, "\"status\":%i", ev->status );
+				first = 0;
+			}
+			if( ev->result != (const char *)0 ) {
+				fprintf( fp, "%s\"result\":", first ? "" : "," );
+				mk_trace__writeStr( fp, ev->result );
+			}
+			fputs( "}}", fp );
+		}
+
+		buf->numEvents = 0;
+		buf->namesLen  = 0;
+	}
+
+	fputs( "\n]}\n", fp );
+
+	r = +( ferror( fp ) == 0 );
+	if( fclose( fp ) != 0 ) {
+		r = 0;
+	}
+	if( !r ) {
+		mk_log_error( mk_trace__g_filename, 0, (const char *)0, "failed to write the trace" );
+	}
+
+	return r;
+}
+
+/* stop recording and free every buffer */
+void mk_trace_fini( void ) {
+	unsigned int i;
+
+	for( i = 0; i < mk_trace__g_numBufs; ++i ) {
+		if( !mk_trace__g_bufs[ i ] ) {
+			continue;
+		}
+
+		mk_com_memory( (void *)mk_trace__g_bufs[ i ]->events, 0 );
+		mk_com_memory( (void *)mk_trace__g_bufs[ i ]->names, 0 );
+		mk_com_memory( (void *)mk_trace__g_bufs[ i ], 0 );
+	}
+
+	mk_trace__g_bufs     = (MkTraceBuf *)mk_com_memory( (void *)mk_trace__g_bufs, 0 );
+	mk_trace__g_numBufs  = 0;
+	mk_trace__g_filename = (char *)mk_com_memory( (void *)mk_trace__g_filename, 0 );
+}
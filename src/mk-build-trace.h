@@ -0,0 +1,61 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+ *	========================================================================
+ *	BUILD TRACE
+ *	========================================================================
+ *	`mk --trace=<file>` records when every job of the build began and ended,
+ *	which thread ran it, what kind of job it was, and how it went, then
+ *	writes all of it as Chrome trace-event JSON (load it into about:tracing,
+ *	ui.perfetto.dev, or speedscope) once the build is over. Gaps on a worker
+ *	thread's track are time it sat idle.
+ *
+ *	Every thread records into a buffer of its own, so recording an event
+ *	takes no lock. Buffers are handed out by the main thread before the
+ *	threads that use them start (see mk_bldctx_run()), and the trace is only
+ *	written after they've been joined.
+ */
+
+#include "mk-basic-common.h"
+
+typedef enum {
+	kMkTrace_Discover,
+	kMkTrace_DepScan,
+	kMkTrace_Compile,
+	kMkTrace_Archive,
+	kMkTrace_Link,
+	kMkTrace_Test,
+	kMkTrace_Bench,
+
+	kMkTrace_NumKinds
+} MkTraceKind_t;
+
+enum {
+	/* exit status of a job that didn't run a program */
+	kMkTrace_NoStatus = -256
+};
+
+typedef struct MkTraceBuf_s *MkTraceBuf;
+
+void mk_trace_start( const char *filename );
+int  mk_trace_isEnabled( void );
+
+MkTraceBuf mk_trace_getBuffer( unsigned int tid );
+void       mk_trace_add( MkTraceBuf buf, MkTraceKind_t kind, const char *name, mk_uint64_t start, mk_uint64_t end, int status, const char *result );
+
+int  mk_trace_write( void );
+void mk_trace_fini( void );
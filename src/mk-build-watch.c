@@ -0,0 +1,406 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "mk-build-watch.h"
+
+#include "mk-basic-assert.h"
+#include "mk-basic-common.h"
+#include "mk-basic-debug.h"
+#include "mk-basic-fileSystem.h"
+#include "mk-basic-logging.h"
+#include "mk-basic-stringList.h"
+#include "mk-build-engine.h"
+#include "mk-build-project.h"
+#include "mk-build-projectFS.h"
+#include "mk-defs-config.h"
+#include "mk-defs-platform.h"
+#include "mk-frontend.h"
+#include "mk-system-output.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if MK_HOST_OS_LINUX
+#	include <poll.h>
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
+/* the command line as given; option parsing consumes the original */
+static char **mk__g_watch_argv = (char **)0;
+
+/* remember the command line, for restarting */
+void mk_watch_saveArgs( int argc, char **argv ) {
+	int i;
+
+	MK_ASSERT( argc > 0 );
+	MK_ASSERT( argv != (char **)0 );
+
+	mk__g_watch_argv = (char **)mk_com_memory( (void *)mk__g_watch_argv, sizeof( char * )*( (size_t)argc + 1 ) );
+	for( i = 0; i < argc; ++i ) {
+		mk__g_watch_argv[ i ] = argv[ i ];
+	}
+	mk__g_watch_argv[ argc ] = (char *)0;
+}
+
+#if MK_HOST_OS_LINUX
+
+/* a rename shows up as a deletion and a creation */
+# define MK_WATCH__STRUCTURE_MASK ( IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO )
+# define MK_WATCH__MASK           ( MK_WATCH__STRUCTURE_MASK | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR )
+
+typedef struct MkWatchDir_s {
+	int   wd;
+	char *path; /* as listed; no trailing '/' */
+} MkWatchDir;
+
+static struct {
+	int         fd;
+
+	/* sorted by watch descriptor (which inotify hands out in order) */
+	MkWatchDir *dirs;
+	size_t      numDirs;
+	size_t      maxDirs;
+
+	int         warnedLimit;
+} mk__g_watch = { -1, (MkWatchDir *)0, 0, 0, 0 };
+
+static MkWatchDir *mk_watch__find( int wd ) {
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = mk__g_watch.numDirs;
+	while( lo < hi ) {
+		mid = lo + ( hi - lo )/2;
+		if( mk__g_watch.dirs[ mid ].wd == wd ) {
+			return &mk__g_watch.dirs[ mid ];
+		}
+
+		if( wd < mk__g_watch.dirs[ mid ].wd ) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return (MkWatchDir *)0;
+}
+
+/* watch a directory and, if `recurse` is set, everything below it except
+   hidden directories (and the output directories, if `path` is the current
+   directory) */
+static void mk_watch__addTree( const char *path, int recurse ) {
+	const MkFsDirList *list;
+	MkWatchDir *dir;
+	size_t i, n;
+	int isCWD;
+	int wd;
+	char sub[PATH_MAX], real[PATH_MAX], cwd[PATH_MAX];
+
+	if( !( list = mk_fs_listDir( path ) ) ) {
+		errno = 0;
+		return;
+	}
+
+	if( ( wd = inotify_add_watch( mk__g_watch.fd, path, MK_WATCH__MASK ) ) < 0 ) {
+		if( errno == ENOSPC && !mk__g_watch.warnedLimit ) {
+			mk__g_watch.warnedLimit = 1;
+			mk_log_errorMsg( "out of inotify watches; changes in some directories will be missed "
+			    "(see /proc/sys/fs/inotify/max_user_watches)" );
+		}
+		errno = 0;
+		return;
+	}
+
+	/* already watched; e.g., an include directory within a source directory */
+	if( mk_watch__find( wd ) != (MkWatchDir *)0 ) {
+		return;
+	}
+
+	if( mk__g_watch.numDirs == mk__g_watch.maxDirs ) {
+		mk__g_watch.maxDirs = mk__g_watch.maxDirs ? mk__g_watch.maxDirs*2 : 64;
+		mk__g_watch.dirs    = (MkWatchDir *)mk_com_memory( (void *)mk__g_watch.dirs, sizeof( MkWatchDir )*mk__g_watch.maxDirs );
+	}
+
+	MK_ASSERT( !mk__g_watch.numDirs || mk__g_watch.dirs[ mk__g_watch.numDirs - 1 ].wd < wd );
+
+	dir = &mk__g_watch.dirs[ mk__g_watch.numDirs++ ];
+	dir->wd   = wd;
+	dir->path = mk_com_dup( (char *)0, path );
+
+	n = mk_com_strlen( dir->path );
+	while( n > 1 && dir->path[n - 1] == '/' ) {
+		dir->path[--n] = '\0';
+	}
+
+	if( !recurse ) {
+		return;
+	}
+
+	isCWD = 0;
+	if( mk_fs_realPath( path, real, sizeof( real ) ) && mk_fs_realPath( "./", cwd, sizeof( cwd ) ) ) {
+		isCWD = +( strcmp( real, cwd ) == 0 );
+	}
+	errno = 0;
+
+	for( i = 0; i < list->numEntries; ++i ) {
+		if( list->entries[ i ].type != kMkFsEntry_Dir || list->entries[ i ].name[0] == '.' ) {
+			continue;
+		}
+
+		if( isCWD && ( !strcmp( list->entries[ i ].name, "bin" ) || !strcmp( list->entries[ i ].name, "lib" ) ) ) {
+			continue;
+		}
+
+		mk_com_strcpy( sub, sizeof( sub ), mk__g_watch.dirs[ mk__g_watch.numDirs - 1 ].path );
+		mk_com_strcat( sub, sizeof( sub ), "/" );
+		mk_com_strcat( sub, sizeof( sub ), list->entries[ i ].name );
+
+		mk_watch__addTree( sub, 1 );
+	}
+}
+
+/* watch every directory the projects were found in */
+static void mk_watch__addAll( void ) {
+	MkStrList roots[ 5 ];
+	MkProject proj;
+	size_t i, j, n;
+
+	roots[ 0 ] = mk__g_srcdirs;
+	roots[ 1 ] = mk__g_incdirs;
+	roots[ 2 ] = mk__g_pkgdirs;
+	roots[ 3 ] = mk__g_tooldirs;
+	roots[ 4 ] = mk__g_dllsdirs;
+
+	for( i = 0; i < sizeof( roots ) / sizeof( roots[0] ); ++i ) {
+		n = mk_sl_getSize( roots[ i ] );
+		for( j = 0; j < n; ++j ) {
+			mk_watch__addTree( mk_sl_at( roots[ i ], j ), 1 );
+		}
+	}
+
+	/* projects listed by a workspace file, or the current directory if no
+	   project was found in the source directories */
+	for( proj = mk_prj_rootHead(); proj; proj = mk_prj_next( proj ) ) {
+		mk_watch__addTree( mk_prj_getPath( proj ), 1 );
+	}
+
+	/* the workspace and autolink files */
+	mk_watch__addTree( ".", 0 );
+}
+
+/* start over with the original command line, to find the projects anew */
+static MK_NORETURN void mk_watch__restart( const char *reason ) {
+	mk_sys_printf( kMkSIO_Err, "%s; restarting\n", reason );
+	fflush( stdout );
+	fflush( stderr );
+
+	/* the command line may use relative paths */
+	mk_fs_unwindDirs();
+
+	execv( "/proc/self/exe", mk__g_watch_argv );
+	execvp( mk__g_watch_argv[0], mk__g_watch_argv );
+
+	mk_log_fatalError( mk_com_va( "failed to restart ^F'%s'^&", mk__g_watch_argv[0] ) );
+}
+
+/* add a directory to the list of those whose entries changed */
+static void mk_watch__noteDir( MkStrList dirs, const char *path ) {
+	size_t i, n;
+
+	n = mk_sl_getSize( dirs );
+	for( i = 0; i < n; ++i ) {
+		if( !strcmp( mk_sl_at( dirs, i ), path ) ) {
+			return;
+		}
+	}
+
+	mk_sl_pushBack( dirs, path );
+}
+
+/*
+================
+mk_watch__readEvents
+
+read whatever events are pending, forgetting what's cached about each file
+they name. Returns the number of files that changed. Restarts mk if the events
+show that the project layout may have changed.
+================
+*/
+static size_t mk_watch__readEvents( MkStrList changedDirs ) {
+	union {
+		struct inotify_event ev;
+		char buf[ 65536 ];
+	} u;
+	const struct inotify_event *ev;
+	const MkWatchDir *dir;
+	ssize_t n;
+	size_t numChanged;
+	char *p;
+	char path[PATH_MAX];
+
+	numChanged = 0;
+
+	for(;;) {
+		n = read( mk__g_watch.fd, (void *)&u, sizeof( u ) );
+		if( n < 0 && errno == EINTR ) {
+			continue;
+		}
+		break;
+	}
+	if( n <= 0 ) {
+		mk_log_fatalError( "read() from inotify failed" );
+	}
+
+	for( p = &u.buf[0]; p < &u.buf[n]; p += sizeof( struct inotify_event ) + ev->len ) {
+		ev = (const struct inotify_event *)p;
+
+		if( ev->mask & IN_Q_OVERFLOW ) {
+			mk_watch__restart( "too many changes to follow" );
+		}
+
+		if( !( dir = mk_watch__find( ev->wd ) ) ) {
+			continue;
+		}
+
+		if( ev->mask & ( IN_DELETE_SELF | IN_MOVE_SELF ) ) {
+			mk_watch__restart( mk_com_va( "\"%s\" was removed", dir->path ) );
+		}
+
+		if( !ev->len || ev->name[0] == '\0' ) {
+			continue;
+		}
+
+		if( ( ev->mask & MK_WATCH__STRUCTURE_MASK ) && ( ev->mask & IN_ISDIR ) ) {
+			mk_watch__restart( mk_com_va( "directory \"%s/%s\" was added or removed", dir->path, ev->name ) );
+		}
+		if( mk_prjfs_isProjectFile( ev->name ) ) {
+			mk_watch__restart( mk_com_va( "\"%s/%s\" changed", dir->path, ev->name ) );
+		}
+
+		mk_com_strcpy( path, sizeof( path ), dir->path );
+		mk_com_strcat( path, sizeof( path ), "/" );
+		mk_com_strcat( path, sizeof( path ), ev->name );
+
+		mk_dbg_outf( "watch: #%x \"%s\"\n", (unsigned)ev->mask, path );
+		mk_fs_invalidate( path );
+		++numChanged;
+
+		/* editors often replace a file instead of writing to it; whether the
+		   directory really gained or lost anything is checked afterward */
+		if( ev->mask & MK_WATCH__STRUCTURE_MASK ) {
+			mk_watch__noteDir( changedDirs, dir->path );
+		}
+	}
+
+	return numChanged;
+}
+
+/* wait for changes, and for things to settle down after them */
+static size_t mk_watch__wait( void ) {
+	struct pollfd pfd;
+	MkStrList changedDirs;
+	size_t numChanged, i, n;
+	int timeout;
+	int r;
+
+	changedDirs = mk_sl_new();
+	numChanged  = 0;
+	timeout     = -1;
+
+	for(;;) {
+		pfd.fd      = mk__g_watch.fd;
+		pfd.events  = POLLIN;
+		pfd.revents = 0;
+
+		r = poll( &pfd, 1, timeout );
+		if( r < 0 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			mk_log_fatalError( "poll() on inotify failed" );
+		}
+
+		if( r == 0 ) {
+			if( numChanged > 0 ) {
+				break;
+			}
+
+			timeout = -1;
+			continue;
+		}
+
+		numChanged += mk_watch__readEvents( changedDirs );
+		timeout     = MK_WATCH_SETTLE_MS;
+	}
+
+	n = mk_sl_getSize( changedDirs );
+	for( i = 0; i < n; ++i ) {
+		if( !mk_fs_isDirListCurrent( mk_sl_at( changedDirs, i ), &mk_prjfs_affectsDiscovery ) ) {
+			mk_watch__restart( mk_com_va( "files were added to or removed from \"%s\"", mk_sl_at( changedDirs, i ) ) );
+		}
+	}
+
+	mk_sl_delete( changedDirs );
+	return numChanged;
+}
+
+/*
+================
+mk_watch_run
+
+build all the projects, then keep rebuilding them as files change. Only
+returns on error.
+================
+*/
+int mk_watch_run( void ) {
+	size_t numChanged;
+	int r;
+
+	MK_ASSERT( mk__g_watch_argv != (char **)0 );
+
+	if( ( mk__g_watch.fd = inotify_init1( IN_CLOEXEC ) ) < 0 ) {
+		mk_log_errorMsg( "inotify_init1() failed; can't watch for changes" );
+		return 0;
+	}
+
+	/* watch before building, so nothing written meanwhile is missed */
+	mk_watch__addAll();
+
+	for(;;) {
+		r = mk_bld_makeAllProjects();
+
+		mk_sys_printf( kMkSIO_Err, "%s; watching %u director%s for changes\n",
+		    r ? "build succeeded" : "build failed",
+		    (unsigned)mk__g_watch.numDirs, mk__g_watch.numDirs == 1 ? "y" : "ies" );
+
+		numChanged = mk_watch__wait();
+		if( mk__g_flags & kMkFlag_Verbose_Bit ) {
+			mk_sys_printf( kMkSIO_Err, "%u file%s changed\n", (unsigned)numChanged, numChanged == 1 ? "" : "s" );
+		}
+
+		mk_bld_resetBuildState();
+	}
+}
+
+#else
+
+int mk_watch_run( void ) {
+	mk_log_errorMsg( "^E'--watch'^& is not supported on this platform" );
+	return 0;
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ *	This program is free software: you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+ *	========================================================================
+ *	WATCH MODE
+ *	========================================================================
+ *	`mk --watch` builds, then waits for sources, headers, or project files
+ *	to change and builds again. What the first run found -- the projects,
+ *	the stat cache, the build state -- stays in memory, so a rebuild only
+ *	looks at the files that changed and compiles what depends on them.
+ *
+ *	Changes that can alter the projects themselves (a source file or a
+ *	directory added or removed, an indicator or ".libs" file edited, ...)
+ *	restart mk with its original arguments instead, which finds everything
+ *	anew.
+ *
+ *	Only available where inotify is (Linux).
+ */
+
+void mk_watch_saveArgs( int argc, char **argv );
+int  mk_watch_run( void );
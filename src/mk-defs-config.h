@@ -109,6 +109,77 @@ See mk-io-sourceBuffer.c, mk-io-sourceBuffer.h.
 #	define MK_PROCESS_NEWLINE_CONCAT_ENABLED 1
 #endif
 
+/*
+================
+MK_MAX_JOBS
+
+Upper limit on the number of build steps (compiles, links) that may run at the
+same time, regardless of what -j asks for or how many hardware threads exist.
+
+Default: 256
+================
+*/
+#ifndef MK_MAX_JOBS
+#	define MK_MAX_JOBS 256
+#endif
+
+/*
+================
+MK_DEFAULT_TEST_TIMEOUT
+
+Number of seconds a unit test may run before it's killed and counted as a
+failure, unless --test-timeout says otherwise. 0 means no limit.
+
+Default: 300
+================
+*/
+#ifndef MK_DEFAULT_TEST_TIMEOUT
+#	define MK_DEFAULT_TEST_TIMEOUT 300
+#endif
+
+/*
+================
+MK_DEFAULT_BENCH_RUNS
+
+Number of timed runs of each benchmark that its results are drawn from, unless
+--bench-runs says otherwise.
+
+Default: 5
+================
+*/
+#ifndef MK_DEFAULT_BENCH_RUNS
+#	define MK_DEFAULT_BENCH_RUNS 5
+#endif
+
+/*
+================
+MK_BENCH_WARMUP_RUNS
+
+Number of runs of each benchmark before the timed ones, to warm up the caches
+(the file system's, and the CPU's) without counting them.
+
+Default: 1
+================
+*/
+#ifndef MK_BENCH_WARMUP_RUNS
+#	define MK_BENCH_WARMUP_RUNS 1
+#endif
+
+/*
+================
+MK_BENCH_REGRESSION_PERCENT
+
+How much slower than its previous run, in percent, a benchmark must be to be
+flagged as a regression by `mk bench --compare`. It must also be slower by more
+than the two runs' standard deviations put together, to not flag noise.
+
+Default: 5
+================
+*/
+#ifndef MK_BENCH_REGRESSION_PERCENT
+#	define MK_BENCH_REGRESSION_PERCENT 5
+#endif
+
 /*
 ===============================================================================
 
@@ -164,6 +235,54 @@ Default: "mk-debug.log"
 #	define MK_DEFAULT_DEBUGLOG_FILENAME "mk-debug.log"
 #endif
 
+/*
+================
+MK_DEFAULT_BUILDSTATE_FILENAME
+
+Name of the file that Mk keeps the state of each object file in, so that
+checking whether objects are up to date does not require reading every
+dependency (.d) file.
+
+NOTE: There is one of these per configuration, within the object directory.
+
+Default: "mk-build-state.db"
+(Which is really: ".mk-obj/<platform>/<config>/mk-build-state.db")
+================
+*/
+#ifndef MK_DEFAULT_BUILDSTATE_FILENAME
+#	define MK_DEFAULT_BUILDSTATE_FILENAME "mk-build-state.db"
+#endif
+
+/*
+================
+MK_WATCH_SETTLE_MS
+
+How long `mk --watch` waits for the file system to go quiet after a change
+before it starts a build, in milliseconds. Editors and version control tools
+often touch several files in quick succession.
+
+Default: 150
+================
+*/
+#ifndef MK_WATCH_SETTLE_MS
+#	define MK_WATCH_SETTLE_MS 150
+#endif
+
+/*
+================
+MK_OBJCACHE_MAX_MB
+
+How big the object cache (`mk --cache`) may grow before the least recently used
+objects are removed, in mebibytes. The environment variable MK_CACHE_MAX_MB
+overrides this.
+
+Default: 5120
+================
+*/
+#ifndef MK_OBJCACHE_MAX_MB
+#	define MK_OBJCACHE_MAX_MB 5120
+#endif
+
 /*
 ================
 MK_DEFAULT_COLOR_MODE
@@ -227,6 +346,34 @@ The name of the compiler to use by default if none are specified.
 #	endif
 #endif
 
+/*
+================
+MK_DEFAULT_ARCHIVER_NAME
+
+The name of the program that makes static libraries, used if AR is not set.
+================
+*/
+#ifndef MK_DEFAULT_ARCHIVER_NAME
+#	define MK_DEFAULT_ARCHIVER_NAME "ar"
+#endif
+
+/*
+================
+MK_ARCHIVER_DETERMINISTIC_ENABLED
+
+Whether to have the archiver leave timestamps, owners, and modes out of static
+libraries (`ar D`), so that a library made from the same objects comes out the
+same. The archiver on Mac OS X doesn't support this.
+================
+*/
+#ifndef MK_ARCHIVER_DETERMINISTIC_ENABLED
+#	if MK_HOST_OS_MACOSX
+#		define MK_ARCHIVER_DETERMINISTIC_ENABLED 0
+#	else
+#		define MK_ARCHIVER_DETERMINISTIC_ENABLED 1
+#	endif
+#endif
+
 /*
 ================
 MK_DEFAULT_CFLAGS_WARNINGS
@@ -16,18 +16,23 @@
 
 #include "mk-basic-array.h"
 #include "mk-basic-assert.h"
+#include "mk-basic-async.h"
 #include "mk-basic-common.h"
 #include "mk-basic-debug.h"
 #include "mk-basic-fileSystem.h"
 #include "mk-basic-logging.h"
+#include "mk-basic-stats.h"
 #include "mk-basic-stringList.h"
 #include "mk-basic-types.h"
 #include "mk-build-autolib.h"
 #include "mk-build-dependency.h"
 #include "mk-build-engine.h"
 #include "mk-build-library.h"
+#include "mk-build-objectCache.h"
 #include "mk-build-project.h"
 #include "mk-build-projectFS.h"
+#include "mk-build-stateDatabase.h"
+#include "mk-build-trace.h"
 #include "mk-defs-config.h"
 #include "mk-defs-platform.h"
 #include "mk-system-output.h"
@@ -262,6 +267,19 @@ MkStrList mk__g_dllsdirs = (MkStrList)0;
 bitfield_t mk__g_flags          = 0;
 MkColorMode_t mk__g_flags_color = MK__DEFAULT_COLOR_MODE_IMPL;
 
+unsigned int mk__g_numJobs = 0;
+
+unsigned int mk__g_numTestJobs = 0;
+unsigned int mk__g_testTimeout = MK_DEFAULT_TEST_TIMEOUT;
+
+unsigned int mk__g_numBenchRuns = MK_DEFAULT_BENCH_RUNS;
+
+const char *mk__g_seedDir     = (const char *)0;
+int         mk__g_seedMethods = kMkFsTransfer_Any;
+
+const char *mk__g_traceFile = (const char *)0;
+const char *mk__g_statsFile = (const char *)0;
+
 MkActions mk__g_actions = { .len = 0, .ptr = (MkAction *)0 };
 
 void mk_front_pushSrcDir( const char *srcdir ) {
@@ -404,6 +422,11 @@ static int isAction( MkAction *act, const char *s ) {
 		return 1;
 	}
 
+	if( strEqAnyUntilNull( s, "bench", "--bench", NULL ) ) {
+		*p_ty = kMkAction_BenchTarget;
+		return 1;
+	}
+
 	return 0;
 }
 static int actionExpectsTarget( MkActionType_t ty ) {
@@ -411,6 +434,7 @@ static int actionExpectsTarget( MkActionType_t ty ) {
 	case kMkAction_BuildTarget:
 	case kMkAction_CleanTarget:
 	case kMkAction_TestTarget:
+	case kMkAction_BenchTarget:
 		return 1;
 
 	default:
@@ -582,6 +606,15 @@ static void processSharedArguments( int argc, const char **argv, checkForAction_
 					}
 
 					opt = "srcdir";
+				} else if( *( opt + 1 ) == 'j' ) {
+					REMOVE_ARG();
+					if( *( opt + 2 ) == 0 ) {
+						p = i + 1 < argc ? argv[++i] : (const char *)0;
+					} else {
+						p = &opt[2];
+					}
+
+					opt = "jobs";
 				} else if( *( opt + 1 ) == 'P' ) {
 					REMOVE_ARG();
 					if( *( opt + 2 ) == 0 ) {
@@ -634,6 +667,208 @@ static void processSharedArguments( int argc, const char **argv, checkForAction_
 				PROCESS_BIT(kMkFlag_Pedantic_Bit);
 			}
 
+			if( !strcmp( opt, "watch" ) ) {
+				PROCESS_BIT(kMkFlag_Watch_Bit);
+			}
+
+			if( !strcmp( opt, "hash-deps" ) ) {
+				PROCESS_BIT(kMkFlag_HashDeps_Bit);
+			}
+
+			if( !strcmp( opt, "cache" ) ) {
+				PROCESS_BIT(kMkFlag_Cache_Bit);
+			}
+
+			if( !strcmp( opt, "cache-stats" ) ) {
+				PROCESS_BIT(kMkFlag_CacheStats_Bit);
+			}
+
+			if( !strcmp( opt, "thin-archives" ) ) {
+				PROCESS_BIT(kMkFlag_ThinArchives_Bit);
+			}
+
+			if( !strcmp( opt, "jobs" ) ) {
+				char *end;
+				long n;
+
+				REMOVE_ARG();
+				if( op ) {
+					mk__g_numJobs = 1;
+					continue;
+				}
+
+				if( !p && i + 1 < argc ) {
+					p = argv[++i];
+				}
+				if( !p || *p == '\0' ) {
+					mk_log_errorMsg( "expected a job count for ^E'--jobs'^&" );
+					continue;
+				}
+
+				n = strtol( p, &end, 10 );
+				if( *end != '\0' || n < 1 || n > MK_MAX_JOBS ) {
+					mk_log_errorMsg( mk_com_va( "invalid job count ^E'%s'^&; ignoring", p ) );
+					continue;
+				}
+
+				mk__g_numJobs = (unsigned int)n;
+				continue;
+			}
+
+			if( !strcmp( opt, "combine-tests" ) ) {
+				PROCESS_BIT(kMkFlag_CombineTests_Bit);
+			}
+
+			if( !strcmp( opt, "force-tests" ) ) {
+				PROCESS_BIT(kMkFlag_ForceTests_Bit);
+			}
+
+			if( !strcmp( opt, "test-jobs" ) ) {
+				char *end;
+				long n;
+
+				REMOVE_ARG();
+				if( !p && i + 1 < argc ) {
+					p = argv[++i];
+				}
+				if( !p || *p == '\0' ) {
+					mk_log_errorMsg( "expected a job count for ^E'--test-jobs'^&" );
+					continue;
+				}
+
+				n = strtol( p, &end, 10 );
+				if( *end != '\0' || n < 1 || n > MK_MAX_JOBS ) {
+					mk_log_errorMsg( mk_com_va( "invalid job count ^E'%s'^&; ignoring", p ) );
+					continue;
+				}
+
+				mk__g_numTestJobs = (unsigned int)n;
+				continue;
+			}
+
+			if( !strcmp( opt, "test-timeout" ) ) {
+				char *end;
+				long n;
+
+				REMOVE_ARG();
+				if( op ) {
+					mk__g_testTimeout = 0;
+					continue;
+				}
+
+				if( !p && i + 1 < argc ) {
+					p = argv[++i];
+				}
+				if( !p || *p == '\0' ) {
+					mk_log_errorMsg( "expected a number of seconds for ^E'--test-timeout'^&" );
+					continue;
+				}
+
+				/* milliseconds are kept in 32 bits */
+				n = strtol( p, &end, 10 );
+				if( *end != '\0' || n < 0 || n > 4000000 ) {
+					mk_log_errorMsg( mk_com_va( "invalid test timeout ^E'%s'^&; ignoring", p ) );
+					continue;
+				}
+
+				mk__g_testTimeout = (unsigned int)n;
+				continue;
+			}
+
+			if( !strcmp( opt, "compare" ) ) {
+				PROCESS_BIT(kMkFlag_BenchCompare_Bit);
+			}
+
+			if( !strcmp( opt, "bench-runs" ) ) {
+				char *end;
+				long n;
+
+				REMOVE_ARG();
+				if( !p && i + 1 < argc ) {
+					p = argv[++i];
+				}
+				if( !p || *p == '\0' ) {
+					mk_log_errorMsg( "expected a number of runs for ^E'--bench-runs'^&" );
+					continue;
+				}
+
+				n = strtol( p, &end, 10 );
+				if( *end != '\0' || n < 1 || n > 1000 ) {
+					mk_log_errorMsg( mk_com_va( "invalid number of runs ^E'%s'^&; ignoring", p ) );
+					continue;
+				}
+
+				mk__g_numBenchRuns = (unsigned int)n;
+				continue;
+			}
+
+			if( !strcmp( opt, "seed-objdir" ) ) {
+				REMOVE_ARG();
+				if( op ) {
+					mk__g_seedDir = (const char *)0;
+					continue;
+				}
+
+				if( !p && i + 1 < argc ) {
+					p = argv[++i];
+				}
+				if( !p || *p == '\0' ) {
+					mk_log_errorMsg( "expected a directory for ^E'--seed-objdir'^&" );
+					continue;
+				}
+
+				mk__g_seedDir = p;
+				continue;
+			}
+
+			if( !strcmp( opt, "stats" ) ) {
+				mk__g_statsFile = op || !p || *p == '\0' ? (const char *)0 : p;
+				PROCESS_BIT(kMkFlag_Stats_Bit);
+			}
+
+			if( !strcmp( opt, "trace" ) ) {
+				REMOVE_ARG();
+				if( op ) {
+					mk__g_traceFile = (const char *)0;
+					continue;
+				}
+
+				if( !p && i + 1 < argc ) {
+					p = argv[++i];
+				}
+				if( !p || *p == '\0' ) {
+					mk_log_errorMsg( "expected a file for ^E'--trace'^&" );
+					continue;
+				}
+
+				mk__g_traceFile = p;
+				continue;
+			}
+
+			if( !strcmp( opt, "seed-mode" ) ) {
+				REMOVE_ARG();
+				if( !p && i + 1 < argc ) {
+					p = argv[++i];
+				}
+				if( !p || *p == '\0' ) {
+					mk_log_errorMsg( "expected a mode for ^E'--seed-mode'^&" );
+					continue;
+				}
+
+				if( !strcmp( p, "auto" ) ) {
+					mk__g_seedMethods = kMkFsTransfer_Any;
+				} else if( !strcmp( p, "reflink" ) ) {
+					mk__g_seedMethods = kMkFsTransfer_Reflink;
+				} else if( !strcmp( p, "link" ) ) {
+					mk__g_seedMethods = kMkFsTransfer_HardLink;
+				} else if( !strcmp( p, "copy" ) ) {
+					mk__g_seedMethods = kMkFsTransfer_Copy;
+				} else {
+					mk_log_errorMsg( mk_com_va( "unknown seed mode ^E'%s'^&; ignoring", p ) );
+				}
+				continue;
+			}
+
 			if( !strcmp( opt, "color" ) ) {
 				REMOVE_ARG();
 				if( op ) {
@@ -808,8 +1043,32 @@ static void showHelp(void) {
 	printf( "  -R,--rebuild             "
 			"Force a rebuild, without cleaning.\n" );
 	printf( "  -T,--test                Run unit tests.\n" );
+	printf( "  --[no-]combine-tests     Link each project's C unit tests into one program.\n" );
+	printf( "  --force-tests            Run unit tests even if they haven't changed.\n" );
+	printf( "  --test-jobs=<n>          Run up to <n> unit tests at once. (Default: -j.)\n" );
+	printf( "  --[no-]test-timeout=<s>  Fail unit tests still running after <s> seconds.\n" );
+	printf( "                           (Default: %u.)\n", (unsigned int)MK_DEFAULT_TEST_TIMEOUT );
+	printf( "  bench,--bench            Build and run benchmarks (in release mode).\n" );
+	printf( "  --bench-runs=<n>         Time <n> runs of each benchmark. (Default: %u.)\n", (unsigned int)MK_DEFAULT_BENCH_RUNS );
+	printf( "  --compare                Flag benchmarks slower than in their last run.\n" );
 	printf( "  -c,--compile-only        Just compile; do not link.\n" );
 	printf( "  -p,--pedantic            Enable pedantic warnings.\n" );
+	printf( "  -j,--jobs=<n>            Run up to <n> build steps at once.\n" );
+	printf( "                           (Default: one per hardware thread.)\n" );
+	printf( "  --no-jobs                Run one build step at a time.\n" );
+	printf( "  --watch                  Keep running; rebuild whenever a source changes.\n" );
+	printf( "  --[no-]hash-deps         Only rebuild when a dependency's contents change,\n" );
+	printf( "                           not just its modification time.\n" );
+	printf( "  --[no-]cache             Reuse objects compiled before, by any project.\n" );
+	printf( "  --cache-stats            Show how well the object cache has been doing.\n" );
+	printf( "  --[no-]thin-archives     Make static libraries refer to their objects\n" );
+	printf( "                           instead of holding copies (GNU ar).\n" );
+	printf( "  --seed-objdir=<dir>      Start from the objects of another checkout at <dir>\n" );
+	printf( "                           whose sources are identical to this one's.\n" );
+	printf( "  --seed-mode=<mode>       How to seed: auto [default], reflink, link, or copy.\n" );
+	printf( "  --trace=<file>           Write a Chrome trace (JSON) of the build to <file>.\n" );
+	printf( "  --stats[=<file>]         Show where the build spent its time, or write it\n" );
+	printf( "                           to <file> as JSON ('-' for stdout).\n" );
 	printf( "  --[no-]pthread           Enable -pthread compiler flag [default].\n" );
 	printf( "  -H,--print-hierarchy     Display the project hierarchy.\n" );
 	printf( "  -S,--srcdir=<dir>        Add a source directory.\n" );
@@ -869,6 +1128,13 @@ static void processActions(void) {
 			break;
 
 		case kMkAction_TestTarget:
+			mk__g_flags |= kMkFlag_Test_Bit;
+			processSharedArguments( act->argc, act->argv, kCheckForAction_No, kAcceptTargets_Yes );
+			break;
+
+		case kMkAction_BenchTarget:
+			/* timing anything but optimized code isn't of much use */
+			mk__g_flags |= kMkFlag_Bench_Bit | kMkFlag_Release_Bit;
 			processSharedArguments( act->argc, act->argv, kCheckForAction_No, kAcceptTargets_Yes );
 			break;
 		}
@@ -879,6 +1145,8 @@ void mk_main_init( int argc, char **argv ) {
 	MkAutolink al;
 	size_t j;
 	MkLib lib;
+	MkStatsTimer timer;
+	mk_uint64_t start;
 	int builtinautolinks = 1, userautolinks = 1;
 
 	/* core initialization */
@@ -889,7 +1157,10 @@ void mk_main_init( int argc, char **argv ) {
 	atexit( mk_fs_unwindDirs );
 	atexit( mk_al_deleteAll );
 	atexit( mk_dep_deleteAll );
+	atexit( mk_bdb_unload );
 	atexit( mk_prj_deleteAll );
+	atexit( mk_trace_fini );
+	atexit( mk_stats_fini );
 	mk_bld_initUnitTestArrays();
 
 	/* string-lists need to be initialized */
@@ -911,6 +1182,24 @@ void mk_main_init( int argc, char **argv ) {
 
 	processActions();
 
+	/* as early as possible, so that discovery is part of the trace */
+	if( mk__g_traceFile != (const char *)0 ) {
+		mk_trace_start( mk__g_traceFile );
+	}
+	if( mk__g_flags & kMkFlag_Stats_Bit ) {
+		mk_stats_start( mk__g_statsFile );
+	}
+
+	/* default to one job per hardware thread */
+	if( !mk__g_numJobs ) {
+		mk__g_numJobs = (unsigned int)axth_count_cpu_threads();
+		if( mk__g_numJobs < 1 ) {
+			mk__g_numJobs = 1;
+		} else if( mk__g_numJobs > MK_MAX_JOBS ) {
+			mk__g_numJobs = MK_MAX_JOBS;
+		}
+	}
+
 	/* exit if no targets were specified and a message was requested */
 	if( mk__g_flags & ( kMkFlag_ShowVersion_Bit | kMkFlag_ShowHelp_Bit ) && !mk_sl_getSize( mk__g_targets ) ) {
 		exit( EXIT_SUCCESS );
@@ -920,7 +1209,13 @@ void mk_main_init( int argc, char **argv ) {
 	mk_fs_makeDirs( mk_opt_getGlobalSharedDir() );
 	mk_fs_makeDirs( mk_opt_getGlobalVersionDir() );
 
+	if( mk__g_flags & kMkFlag_CacheStats_Bit ) {
+		mk_oc_printStats();
+		exit( EXIT_SUCCESS );
+	}
+
 	/* add builtin autolinks / libraries */
+	mk_stats_beginPhase( &timer );
 	if( builtinautolinks ) {
 		/* add the autolinks */
 		for( j = 0; j < sizeof( autolinks ) / sizeof( autolinks[0] ); j++ ) {
@@ -964,10 +1259,15 @@ void mk_main_init( int argc, char **argv ) {
 		/* load from the current directory */
 		(void)mk_al_loadConfig( "mk-autolinks.txt" );
 	}
+	mk_stats_endPhase( kMkStats_Autolink, &timer );
 
 	/* grab the available directories */
+	start = mk_com_getTimeNs();
+	mk_stats_beginPhase( &timer );
 	mk_prjfs_findRootDirs( mk__g_srcdirs, mk__g_incdirs, mk__g_libdirs, mk__g_pkgdirs, mk__g_tooldirs,
 	    mk__g_dllsdirs );
+	mk_stats_endPhase( kMkStats_Discover, &timer );
+	mk_trace_add( mk_trace_getBuffer( 0 ), kMkTrace_Discover, "find projects", start, mk_com_getTimeNs(), kMkTrace_NoStatus, (const char *)0 );
 
 	/* if there aren't any source directories, complain */
 	if( !mk_sl_getSize( mk__g_srcdirs ) && !mk_sl_getSize( mk__g_pkgdirs ) ) {
@@ -94,6 +94,22 @@ typedef enum {
 
 	*/
 	kMkAction_TestTarget,
+	/*
+
+		$ mk bench
+		$ mk --bench
+
+			Builds all targets in release mode, then runs the benchmarks of
+			all targets.
+
+		$ mk bench target-name
+		$ mk bench --compare
+
+			Runs the benchmarks of the specific target, or flags those slower
+			than they were in the last run.
+
+	*/
+	kMkAction_BenchTarget,
 } MkActionType_t;
 
 typedef struct MkAction_s {
@@ -133,11 +149,45 @@ enum {
 	kMkFlag_Pedantic_Bit        = 0x200,
 	kMkFlag_Test_Bit            = 0x400,
 	kMkFlag_FullClean_Bit       = 0x800,
-	kMkFlag_OutSingleThread_Bit = 0x1000
+	kMkFlag_OutSingleThread_Bit = 0x1000,
+	kMkFlag_Watch_Bit           = 0x2000,
+	kMkFlag_HashDeps_Bit        = 0x4000,
+	kMkFlag_Cache_Bit           = 0x8000,
+	kMkFlag_CacheStats_Bit      = 0x10000,
+	kMkFlag_ThinArchives_Bit    = 0x20000,
+	kMkFlag_Stats_Bit           = 0x40000,
+	kMkFlag_ForceTests_Bit      = 0x80000,
+	kMkFlag_CombineTests_Bit    = 0x100000,
+	kMkFlag_Bench_Bit           = 0x200000,
+	kMkFlag_BenchCompare_Bit    = 0x400000
 };
 extern bitfield_t mk__g_flags;
 extern MkColorMode_t mk__g_flags_color;
 
+/* number of build steps to run simultaneously (-j); 0 until mk_main_init() */
+extern unsigned int mk__g_numJobs;
+
+/* number of unit test jobs to run simultaneously (--test-jobs); 0 for as many
+   as build steps -- and the seconds each test may take (--test-timeout; 0 for
+   no limit) */
+extern unsigned int mk__g_numTestJobs;
+extern unsigned int mk__g_testTimeout;
+
+/* number of timed runs of each benchmark (--bench-runs) */
+extern unsigned int mk__g_numBenchRuns;
+
+/* tree to seed the object directory from (--seed-objdir), if any, and the ways
+   its files may be put in place (kMkFsTransfer_*; --seed-mode) */
+extern const char *mk__g_seedDir;
+extern int         mk__g_seedMethods;
+
+/* file to write a trace of the build to (--trace), if any */
+extern const char *mk__g_traceFile;
+
+/* file to write the statistics to as JSON (--stats=<file>); if null, they're
+   shown as a table when kMkFlag_Stats_Bit is set */
+extern const char *mk__g_statsFile;
+
 extern MkStrList mk__g_targets;
 extern MkStrList mk__g_srcdirs;
 extern MkStrList mk__g_incdirs;
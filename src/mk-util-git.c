@@ -148,7 +148,7 @@ char *mk_git_getCommitTimestamp( const char *pszBranchFile, const MkStat_t *pSta
 
 	if( pStat != (const MkStat_t *)0 ) {
 		s = *pStat;
-	} else if( stat( pszBranchFile, &s ) != 0 ) {
+	} else if( !mk_fs_stat( pszBranchFile, &s ) ) {
 		mk_log_error( pszBranchFile, 0, (const char *)0, "Stat failed" );
 		return (char *)0;
 	}
@@ -337,7 +337,7 @@ int mk_git_writeHeader( const char *pszHFilename, MkGitInfo pGitInfo ) {
 		++pszBranchName;
 
 		/* early exit if we don't need a new file */
-		if( stat( pszBranchFile, &branchStat ) == 0 && stat( pszHFilename, &headerStat ) == 0 && branchStat.st_mtime < headerStat.st_mtime ) {
+		if( mk_fs_stat( pszBranchFile, &branchStat ) && mk_fs_stat( pszHFilename, &headerStat ) && branchStat.st_mtime < headerStat.st_mtime ) {
 			/* file already made; don't modify */
 			return 1;
 		}
@@ -364,6 +364,7 @@ int mk_git_writeHeader( const char *pszHFilename, MkGitInfo pGitInfo ) {
 		fprintf( fp, "#endif /* BUILDGEN_GITINFO_H */\r\n" );
 
 		fclose( fp );
+		mk_fs_invalidate( pszHFilename );
 		return 1;
 	}
 
@@ -391,6 +392,7 @@ int mk_git_writeHeader( const char *pszHFilename, MkGitInfo pGitInfo ) {
 	fprintf( fp, "#endif\r\n" );
 
 	fclose( fp );
+	mk_fs_invalidate( pszHFilename );
 	return 1;
 }
 
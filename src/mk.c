@@ -44,12 +44,14 @@
 #include "mk-basic-stringList.h"
 #include "mk-build-engine.h"
 #include "mk-build-project.h"
+#include "mk-build-watch.h"
 #include "mk-frontend.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
 int main( int argc, char **argv ) {
+	mk_watch_saveArgs( argc, argv );
 	mk_main_init( argc, argv );
 
 	if( mk__g_flags & kMkFlag_PrintHierarchy_Bit ) {
@@ -71,6 +73,10 @@ int main( int argc, char **argv ) {
 		fflush( stdout );
 	}
 
+	if( mk__g_flags & kMkFlag_Watch_Bit ) {
+		return mk_watch_run() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	if( !mk_bld_makeAllProjects() ) {
 		return EXIT_FAILURE;
 	}